@@ -49,6 +49,18 @@ public:
 	uint8_t Read_AbsoluteSector(uint32_t sectnum, void * data);
 	uint8_t Write_AbsoluteSector(uint32_t sectnum, void * data);
 
+	// Transfer a run of consecutive sectors in one go
+	uint8_t Read_Sectors(uint32_t head, uint32_t cylinder, uint32_t sector,
+	                     uint32_t num_sectors, void* data);
+	uint8_t Write_Sectors(uint32_t head, uint32_t cylinder, uint32_t sector,
+	                      uint32_t num_sectors, const void* data);
+	uint8_t Read_AbsoluteSectors(uint32_t sectnum, uint32_t num_sectors, void* data);
+	uint8_t Write_AbsoluteSectors(uint32_t sectnum, uint32_t num_sectors,
+	                              const void* data);
+
+	// Writes modified sectors of a memory-mapped image back to the file
+	void Flush();
+
 	void Set_Geometry(uint32_t setHeads, uint32_t setCyl, uint32_t setSect, uint32_t setSectSize);
 	void Get_Geometry(uint32_t * getHeads, uint32_t *getCyl, uint32_t *getSect, uint32_t *getSectSize);
 	uint8_t GetBiosType(void);
@@ -58,11 +70,7 @@ public:
 	imageDisk(const imageDisk&) = delete; // prevent copy
 	imageDisk& operator=(const imageDisk&) = delete; // prevent assignment
 
-	~imageDisk()
-	{
-		if (diskimg != nullptr)
-			fclose(diskimg);
-	}
+	~imageDisk();
 
 	bool hardDrive;
 	bool active;
@@ -73,13 +81,35 @@ public:
 	uint32_t sector_size;
 	uint32_t heads,cylinders,sectors;
 private:
+	void MapImage();
+	void UnmapImage();
+
 	cross_off_t current_fpos;
 	enum { NONE,READ,WRITE } last_action;
+
+	// If the host supports it, the image file is memory-mapped, so sector
+	// transfers are plain copies without any file I/O. Accesses beyond
+	// the mapped size (or writes to an image mapped read-only) still go
+	// through diskimg.
+	uint8_t* mapped_image   = nullptr;
+	size_t mapped_size      = 0;
+	bool is_mapped_writable = false;
+	bool has_mapped_writes  = false;
 };
 
 void updateDPT(void);
 void incrementFDD(void);
 
+// Sector access as done by INT 13h. The FAT drives mounted from the image
+// cache their FAT, so it's flushed before the access and re-read after a
+// write to it.
+uint8_t BIOS_ReadDiskSectors(const std::shared_ptr<imageDisk>& disk,
+                             uint32_t head, uint32_t cylinder, uint32_t sector,
+                             uint32_t num_sectors, void* data);
+uint8_t BIOS_WriteDiskSectors(const std::shared_ptr<imageDisk>& disk,
+                              uint32_t head, uint32_t cylinder, uint32_t sector,
+                              uint32_t num_sectors, const void* data);
+
 #define MAX_HDD_IMAGES 2
 
 #define MAX_DISK_IMAGES (2 + MAX_HDD_IMAGES)
@@ -111,6 +111,20 @@ Bits CPU_Core_Prefetch_Trap_Run() noexcept;
 
 void CPU_ResetAutoAdjust();
 
+// Code cache counters of the dynamic core
+struct CPU_DynamicCacheStats {
+	uint64_t translations  = 0; // blocks translated
+	uint64_t evictions     = 0; // blocks dropped to make room for new ones
+	uint64_t invalidations = 0; // blocks dropped due to modified code
+
+	size_t num_blocks      = 0; // blocks currently in the cache
+	size_t used_bytes      = 0; // code bytes held by these blocks
+	size_t total_bytes     = 0; // current size of the cache
+	size_t max_total_bytes = 0; // size the cache may grow to
+};
+
+CPU_DynamicCacheStats CPU_GetDynamicCacheStats();
+
 extern uint16_t parity_lookup[256];
 
 bool CPU_LLDT(Bitu selector);
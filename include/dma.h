@@ -24,12 +24,12 @@
 
 #include <cassert>
 #include <functional>
+#include <span>
 
 #include "inout.h"
+#include "mem.h"
 #include "support.h"
 
-enum class DMA_DIRECTION { READ, WRITE };
-
 enum DMAEvent {
 	DMA_REACHED_TC,
 	DMA_MASKED,
@@ -42,6 +42,10 @@ using DMA_ReservationCallback = std::function<void(Section*)>;
 class DmaChannel;
 using DMA_Callback = std::function<void(const DmaChannel* chan, DMAEvent event)>;
 
+// Receives a transfer's guest memory in place, one contiguous span at a time.
+// A span never crosses a 4 KB page and is only valid during the call.
+using DMA_SpanCallback = std::function<void(std::span<const uint8_t> span)>;
+
 class DmaChannel {
 public:
 	// Defaults at the time of initialization
@@ -77,6 +81,10 @@ public:
 	size_t Read(size_t words, uint8_t* const dest_buffer);
 	size_t Write(size_t words, uint8_t* const src_buffer);
 
+	// Like Read(), but passes the data to the callback straight from guest
+	// memory instead of copying it into a buffer first.
+	size_t ReadSpans(size_t words, const DMA_SpanCallback& span_callback);
+
 	// Reset the channel back to defaults, without callbacks or reservations.
 	void Reset();
 
@@ -89,8 +97,9 @@ public:
 private:
 	void EvictReserver();
 	bool HasReservation() const;
-	size_t ReadOrWrite(DMA_DIRECTION direction, size_t words,
-	                   uint8_t* const buffer);
+	using ChunkCallback = std::function<void(PhysPt chunk_start,
+	                                         uint16_t chunk_bytes)>;
+	size_t Transfer(size_t words, const ChunkCallback& chunk_callback);
 
 	DMA_ReservationCallback reservation_callback = {};
 	std::string reservation_owner                = {};
@@ -23,6 +23,7 @@
 #include "dosbox.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "bit_view.h"
@@ -134,6 +135,10 @@ public:
 	virtual uint16_t	GetInformation(void)=0;
 	virtual bool IsOnReadOnlyMedium() const = 0;
 
+	// Writes back any data the file buffers on the host side (INT 21h
+	// commit); returns false and sets the DOS error if that fails
+	virtual bool Flush() { return true; }
+
 	virtual void AddRef() { refCtr++; }
 	virtual Bits RemoveRef() { return --refCtr; }
 
@@ -228,6 +233,12 @@ public:
 	void SetLabel(const char *name, bool cdrom, bool allowupdate);
 	const char *GetLabel() const { return label; }
 
+	// Watch cached host directories and drop those changed by other
+	// programs, so RESCAN isn't needed. Only available on Linux, and only
+	// used if the 'host_dir_watch' setting is enabled.
+	static void SetHostWatchEnabled(const bool enabled);
+	void DisableHostWatch();
+
 	class CFileInfo {
 	public:
 		CFileInfo(void)
@@ -238,6 +249,7 @@ public:
 		          id(MAX_OPENDIRS),
 		          nextEntry(0),
 		          shortNr(0),
+		          watchId(-1),
 		          fileList(0),
 		          longNameList(0)
 		{}
@@ -249,6 +261,9 @@ public:
 			}
 			fileList.clear();
 			longNameList.clear();
+			shortNameIndex.clear();
+			longNameIndex.clear();
+			wineNameIndex.clear();
 		}
 
 		char        orgname[CROSS_LEN];
@@ -258,9 +273,17 @@ public:
 		uint16_t      id;
 		Bitu        nextEntry;
 		unsigned    shortNr;
+		int         watchId;
 		// contents
 		std::vector<CFileInfo*> fileList;
 		std::vector<CFileInfo*> longNameList;
+
+		// Name lookups into fileList: by 8.3 name, by host name (case
+		// insensitive on Windows), and by Wine-style mangled name, which
+		// is only built when first needed
+		std::unordered_map<std::string, CFileInfo*> shortNameIndex;
+		std::unordered_map<std::string, CFileInfo*> longNameIndex;
+		std::unordered_map<std::string, CFileInfo*> wineNameIndex;
 	};
 
 private:
@@ -269,6 +292,7 @@ private:
 
 	bool		RemoveTrailingDot	(char* shortname);
 	Bits		GetLongName		(CFileInfo* info, char* shortname, const size_t shortname_len);
+	Bits		GetEntryIndex		(CFileInfo* dir, CFileInfo* info);
 	void		CreateShortName		(CFileInfo* dir, CFileInfo* info);
 	unsigned        CreateShortNameID       (CFileInfo* dir, const char* name);
 	int		CompareShortname	(const char* compareName, const char* shortName);
@@ -281,6 +305,11 @@ private:
 	void		CopyEntry		(CFileInfo* dir, CFileInfo* from);
 	uint16_t		GetFreeID		(CFileInfo* dir);
 	void		Clear			(void);
+	void		CacheOutDir		(CFileInfo* dir);
+
+	void		WatchHostDir		(CFileInfo* dir, const char* path);
+	void		UnwatchHostDir		(CFileInfo* dir);
+	void		ProcessHostChanges	(void);
 
 	CFileInfo*	dirBase;
 	char		dirPath				[CROSS_LEN];
@@ -297,6 +326,11 @@ private:
 
 	char		label				[CROSS_LEN];
 	bool		updatelabel;
+
+	// Host directory watcher (inotify), created on first use
+	int		watchFd				= -1;
+	bool		hostWatchAllowed		= true;
+	std::unordered_map<int, CFileInfo*> watchedDirs = {};
 };
 
 enum class DosDriveType : uint16_t {
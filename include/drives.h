@@ -200,6 +200,7 @@ public:
 	         bool roflag);
 	fatDrive(const fatDrive&)            = delete; // prevent copying
 	fatDrive& operator=(const fatDrive&) = delete; // prevent assignment
+	~fatDrive() override;
 	std::unique_ptr<DOS_File> FileOpen(const char* name, uint8_t flags) override;
 	std::unique_ptr<DOS_File> FileCreate(const char* name,
 	                                     FatAttributeFlags attributes) override;
@@ -225,12 +226,20 @@ public:
 
 public:
 	uint8_t readSector(uint32_t sectnum, void * data);
+	uint8_t readSectors(uint32_t sectnum, uint32_t num_sectors, void* data);
 	uint8_t writeSector(uint32_t sectnum, void * data);
+	uint8_t writeSectors(uint32_t sectnum, uint32_t num_sectors, void* data);
 	uint32_t getAbsoluteSectFromBytePos(uint32_t startClustNum, uint32_t bytePos);
 	uint32_t getSectorCount();
 	uint32_t getSectorSize(void);
 	uint32_t getClusterSize(void);
 	uint32_t getAbsoluteSectFromChain(uint32_t startClustNum, uint32_t logicalSector);
+	uint32_t getClustFirstSect(uint32_t clustNum);
+	uint32_t getNextCluster(uint32_t clustNum);
+	uint32_t getChainGeneration() const { return chainGeneration; }
+	void flushFat();
+	bool isFatSector(uint32_t sectnum) const;
+	void reloadFat();
 	bool allocateCluster(uint32_t useCluster, uint32_t prevCluster);
 	uint32_t appendCluster(uint32_t startCluster);
 	void deleteClustChain(uint32_t startCluster, uint32_t bytePos);
@@ -244,7 +253,8 @@ public:
 private:
 	uint32_t getClusterValue(uint32_t clustNum);
 	void setClusterValue(uint32_t clustNum, uint32_t clustValue);
-	uint32_t getClustFirstSect(uint32_t clustNum);
+	bool isEndOfChain(uint32_t clustValue) const;
+	bool loadFat();
 	bool FindNextInternal(uint32_t dirClustNumber, DOS_DTA & dta, direntry *foundEntry);
 	bool getDirClustNum(const char * dir, uint32_t * clustNum, bool parDir);
 	bool getFileDirEntry(const char* const filename, direntry* useEntry,
@@ -264,8 +274,15 @@ private:
 
 	uint32_t cwdDirCluster;
 
-	uint8_t fatSectBuffer[1024];
-	uint32_t curFatSect;
+	// The first FAT copy, cached whole; changed sectors are written to
+	// every copy on flushFat()
+	std::vector<uint8_t> fatCache     = {};
+	std::vector<bool> dirtyFatSectors = {};
+	bool isFatDirty                   = false;
+
+	// Bumped whenever an existing cluster chain is cut or relinked, so
+	// open files know to drop their extent maps
+	uint32_t chainGeneration = 0;
 };
 
 class cdromDrive final : public localDrive
@@ -369,7 +386,6 @@ struct isoDirEntry {
 #define IS_ASSOC(fileFlags)	(!!(fileFlags & ISO_ASSOCIATED))
 #define IS_DIR(fileFlags)	(!!(fileFlags & ISO_DIRECTORY))
 #define IS_HIDDEN(fileFlags)	(!!(fileFlags & ISO_HIDDEN))
-#define ISO_MAX_HASH_TABLE_SIZE 	100
 
 // Must be constructed with a shared_ptr or it will throw an exception on internal call to shared_from_this()
 class isoDrive final : public DOS_Drive, public std::enable_shared_from_this<isoDrive> {
@@ -415,23 +431,20 @@ private:
 	int  GetDirIterator(const isoDirEntry* de);
 	bool GetNextDirEntry(const int dirIterator, isoDirEntry* de);
 	void FreeDirIterator(const int dirIterator);
-	bool ReadCachedSector(uint8_t** buffer, const uint32_t sector);
+	const std::vector<isoDirEntry>* GetDirEntries(const isoDirEntry* de);
 	
 	struct DirIterator {
 		bool valid;
 		bool root;
-		uint32_t currentSector;
-		uint32_t endSector;
-		uint32_t pos;
+		const std::vector<isoDirEntry>* entries;
+		size_t pos;
 	} dirIterators[MAX_OPENDIRS];
 	
 	int nextFreeDirIterator;
-	
-	struct SectorHashEntry {
-		bool valid;
-		uint32_t sector;
-		uint8_t data[ISO_FRAMESIZE];
-	} sectorHashEntries[ISO_MAX_HASH_TABLE_SIZE];
+
+	// Directories read so far, keyed by their first sector; the disc
+	// can't change under a mounted image, so they're read only once
+	std::unordered_map<uint32_t, std::vector<isoDirEntry>> dirCache = {};
 
 	bool iso;
 	bool dataCD;
@@ -525,8 +538,8 @@ private:
 	void remove_DOSdir_from_cache(const char* name);
 	void update_cache(bool read_directory_contents = false);
 
-	std::vector<std::string> deleted_files_in_base; //Set is probably better, or some other solution (involving the disk).
-	std::vector<std::string> deleted_paths_in_base; //Currently only used to hide the overlay folder.
+	std::unordered_set<std::string> deleted_files_in_base;
+	std::unordered_set<std::string> deleted_paths_in_base; //Currently only used to hide the overlay folder.
 	std::string overlap_folder;
 	void add_deleted_file(const char* name, bool create_on_disk);
 	void remove_deleted_file(const char* name, bool create_on_disk);
@@ -541,12 +554,24 @@ private:
 
 	void remove_special_file_from_disk(const char* dosname, const char* operation);
 	void add_special_file_to_disk(const char* dosname, const char* operation);
-	std::string create_filename_of_special_operation(const char* dosname, const char* operation);
+	std::string create_filename_of_special_operation(const char* dosname, const char* operation) const;
 	void convert_overlay_to_DOSname_in_base(char* dirname );
 	//For caching the update_cache routine.
-	std::vector<std::string> DOSnames_cache; //Also set is probably better.
+	std::unordered_set<std::string> DOSnames_cache;
 	std::vector<std::string> DOSdirs_cache; //Can not blindly change its type. it is important that subdirs come after the parent directory.
+	std::unordered_set<std::string> DOSdirs_index; //Lookups into DOSdirs_cache.
 	const std::string special_prefix;
+
+	// The state above is kept in a journal in the overlay folder, so
+	// mounting only replays the changes instead of scanning the overlay
+	bool load_journal();
+	bool is_journal_on_disk() const;
+	void write_journal();
+	void append_to_journal(const char op, const char kind, const char* name);
+	std::string get_journal_path() const;
+
+	size_t journal_entries = 0;
+	bool is_journal_active = false;
 };
 
 #pragma GCC diagnostic pop
@@ -0,0 +1,199 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_FRAME_FIFO_H
+#define DOSBOX_FRAME_FIFO_H
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/*  Frame FIFO
+ *  ----------
+ *  A growable first-in, first-out queue of audio frames (or samples) backed
+ *  by a single contiguous ring buffer.
+ *
+ *  Cycle-accurate audio devices queue frames one at a time as the emulated
+ *  program writes to their ports, then drain the whole backlog when the mixer
+ *  requests audio. Unlike std::queue (a std::deque), the queued frames can be
+ *  handed to the mixer as at most two contiguous spans, so each drain costs
+ *  one or two bulk AddSamples calls instead of one per frame.
+ *
+ *  Mixer channels also use it to hold their converted output between the
+ *  device callbacks and the mixer, which appends at the back (in-place, via
+ *  GetWriteSpan()) and consumes from the front without moving the remainder.
+ *
+ *  The capacity is kept at a power of two and doubles when full, so steady
+ *  state operation doesn't allocate. Not thread-safe; callers are expected to
+ *  hold their device mutex.
+ */
+
+template <typename T>
+class FrameFifo {
+public:
+	FrameFifo() : FrameFifo(DefaultCapacity) {}
+
+	explicit FrameFifo(const size_t initial_capacity)
+	        : buffer(std::bit_ceil(std::max(initial_capacity, size_t(1))))
+	{}
+
+	size_t Size() const
+	{
+		return num_items;
+	}
+
+	bool IsEmpty() const
+	{
+		return num_items == 0;
+	}
+
+	size_t Capacity() const
+	{
+		return buffer.size();
+	}
+
+	// Grows the buffer, if needed, so at least 'min_capacity' items fit
+	void Reserve(const size_t min_capacity)
+	{
+		if (min_capacity > buffer.size()) {
+			Grow(std::bit_ceil(min_capacity));
+		}
+	}
+
+	// Accesses the queued items by position; 0 is the oldest item
+	T& operator[](const size_t index)
+	{
+		assert(index < num_items);
+		return buffer[WrapIndex(head + index)];
+	}
+
+	const T& operator[](const size_t index) const
+	{
+		assert(index < num_items);
+		return buffer[WrapIndex(head + index)];
+	}
+
+	void Clear()
+	{
+		head      = 0;
+		num_items = 0;
+	}
+
+	void Enqueue(const T& item)
+	{
+		if (num_items == buffer.size()) {
+			Grow(buffer.size() * 2);
+		}
+		buffer[WrapIndex(head + num_items)] = item;
+		++num_items;
+	}
+
+	void Enqueue(std::span<const T> items)
+	{
+		while (!items.empty()) {
+			const auto run = GetWriteSpan(items.size());
+			std::copy_n(items.begin(), run.size(), run.begin());
+			CommitWrite(run.size());
+			items = items.subspan(run.size());
+		}
+	}
+
+	// Returns a contiguous run of up to 'max_items' free slots after the
+	// newest item, first growing the buffer if fewer than 'max_items' slots
+	// are free. Fewer slots are returned when the free region wraps around
+	// the end of the buffer. Fill them, then call CommitWrite() with the
+	// number of items written.
+	std::span<T> GetWriteSpan(const size_t max_items)
+	{
+		if (max_items == 0) {
+			return {};
+		}
+		Reserve(num_items + max_items);
+
+		const auto tail = WrapIndex(head + num_items);
+		const auto run_size = (tail >= head) ? buffer.size() - tail
+		                                     : head - tail;
+		return {buffer.data() + tail, std::min(max_items, run_size)};
+	}
+
+	// Appends the 'num' items written into the last GetWriteSpan()
+	void CommitWrite(const size_t num)
+	{
+		assert(num <= buffer.size() - num_items);
+		num_items += num;
+	}
+
+	// Returns the oldest contiguous run of up to 'max_items' queued items.
+	// Fewer items than queued can be returned when the run wraps around the
+	// end of the buffer, so callers should loop until they've consumed what
+	// they need.
+	std::span<const T> Front(const size_t max_items) const
+	{
+		const auto run_to_end = buffer.size() - head;
+		const auto run_size = std::min({max_items, num_items, run_to_end});
+		return {buffer.data() + head, run_size};
+	}
+
+	// Removes 'num' items from the front; 'num' cannot exceed the size
+	void Discard(const size_t num)
+	{
+		assert(num <= num_items);
+		head = WrapIndex(head + num);
+		num_items -= num;
+		if (num_items == 0) {
+			// Restart at the beginning so the next drain is a
+			// single contiguous span
+			head = 0;
+		}
+	}
+
+private:
+	static constexpr size_t DefaultCapacity = 512;
+
+	size_t WrapIndex(const size_t index) const
+	{
+		return index & (buffer.size() - 1);
+	}
+
+	void Grow(const size_t new_capacity)
+	{
+		assert(std::has_single_bit(new_capacity));
+		assert(new_capacity > buffer.size());
+		std::vector<T> grown(new_capacity);
+
+		const auto first = Front(num_items);
+		const auto second_size = num_items - first.size();
+
+		std::copy(first.begin(), first.end(), grown.begin());
+		std::copy_n(buffer.begin(), second_size, grown.begin() + first.size());
+
+		buffer = std::move(grown);
+		head   = 0;
+	}
+
+	std::vector<T> buffer = {};
+	size_t head           = 0;
+	size_t num_items      = 0;
+};
+
+#endif
@@ -31,6 +31,7 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
@@ -39,6 +40,7 @@
 #include "audio_frame.h"
 #include "control.h"
 #include "envelope.h"
+#include "frame_fifo.h"
 #include "math_utils.h"
 
 #include <Iir.h>
@@ -258,6 +260,11 @@ public:
 	void AddSamples_m16u_nonnative(const int num_frames, const uint16_t* data);
 	void AddSamples_s16u_nonnative(const int num_frames, const uint16_t* data);
 
+	// Block variants for devices that queue their frames; the whole span
+	// is converted, resampled, and filtered under a single lock.
+	void AddSamples_mfloat(const std::span<const float> samples);
+	void AddSamples_sfloat(const std::span<const AudioFrame> frames);
+
 	void AddStretched(const int num_frames, int16_t* data);
 
 	void Enable(const bool should_enable);
@@ -265,7 +272,8 @@ public:
 	// Pass-through to the sleeper
 	bool WakeUp();
 
-	std::vector<AudioFrame> audio_frames = {};
+	// Converted output waiting to be mixed
+	FrameFifo<AudioFrame> audio_frames = {};
 	std::recursive_mutex mutex = {};
 
 	std::atomic<bool> is_enabled = false;
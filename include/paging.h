@@ -21,6 +21,7 @@
 
 #include "dosbox.h"
 #include "debug.h"
+#include <algorithm>
 #include <vector>
 
 #include "mem.h"
@@ -51,6 +52,7 @@ class PageDirectory;
 #define PFLAG_INIT			0x20			//No dynamic code can be generated here
 #define PFLAG_HASCODE16		0x40			//Page contains 16-bit dynamic code
 #define PFLAG_HASCODE		(PFLAG_HASCODE32|PFLAG_HASCODE16)
+#define PFLAG_BLOCKWRITE	0x80			//Handler takes block writes of string runs
 
 #define LINK_START	((1024+64)/4)			//Start right after the HMA
 
@@ -80,6 +82,21 @@ public:
 	virtual bool writed_checked(PhysPt addr, uint32_t val);
 	virtual bool writeq_checked(PhysPt addr, uint64_t val);
 
+	// Called after a device (e.g. DMA) wrote a block of bytes directly into
+	// the page's host memory, bypassing the write handlers above
+	virtual void NotifyBlockWritten(PhysPt addr, size_t num_bytes);
+
+	// Forward runs of REP STOS and REP MOVS elements of 'width' bytes that
+	// lie within the page, for handlers flagged with PFLAG_BLOCKWRITE. The
+	// results must match writing the elements one at a time; the defaults
+	// do just that. WriteBlock() takes the source from host memory, while
+	// CopyBlock() reads it through this handler.
+	virtual void FillBlock(PhysPt addr, uint32_t val, uint8_t width,
+	                       uint32_t count);
+	virtual void WriteBlock(PhysPt addr, const uint8_t* data, uint8_t width,
+	                        uint32_t count);
+	virtual void CopyBlock(PhysPt dest, PhysPt src, uint8_t width, uint32_t count);
+
 	uint_fast8_t flags = 0x0;
 };
 
@@ -256,6 +273,29 @@ bool mem_unalignedwritew_checked(PhysPt address,uint16_t val);
 bool mem_unalignedwrited_checked(PhysPt address,uint32_t val);
 bool mem_unalignedwriteq_checked(PhysPt address, uint64_t val);
 
+/* Block writes for forward runs of string instructions; these return false if
+   the destination page doesn't take them, so the run has to be done an element
+   at a time */
+bool mem_fill_block(PhysPt address, uint32_t val, uint8_t width, uint32_t count);
+bool mem_copy_block(PhysPt dest, PhysPt src, uint8_t width, uint32_t count);
+
+// Returns how many elements starting at the index fit before the end of the
+// page or the wrap-around of the index, but at least one
+static inline uint32_t mem_elements_in_page(const PhysPt base,
+                                            const uint32_t index,
+                                            const uint32_t add_mask,
+                                            const uint8_t width,
+                                            const uint32_t count)
+{
+	const uint64_t to_wrap = uint64_t{add_mask - index} / width + 1;
+	const uint64_t to_page_end = (MEM_PAGE_SIZE -
+	                              ((base + index) & (MEM_PAGE_SIZE - 1))) /
+	                             width;
+
+	const auto num_elements = std::min({uint64_t{count}, to_wrap, to_page_end});
+	return std::max(static_cast<uint32_t>(num_elements), 1u);
+}
+
 #if defined(USE_FULL_TLB)
 
 inline HostPt* PAGING_GetReadBaseAddress()
@@ -66,10 +66,16 @@ void PIC_DeActivateIRQ(uint8_t irq);
 void PIC_runIRQs();
 bool PIC_RunQueue();
 
+// Identifies a single scheduled event. IDs stay unique after the event fires
+// or is removed, so removing by a stale ID is a harmless no-op.
+using PIC_EventId = uint64_t;
+
 //Delay in milliseconds
-void PIC_AddEvent(PIC_EventHandler handler, double delay, uint32_t val = 0);
+PIC_EventId PIC_AddEvent(PIC_EventHandler handler, double delay, uint32_t val = 0);
+void PIC_RemoveEvent(PIC_EventId id);
 void PIC_RemoveEvents(PIC_EventHandler handler);
 void PIC_RemoveSpecificEvents(PIC_EventHandler handler, uint32_t val);
 
 void PIC_SetIRQMask(uint32_t irq, bool masked);
+bool PIC_IsIRQMasked(uint32_t irq);
 #endif
@@ -0,0 +1,138 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SPSC_QUEUE_H
+#define DOSBOX_SPSC_QUEUE_H
+
+#include "dosbox.h"
+
+/*  SPSC (Single-Producer, Single-Consumer) Queue
+ *  ---------------------------------------------
+ *  A fixed-size, lock-free ring buffer variant of the RWQueue for exactly one
+ *  producer thread and one consumer thread, such as the audio paths between
+ *  the mixer and the SDL audio callback or between a MIDI synth's render
+ *  thread and the mixer.
+ *
+ *  The non-blocking calls never lock or allocate and are wait-free, so they
+ *  are safe to use from real-time threads. The blocking calls park the thread
+ *  on an atomic until the other side makes progress or the queue is stopped.
+ *
+ *  Items are copied in and out, so T must be trivially copyable. The readable
+ *  and writable regions can also be accessed in-place as (at most) two
+ *  contiguous spans, which avoids intermediate buffers.
+ *
+ *  Resize() and Clear() are the exceptions: they must not run concurrently
+ *  with the consumer (and Resize() also not with the producer).
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+template <typename T>
+class SPSCQueue {
+	static_assert(std::is_trivially_copyable_v<T>,
+	              "SPSCQueue items must be trivially copyable");
+
+public:
+	// A region of the ring buffer that may wrap around its end
+	struct Spans {
+		std::span<T> first  = {};
+		std::span<T> second = {};
+
+		size_t size() const
+		{
+			return first.size() + second.size();
+		}
+	};
+
+	SPSCQueue()                                        = delete;
+	SPSCQueue(const SPSCQueue<T>& other)               = delete;
+	SPSCQueue<T>& operator=(const SPSCQueue<T>& other) = delete;
+
+	SPSCQueue(size_t queue_capacity);
+
+	// Not thread-safe; neither side may be using the queue
+	void Resize(size_t queue_capacity);
+
+	// Must not run concurrently with the consumer
+	void Clear();
+
+	// non-blocking calls
+	bool IsEmpty() const;
+	bool IsRunning() const;
+	size_t Size() const;
+	size_t MaxCapacity() const;
+	float GetPercentFull() const;
+	void Start();
+	void Stop();
+
+	// Producer side
+	// ~~~~~~~~~~~~~
+	// Returns the free region; fill it then call CommitWrite() with the
+	// number of items written.
+	Spans GetWriteSpans();
+	void CommitWrite(size_t num_items);
+
+	// Copies as many items as fit and returns the number enqueued.
+	size_t NonblockingBulkEnqueue(std::span<const T> from_source);
+
+	// Blocks until all items are enqueued. Returns false if the queue was
+	// stopped before or during the call; items queued before stopping
+	// remain in the queue.
+	bool BulkEnqueue(std::span<const T> from_source);
+
+	// Consumer side
+	// ~~~~~~~~~~~~~
+	// Returns the readable region; consume it then call CommitRead() with
+	// the number of items read.
+	Spans GetReadSpans();
+	void CommitRead(size_t num_items);
+
+	// Copies as many items as are available and returns the number
+	// dequeued.
+	size_t NonblockingBulkDequeue(std::span<T> into_target);
+
+	// Blocks until the target is filled. If the queue is stopped, the
+	// remaining items are still drained, so fewer items than requested are
+	// returned only once the queue has stopped.
+	size_t BulkDequeue(std::span<T> into_target);
+
+private:
+	Spans MakeSpans(uint64_t start_index, size_t num_items);
+
+	std::vector<T> buffer = {};
+	size_t capacity       = 0;
+
+	// Monotonic item counters; their difference is the queue size. Each is
+	// written by only one side.
+	alignas(64) std::atomic<uint64_t> write_index = 0;
+	alignas(64) std::atomic<uint64_t> read_index  = 0;
+
+	// Bumped after every change that a blocked side might wait on
+	alignas(64) std::atomic<uint32_t> items_event = 0;
+	alignas(64) std::atomic<uint32_t> room_event  = 0;
+
+	std::atomic<bool> is_running = true;
+};
+
+#endif
@@ -26,6 +26,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "bgrx8888.h"
 #include "bit_view.h"
@@ -35,9 +36,12 @@
 #include "rgb666.h"
 #include "video.h"
 
-//Don't enable keeping changes and mapping lfb probably...
+// Map the linear framebuffer and the chained SVGA modes straight into host
+// memory; the CPU then writes them without going through a page handler, so
+// these modes can't keep track of the changed video memory.
 #define VGA_LFB_MAPPED
-//#define VGA_KEEP_CHANGES
+
+// Size of the pages the changed video memory is tracked in (512 bytes)
 #define VGA_CHANGE_SHIFT	9
 
 class PageHandler;
@@ -1043,6 +1047,54 @@ struct VgaLfb {
 	PageHandler* handler = nullptr;
 };
 
+// Keeps track of the video memory pages the CPU has written to, so the
+// scanlines drawn from untouched pages can be passed to the renderer as
+// unchanged without drawing, comparing, or copying them.
+//
+// The pages are in the address space the line drawers read from (i.e., the
+// planar modes use the expanded 'fastmem' offsets), and each page holds the
+// number of the frame it was last written in. This avoids having to clear
+// the map every frame.
+struct VgaChanges {
+	std::vector<uint32_t> pages = {};
+
+	// Incremented at the start of every rendered frame
+	uint32_t frame = 0;
+
+	// Pages last written in this frame or later might differ from what the
+	// renderer has cached
+	uint32_t first_unseen_frame = 0;
+
+	// Source bytes drawn per scanline
+	uint32_t line_bytes = 0;
+
+	// The installed page handlers see every write to video memory
+	bool is_tracking = false;
+
+	// Lines drawn from unchanged pages are skipped in the current frame
+	bool skip_unchanged_lines = false;
+
+	// The previous frame was drawn from start to end
+	bool is_previous_frame_complete = false;
+
+	// Something other than a video memory write changed the picture, such
+	// as the palette
+	bool needs_full_frame = true;
+
+	// The state that maps the scanlines to video memory; the pages can only
+	// be relied on if it's the same as in the previous frame
+	struct DrawState {
+		Bitu address            = 0;
+		Bitu address_add        = 0;
+		Bitu split_line         = 0;
+		uint8_t* linear_base    = nullptr;
+		Bitu linear_mask        = 0;
+		bool is_screen_disabled = false;
+
+		bool operator==(const DrawState& other) const = default;
+	} last_draw_state = {};
+};
+
 struct VgaType {
 	// The mode the vga system is in
 	VGAModes mode = {};
@@ -1076,9 +1128,7 @@ struct VgaType {
 	// How much delay to add to video memory I/O in nanoseconds
 	uint16_t vmem_delay_ns = 0;
 
-#ifdef VGA_KEEP_CHANGES
 	VgaChanges changes = {};
-#endif
 
 	VgaLfb lfb = {};
 
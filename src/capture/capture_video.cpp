@@ -20,13 +20,17 @@
  */
 
 #include "capture.h"
+#include "capture_video.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <thread>
 
 #include "math_utils.h"
 #include "mem.h"
 #include "render.h"
+#include "rwqueue.h"
 #include "support.h"
 
 #include "zmbv/zmbv.h"
@@ -38,6 +42,10 @@ static constexpr auto NumAudioChannels = 2;
 
 static constexpr auto AviHeaderSize = 500;
 
+// How many frames can be waiting for the encoder before the emulation thread
+// has to wait for it to catch up
+static constexpr auto MaxQueuedFrames = 8;
+
 static struct {
 	FILE* handle = nullptr;
 
@@ -63,6 +71,20 @@ static struct {
 	} audio = {};
 } video = {};
 
+// Frames are encoded and written to the AVI file by a dedicated encoder
+// thread, so the emulation thread only pays for copying the rendered image.
+// The encoder owns the 'video' state while it's running; the emulation thread
+// only touches it again after joining the encoder.
+static struct {
+	RWQueue<VideoCaptureTask> queue{MaxQueuedFrames};
+	std::thread thread = {};
+	bool is_running    = false;
+
+	// Audio captured since the last queued frame
+	std::vector<int16_t> pending_audio = {};
+	uint32_t audio_sample_rate         = 0;
+} encoder = {};
+
 static ZMBV_FORMAT to_zmbv_format(const PixelFormat format)
 {
 	switch (format) {
@@ -136,7 +158,7 @@ static void add_avi_chunk(const char* tag, const uint32_t size,
 	host_writed(index + 12, size);
 }
 
-void capture_video_finalise()
+static void finalise_avi_file()
 {
 	if (!video.handle) {
 		return;
@@ -301,9 +323,9 @@ void capture_video_finalise()
 	video.handle = nullptr;
 }
 
-void capture_video_add_audio_data(const uint32_t sample_rate,
-                                  const uint32_t num_sample_frames,
-                                  const int16_t* sample_frames)
+static void add_audio_data(const uint32_t sample_rate,
+                           const uint32_t num_sample_frames,
+                           const int16_t* sample_frames)
 {
 	if (!video.handle) {
 		return;
@@ -329,8 +351,12 @@ static void create_avi_file(const uint16_t width, const uint16_t height,
 	if (!video.handle) {
 		return;
 	}
+	// Leave a core each for the emulation and encoder threads
+	const auto num_search_threads = std::clamp(
+	        static_cast<int>(std::thread::hardware_concurrency()) - 2, 0, 3);
+
 	video.codec = new VideoCodec();
-	if (!video.codec->SetupCompress(width, height)) {
+	if (!video.codec->SetupCompress(width, height, num_search_threads)) {
 		return;
 	}
 
@@ -439,7 +465,7 @@ static void compress_raw_frame(const RenderedImage& image)
 	}
 }
 
-void capture_video_add_frame(const RenderedImage& image, const float frames_per_second)
+static void encode_frame(const RenderedImage& image, const float frames_per_second)
 {
 	const auto& src = image.params;
 	assert(src.width <= SCALER_MAXWIDTH);
@@ -458,7 +484,7 @@ void capture_video_add_frame(const RenderedImage& image, const float frames_per_
 	if (video.handle && (video.width != raw_width || video.height != raw_height ||
 	                     video.pixel_format != src.pixel_format ||
 	                     video.frames_per_second != frames_per_second)) {
-		capture_video_finalise();
+		finalise_avi_file();
 	}
 
 	const auto zmbv_format = to_zmbv_format(src.pixel_format);
@@ -507,3 +533,83 @@ void capture_video_add_frame(const RenderedImage& image, const float frames_per_
 		video.audio.buf_frames_used = 0;
 	}
 }
+
+// Runs on the encoder thread
+static void encode_queued_frames()
+{
+	while (auto task = encoder.queue.Dequeue()) {
+		// Queue the audio first; it's written after the frame, and
+		// dropped if the frame starts a new file
+		if (!task->audio.empty()) {
+			add_audio_data(task->audio_sample_rate,
+			               check_cast<uint32_t>(task->audio.size() /
+			                                    NumAudioChannels),
+			               task->audio.data());
+		}
+		encode_frame(task->image, task->frames_per_second);
+		task->image.free();
+	}
+}
+
+static void stop_encoder()
+{
+	if (!encoder.is_running) {
+		return;
+	}
+
+	// Let the encoder finish the queued frames
+	encoder.queue.Stop();
+	if (encoder.thread.joinable()) {
+		encoder.thread.join();
+	}
+	encoder.queue.Start();
+
+	encoder.pending_audio.clear();
+	encoder.is_running = false;
+}
+
+void capture_video_add_frame(const RenderedImage& image, const float frames_per_second)
+{
+	if (!encoder.is_running) {
+		encoder.thread = std::thread(encode_queued_frames);
+		set_thread_name(encoder.thread, "dosbox:vidcap");
+		encoder.is_running = true;
+	}
+
+	VideoCaptureTask task = {};
+
+	// The render buffers are reused for the next frame, so the encoder
+	// needs its own copy
+	task.image             = image.deep_copy();
+	task.frames_per_second = frames_per_second;
+	task.audio_sample_rate = encoder.audio_sample_rate;
+	std::swap(task.audio, encoder.pending_audio);
+
+	encoder.queue.Enqueue(std::move(task));
+}
+
+void capture_video_add_audio_data(const uint32_t sample_rate,
+                                  const uint32_t num_sample_frames,
+                                  const int16_t* sample_frames)
+{
+	// Like the encoder, start collecting audio from the first frame
+	if (!encoder.is_running) {
+		return;
+	}
+
+	// The encoder can only hold a limited number of frames per chunk
+	const auto frames_used = encoder.pending_audio.size() / NumAudioChannels;
+	const auto frames_left = std::min(static_cast<size_t>(num_sample_frames),
+	                                  NumSampleFramesInBuffer - frames_used);
+
+	encoder.pending_audio.insert(encoder.pending_audio.end(),
+	                             sample_frames,
+	                             sample_frames + frames_left * NumAudioChannels);
+	encoder.audio_sample_rate = sample_rate;
+}
+
+void capture_video_finalise()
+{
+	stop_encoder();
+	finalise_avi_file();
+}
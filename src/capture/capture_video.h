@@ -22,8 +22,22 @@
 #ifndef DOSBOX_CAPTURE_VIDEO_H
 #define DOSBOX_CAPTURE_VIDEO_H
 
+#include <cstdint>
+#include <vector>
+
 #include "render.h"
 
+// A frame queued for the video encoder thread, along with the audio captured
+// since the previous frame. The encoder frees the image after encoding it.
+struct VideoCaptureTask {
+	RenderedImage image     = {};
+	float frames_per_second = 0.0f;
+
+	// Interleaved 16-bit stereo sample frames
+	std::vector<int16_t> audio = {};
+	uint32_t audio_sample_rate = 0;
+};
+
 void capture_video_add_frame(const RenderedImage& image,
                              const float frames_per_second);
 
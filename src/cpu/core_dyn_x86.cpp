@@ -358,6 +358,7 @@ restart_core:
 	}
 run_block:
 	cache.block.running=nullptr;
+	block->CountExecution();
 	const auto ret = sync_normal_fpu_and_run_dyn_code(block->cache.start);
 #	if C_DEBUG
 	cycle_count += 32;
@@ -515,6 +516,16 @@ void CPU_Core_Dyn_X86_Cache_Close(void) {
 	cache_close();
 }
 
+void CPU_Core_Dyn_X86_Cache_SetMaxSize(const size_t num_bytes)
+{
+	cache_set_max_size(num_bytes);
+}
+
+CPU_DynamicCacheStats CPU_Core_Dyn_X86_Cache_GetStats()
+{
+	return cache_get_stats();
+}
+
 void CPU_Core_Dyn_X86_SetFPUMode(bool dh_fpu) {
 #if defined(X86_DYNFPU_DH_ENABLED)
 	dyn_dh_fpu.dh_fpu_enabled=dh_fpu;
@@ -28,6 +28,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 
 #include <type_traits>
 
@@ -281,6 +282,7 @@ Bits CPU_Core_Dynrec_Run() noexcept
 
 run_block:
 		cache.block.running=nullptr;
+		block->CountExecution();
 		// now we're ready to run the dynamic code block
 //		BlockReturn ret=((BlockReturn (*)(void))(block->cache.start))();
 		BlockReturn ret=core_dynrec.runcode(block->cache.start);
@@ -393,4 +395,14 @@ void CPU_Core_Dynrec_Cache_Close(void) {
 	cache_close();
 }
 
+void CPU_Core_Dynrec_Cache_SetMaxSize(const size_t num_bytes)
+{
+	cache_set_max_size(num_bytes);
+}
+
+CPU_DynamicCacheStats CPU_Core_Dynrec_Cache_GetStats()
+{
+	return cache_get_stats();
+}
+
 #endif
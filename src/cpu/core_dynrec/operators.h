@@ -1648,6 +1648,87 @@ static void DRC_CALL_CONV dynrec_std(void) {
 }
 
 
+// Forward runs are stored a page at a time, so page handlers that take block
+// writes (such as the planar VGA modes) get each run in a single call
+template <typename T>
+static inline T dynrec_string_read(const PhysPt addr)
+{
+	if constexpr (sizeof(T) == 1) {
+		return mem_readb(addr);
+	} else if constexpr (sizeof(T) == 2) {
+		return mem_readw(addr);
+	} else {
+		return mem_readd(addr);
+	}
+}
+
+template <typename T>
+static inline void dynrec_string_write(const PhysPt addr, const T val)
+{
+	if constexpr (sizeof(T) == 1) {
+		mem_writeb(addr, val);
+	} else if constexpr (sizeof(T) == 2) {
+		mem_writew(addr, val);
+	} else {
+		mem_writed(addr, val);
+	}
+}
+
+template <typename T, typename index_t, typename add_t>
+static inline void dynrec_string_movs(index_t count, const add_t add_index,
+                                      const PhysPt si_base, const PhysPt di_base,
+                                      index_t& si, index_t& di)
+{
+	constexpr uint8_t width = sizeof(T);
+	constexpr uint32_t add_mask = std::numeric_limits<index_t>::max();
+	while (count > 0) {
+		index_t run = count;
+		if (add_index > 0) {
+			run = static_cast<index_t>(std::min(
+			        mem_elements_in_page(si_base, si, add_mask, width, count),
+			        mem_elements_in_page(di_base, di, add_mask, width, count)));
+			if (run > 1 &&
+			    mem_copy_block(di_base + di, si_base + si, width, run)) {
+				si = static_cast<index_t>(si + run * width);
+				di = static_cast<index_t>(di + run * width);
+				count -= run;
+				continue;
+			}
+		}
+		for (; run > 0; --run, --count) {
+			dynrec_string_write(di_base + di,
+			                    dynrec_string_read<T>(si_base + si));
+			si = static_cast<index_t>(si + add_index);
+			di = static_cast<index_t>(di + add_index);
+		}
+	}
+}
+
+template <typename T, typename index_t, typename add_t>
+static inline void dynrec_string_stos(index_t count, const add_t add_index,
+                                      const PhysPt di_base, index_t& di,
+                                      const T val)
+{
+	constexpr uint8_t width = sizeof(T);
+	constexpr uint32_t add_mask = std::numeric_limits<index_t>::max();
+	while (count > 0) {
+		index_t run = count;
+		if (add_index > 0) {
+			run = static_cast<index_t>(mem_elements_in_page(
+			        di_base, di, add_mask, width, count));
+			if (run > 1 && mem_fill_block(di_base + di, val, width, run)) {
+				di = static_cast<index_t>(di + run * width);
+				count -= run;
+				continue;
+			}
+		}
+		for (; run > 0; --run, --count) {
+			dynrec_string_write(di_base + di, val);
+			di = static_cast<index_t>(di + add_index);
+		}
+	}
+}
+
 static uint16_t DRC_CALL_CONV dynrec_movsb_word(uint16_t count,int16_t add_index,PhysPt si_base,PhysPt di_base) DRC_FC;
 static uint16_t DRC_CALL_CONV dynrec_movsb_word(uint16_t count,int16_t add_index,PhysPt si_base,PhysPt di_base) {
 	uint16_t count_left;
@@ -1658,11 +1739,8 @@ static uint16_t DRC_CALL_CONV dynrec_movsb_word(uint16_t count,int16_t add_index
 		count=(uint16_t)CPU_Cycles;
 		CPU_Cycles=0;
 	}
-	for (;count>0;count--) {
-		mem_writeb(di_base+reg_di,mem_readb(si_base+reg_si));
-		reg_si+=add_index;
-		reg_di+=add_index;
-	}
+	dynrec_string_movs<uint8_t>(
+	        count, add_index, si_base, di_base, reg_si, reg_di);
 	return count_left;
 }
 
@@ -1676,11 +1754,8 @@ static uint32_t DRC_CALL_CONV dynrec_movsb_dword(uint32_t count,int32_t add_inde
 		count=CPU_Cycles;
 		CPU_Cycles=0;
 	}
-	for (;count>0;count--) {
-		mem_writeb(di_base+reg_edi,mem_readb(si_base+reg_esi));
-		reg_esi+=add_index;
-		reg_edi+=add_index;
-	}
+	dynrec_string_movs<uint8_t>(
+	        count, add_index, si_base, di_base, reg_esi, reg_edi);
 	return count_left;
 }
 
@@ -1695,11 +1770,8 @@ static uint16_t DRC_CALL_CONV dynrec_movsw_word(uint16_t count,int16_t add_index
 		CPU_Cycles=0;
 	}
 	add_index<<=1;
-	for (;count>0;count--) {
-		mem_writew(di_base+reg_di,mem_readw(si_base+reg_si));
-		reg_si+=add_index;
-		reg_di+=add_index;
-	}
+	dynrec_string_movs<uint16_t>(
+	        count, add_index, si_base, di_base, reg_si, reg_di);
 	return count_left;
 }
 
@@ -1714,11 +1786,8 @@ static uint32_t DRC_CALL_CONV dynrec_movsw_dword(uint32_t count,int32_t add_inde
 		CPU_Cycles=0;
 	}
 	add_index = left_shift_signed(add_index, 1);
-	for (;count>0;count--) {
-		mem_writew(di_base+reg_edi,mem_readw(si_base+reg_esi));
-		reg_esi+=add_index;
-		reg_edi+=add_index;
-	}
+	dynrec_string_movs<uint16_t>(
+	        count, add_index, si_base, di_base, reg_esi, reg_edi);
 	return count_left;
 }
 
@@ -1733,11 +1802,8 @@ static uint16_t DRC_CALL_CONV dynrec_movsd_word(uint16_t count,int16_t add_index
 		CPU_Cycles=0;
 	}
 	add_index = left_shift_signed(add_index, 2);
-	for (;count>0;count--) {
-		mem_writed(di_base+reg_di,mem_readd(si_base+reg_si));
-		reg_si+=add_index;
-		reg_di+=add_index;
-	}
+	dynrec_string_movs<uint32_t>(
+	        count, add_index, si_base, di_base, reg_si, reg_di);
 	return count_left;
 }
 
@@ -1752,11 +1818,8 @@ static uint32_t DRC_CALL_CONV dynrec_movsd_dword(uint32_t count,int32_t add_inde
 		CPU_Cycles=0;
 	}
 	add_index = left_shift_signed(add_index, 2);
-	for (;count>0;count--) {
-		mem_writed(di_base+reg_edi,mem_readd(si_base+reg_esi));
-		reg_esi+=add_index;
-		reg_edi+=add_index;
-	}
+	dynrec_string_movs<uint32_t>(
+	        count, add_index, si_base, di_base, reg_esi, reg_edi);
 	return count_left;
 }
 
@@ -1878,10 +1941,7 @@ static uint16_t DRC_CALL_CONV dynrec_stosb_word(uint16_t count,int16_t add_index
 		count=(uint16_t)CPU_Cycles;
 		CPU_Cycles=0;
 	}
-	for (;count>0;count--) {
-		mem_writeb(di_base+reg_di,reg_al);
-		reg_di+=add_index;
-	}
+	dynrec_string_stos(count, add_index, di_base, reg_di, reg_al);
 	return count_left;
 }
 
@@ -1895,10 +1955,7 @@ static uint32_t DRC_CALL_CONV dynrec_stosb_dword(uint32_t count,int32_t add_inde
 		count=CPU_Cycles;
 		CPU_Cycles=0;
 	}
-	for (;count>0;count--) {
-		mem_writeb(di_base+reg_edi,reg_al);
-		reg_edi+=add_index;
-	}
+	dynrec_string_stos(count, add_index, di_base, reg_edi, reg_al);
 	return count_left;
 }
 
@@ -1913,10 +1970,7 @@ static uint16_t DRC_CALL_CONV dynrec_stosw_word(uint16_t count,int16_t add_index
 		CPU_Cycles=0;
 	}
 	add_index = left_shift_signed(add_index, 1);
-	for (;count>0;count--) {
-		mem_writew(di_base+reg_di,reg_ax);
-		reg_di+=add_index;
-	}
+	dynrec_string_stos(count, add_index, di_base, reg_di, reg_ax);
 	return count_left;
 }
 
@@ -1931,10 +1985,7 @@ static uint32_t DRC_CALL_CONV dynrec_stosw_dword(uint32_t count,int32_t add_inde
 		CPU_Cycles=0;
 	}
 	add_index = left_shift_signed(add_index, 1);
-	for (;count>0;count--) {
-		mem_writew(di_base+reg_edi,reg_ax);
-		reg_edi+=add_index;
-	}
+	dynrec_string_stos(count, add_index, di_base, reg_edi, reg_ax);
 	return count_left;
 }
 
@@ -1949,10 +2000,7 @@ static uint16_t DRC_CALL_CONV dynrec_stosd_word(uint16_t count,int16_t add_index
 		CPU_Cycles=0;
 	}
 	add_index = left_shift_signed(add_index, 2);
-	for (;count>0;count--) {
-		mem_writed(di_base+reg_di,reg_eax);
-		reg_di+=add_index;
-	}
+	dynrec_string_stos(count, add_index, di_base, reg_di, reg_eax);
 	return count_left;
 }
 
@@ -1967,10 +2015,7 @@ static uint32_t DRC_CALL_CONV dynrec_stosd_dword(uint32_t count,int32_t add_inde
 		CPU_Cycles=0;
 	}
 	add_index = left_shift_signed(add_index, 2);
-	for (;count>0;count--) {
-		mem_writed(di_base+reg_edi,reg_eax);
-		reg_edi+=add_index;
-	}
+	dynrec_string_stos(count, add_index, di_base, reg_edi, reg_eax);
 	return count_left;
 }
 
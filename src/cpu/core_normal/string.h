@@ -20,6 +20,90 @@
 
 #define LoadD(_BLAH) _BLAH
 
+template <typename T>
+static inline T load_string_element(const PhysPt addr)
+{
+	if constexpr (sizeof(T) == 1) {
+		return LoadMb(addr);
+	} else if constexpr (sizeof(T) == 2) {
+		return LoadMw(addr);
+	} else {
+		return LoadMd(addr);
+	}
+}
+
+template <typename T>
+static inline void save_string_element(const PhysPt addr, const T val)
+{
+	if constexpr (sizeof(T) == 1) {
+		SaveMb(addr, val);
+	} else if constexpr (sizeof(T) == 2) {
+		SaveMw(addr, val);
+	} else {
+		SaveMd(addr, val);
+	}
+}
+
+// Forward runs are stored a page at a time, so page handlers that take block
+// writes (such as the planar VGA modes) get each run in a single call
+template <typename T>
+static inline void string_stos(const PhysPt di_base, uint32_t& di_index,
+                               const Bits add_index, const uint32_t add_mask,
+                               uint32_t& count, const T val)
+{
+	constexpr uint8_t width = sizeof(T);
+	while (count > 0) {
+		auto run = count;
+		if (add_index > 0) {
+			run = mem_elements_in_page(
+			        di_base, di_index, add_mask, width, count);
+			if (run > 1 &&
+			    mem_fill_block(di_base + di_index, val, width, run)) {
+				di_index = (di_index + run * width) & add_mask;
+				count -= run;
+				continue;
+			}
+		}
+		for (; run > 0; --run, --count) {
+			save_string_element(di_base + di_index, val);
+			di_index = (di_index + add_index * width) & add_mask;
+		}
+	}
+}
+
+template <typename T>
+static inline void string_movs(const PhysPt si_base, uint32_t& si_index,
+                               const PhysPt di_base, uint32_t& di_index,
+                               const Bits add_index, const uint32_t add_mask,
+                               uint32_t& count)
+{
+	constexpr uint8_t width = sizeof(T);
+	while (count > 0) {
+		auto run = count;
+		if (add_index > 0) {
+			run = std::min(mem_elements_in_page(
+			                       si_base, si_index, add_mask, width, count),
+			               mem_elements_in_page(
+			                       di_base, di_index, add_mask, width, count));
+			if (run > 1 && mem_copy_block(di_base + di_index,
+			                              si_base + si_index,
+			                              width,
+			                              run)) {
+				si_index = (si_index + run * width) & add_mask;
+				di_index = (di_index + run * width) & add_mask;
+				count -= run;
+				continue;
+			}
+		}
+		for (; run > 0; --run, --count) {
+			save_string_element(di_base + di_index,
+			                    load_string_element<T>(si_base + si_index));
+			di_index = (di_index + add_index * width) & add_mask;
+			si_index = (si_index + add_index * width) & add_mask;
+		}
+	}
+}
+
 static void DoString(STRING_OP type) {
 	const auto si_base = BaseDS;
 	const auto di_base = SegBase(es);
@@ -92,47 +176,40 @@ static void DoString(STRING_OP type) {
 		}
 		break;
 	case R_STOSB:
-		for (;count>0;count--) {
-			SaveMb(di_base+di_index,reg_al);
-			di_index=(di_index+add_index) & add_mask;
-		}
+		string_stos(di_base, di_index, add_index, add_mask, count, reg_al);
 		break;
 	case R_STOSW:
-		add_index *= 2;
-		for (;count>0;count--) {
-			SaveMw(di_base+di_index,reg_ax);
-			di_index=(di_index+add_index) & add_mask;
-		}
+		string_stos(di_base, di_index, add_index, add_mask, count, reg_ax);
 		break;
 	case R_STOSD:
-		add_index *= 4;
-		for (;count>0;count--) {
-			SaveMd(di_base+di_index,reg_eax);
-			di_index=(di_index+add_index) & add_mask;
-		}
+		string_stos(di_base, di_index, add_index, add_mask, count, reg_eax);
 		break;
 	case R_MOVSB:
-		for (;count>0;count--) {
-			SaveMb(di_base+di_index,LoadMb(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
-		}
+		string_movs<uint8_t>(si_base,
+		                     si_index,
+		                     di_base,
+		                     di_index,
+		                     add_index,
+		                     add_mask,
+		                     count);
 		break;
 	case R_MOVSW:
-		add_index *= 2;
-		for (;count>0;count--) {
-			SaveMw(di_base+di_index,LoadMw(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
-		}
+		string_movs<uint16_t>(si_base,
+		                      si_index,
+		                      di_base,
+		                      di_index,
+		                      add_index,
+		                      add_mask,
+		                      count);
 		break;
 	case R_MOVSD:
-		add_index *= 4;
-		for (;count>0;count--) {
-			SaveMd(di_base+di_index,LoadMd(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
-		}
+		string_movs<uint32_t>(si_base,
+		                      si_index,
+		                      di_base,
+		                      di_index,
+		                      add_index,
+		                      add_mask,
+		                      count);
 		break;
 	case R_LODSB:
 		for (;count>0;count--) {
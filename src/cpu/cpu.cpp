@@ -22,6 +22,7 @@
 #include "cpu.h"
 
 #include <cassert>
+#include <cinttypes>
 #include <cstddef>
 #include <sstream>
 
@@ -92,6 +93,11 @@ static constexpr auto CpuCycleStepMax     = 1'000'000;
 static constexpr auto DefaultCpuCycleUp   = 10;
 static constexpr auto DefaultCpuCycleDown = 20;
 
+// Dynamic core code cache size limits in MB
+static constexpr auto DynamicCacheSizeMin     = 8;
+static constexpr auto DynamicCacheSizeMax     = 512;
+static constexpr auto DefaultDynamicCacheSize = 64;
+
 static int cpu_cycle_up   = 0;
 static int cpu_cycle_down = 0;
 
@@ -119,12 +125,16 @@ void CPU_Core_Simple_Init();
 void CPU_Core_Dyn_X86_Init();
 void CPU_Core_Dyn_X86_Cache_Init(bool enable_cache);
 void CPU_Core_Dyn_X86_Cache_Close();
+void CPU_Core_Dyn_X86_Cache_SetMaxSize(size_t num_bytes);
+CPU_DynamicCacheStats CPU_Core_Dyn_X86_Cache_GetStats();
 void CPU_Core_Dyn_X86_SetFPUMode(bool dh_fpu);
 
 #elif C_DYNREC
 void CPU_Core_Dynrec_Init();
 void CPU_Core_Dynrec_Cache_Init(bool enable_cache);
 void CPU_Core_Dynrec_Cache_Close();
+void CPU_Core_Dynrec_Cache_SetMaxSize(size_t num_bytes);
+CPU_DynamicCacheStats CPU_Core_Dynrec_Cache_GetStats();
 #endif
 
 /* In debug mode exceptions are tested and dosbox exits when
@@ -2719,10 +2729,17 @@ public:
 		CPU_Core_Normal_Init();
 		CPU_Core_Simple_Init();
 		CPU_Core_Full_Init();
+#if C_DYNAMIC_X86 || C_DYNREC
+		const auto secprop = static_cast<Section_prop*>(sec);
+		const auto cache_size = static_cast<size_t>(
+		        secprop->Get_int("dynamic_core_cache_size"));
+#endif
 #if C_DYNAMIC_X86
 		CPU_Core_Dyn_X86_Init();
+		CPU_Core_Dyn_X86_Cache_SetMaxSize(cache_size * 1024 * 1024);
 #elif C_DYNREC
 		CPU_Core_Dynrec_Init();
+		CPU_Core_Dynrec_Cache_SetMaxSize(cache_size * 1024 * 1024);
 #endif
 		MAPPER_AddHandler(cpu_decrease_cycles,
 		                  SDL_SCANCODE_F11,
@@ -3211,8 +3228,31 @@ bool Cpu::initialised = false;
 
 static std::unique_ptr<Cpu> cpu_instance = nullptr;
 
+CPU_DynamicCacheStats CPU_GetDynamicCacheStats()
+{
+#if C_DYNAMIC_X86
+	return CPU_Core_Dyn_X86_Cache_GetStats();
+#elif C_DYNREC
+	return CPU_Core_Dynrec_Cache_GetStats();
+#else
+	return {};
+#endif
+}
+
 static void cpu_shutdown([[maybe_unused]] Section* sec)
 {
+	const auto stats = CPU_GetDynamicCacheStats();
+	if (stats.translations > 0) {
+		LOG_MSG("CPU: Dynamic core translated %" PRIu64 " blocks, evicted %" PRIu64
+		        ", invalidated %" PRIu64 "; %zu blocks use %zu of %zu kB",
+		        stats.translations,
+		        stats.evictions,
+		        stats.invalidations,
+		        stats.num_blocks,
+		        stats.used_bytes / 1024,
+		        stats.total_bytes / 1024);
+	}
+
 #if C_DYNAMIC_X86
 	CPU_Core_Dyn_X86_Cache_Close();
 #elif C_DYNREC
@@ -3378,7 +3418,19 @@ void init_cpu_dosbox_settings(Section_prop& secprop)
 	        "millisecond can vary; this might cause issues in some DOS programs.",
 	        (CpuThrottleDefault ? "enabled" : "disabled")));
 
-	auto pint = secprop.Add_int("cycleup", Always, DefaultCpuCycleUp);
+	auto pint = secprop.Add_int("dynamic_core_cache_size",
+	                            Property::Changeable::OnlyAtStart,
+	                            DefaultDynamicCacheSize);
+	pint->SetMinMax(DynamicCacheSizeMin, DynamicCacheSizeMax);
+	pint->Set_help(format_str(
+	        "Maximum size of the 'dynamic' core's code cache in MB (%d by default).\n"
+	        "The cache starts at %d MB and grows as needed up to this size. When it's\n"
+	        "full, the least used code is replaced first. Larger values help Windows 3.x\n"
+	        "and 9x sessions that run a lot of different code.",
+	        DefaultDynamicCacheSize,
+	        DynamicCacheSizeMin));
+
+	pint = secprop.Add_int("cycleup", Always, DefaultCpuCycleUp);
 	pint->SetMinMax(CpuCycleStepMin, CpuCycleStepMax);
 	pint->Set_help(
 	        format_str("Number of cycles to add with the 'Inc Cycles' hotkey (%d by default).\n"
@@ -19,11 +19,15 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cerrno>
+#include <cinttypes>
+#include <memory>
 #include <new>
 #include <type_traits>
+#include <vector>
 
 #include "mem_unaligned.h"
 #include "object_pool.h"
@@ -118,6 +122,17 @@ public:
 	} link[2] = {};                // maximum two links (conditional jumps)
 
 	CacheBlock* crossblock = {};
+
+	// number of times the block was entered from the core's run loop,
+	// halved whenever the block survives an eviction pass
+	uint32_t exec_count = 0;
+
+	void CountExecution()
+	{
+		if (exec_count < UINT32_MAX) {
+			++exec_count;
+		}
+	}
 };
 
 static_assert(std::is_standard_layout_v<CacheBlock::Page>, "standard-layout is required for offsetof");
@@ -148,14 +163,32 @@ static struct {
 	CodePageHandler* last_page  = {}; // the last used page
 } cache = {};
 
+static struct {
+	uint64_t translations  = 0; // blocks translated
+	uint64_t evictions     = 0; // blocks dropped to make room for new ones
+	uint64_t invalidations = 0; // blocks dropped due to modified code
+} cache_stats = {};
+
 // cache memory pointers, to be malloc'd later
 static uint8_t* cache_code_start_ptr   = {};
 static uint8_t* cache_code             = {};
 static uint8_t* cache_code_link_blocks = {};
 
-static std::vector<CacheBlock> cache_blocks(CACHE_BLOCKS);
+// the code cache starts out at CACHE_TOTAL bytes and grows by the same
+// amount whenever it fills up, until it reaches the maximum size
+static size_t cache_code_total     = 0;
+static size_t cache_code_max_total = CACHE_TOTAL;
+
+// blocks are allocated in chunks as they're needed; they must never move
+// as the generated code refers to them directly
+static std::vector<std::unique_ptr<CacheBlock[]>> cache_blocks = {};
 static CacheBlock link_blocks[2] = {}; // default linking (specially marked)
 
+// a block entered at least this often is kept when looking for space
+constexpr uint32_t HotBlockThreshold = 4;
+// the number of hot blocks to skip before evicting one anyway
+constexpr int MaxHotBlockSkips = 64;
+
 // Use an object pool to manage the invalidation maps
 class InvalidationMapPool {
 private:
@@ -243,6 +276,7 @@ public:
 					block->Clear(); // clear the block,
 					                // decrements the
 					                // write_map accordingly
+					++cache_stats.invalidations;
 				}
 				block=nextblock;
 			}
@@ -503,6 +537,18 @@ public:
 		}
 	}
 
+	// a block was copied into the page behind our back (by DMA), so
+	// clear out the cache blocks it overlaps in one go
+	void NotifyBlockWritten(PhysPt addr, const size_t num_bytes) override
+	{
+		if (!num_bytes) {
+			return;
+		}
+		const Bitu start = addr & 4095;
+		const Bitu end = std::min<Bitu>(start + num_bytes, 4096) - 1;
+		InvalidateRange(start, end);
+	}
+
 	void Release()
 	{
 		// revert to old handler
@@ -587,12 +633,25 @@ static inline void cache_add_unused_block(CacheBlock *block)
 	cache.block.free = block;
 }
 
+static void cache_add_block_chunk(const size_t num_blocks)
+{
+	auto chunk = std::make_unique<CacheBlock[]>(num_blocks);
+	for (size_t i = 0; i < num_blocks; ++i) {
+		chunk[i].link[0].to = (CacheBlock *)1;
+		chunk[i].link[1].to = (CacheBlock *)1;
+		cache_add_unused_block(&chunk[i]);
+	}
+	cache_blocks.push_back(std::move(chunk));
+}
+
 static CacheBlock *cache_getblock()
 {
 	// get a free cache block and advance the free pointer
+	if (!cache.block.free) {
+		// all blocks are in use, add another batch
+		cache_add_block_chunk(CACHE_BLOCKS / 8);
+	}
 	CacheBlock *ret = cache.block.free;
-	if (!ret)
-		E_Exit("Ran out of CacheBlocks");
 	cache.block.free=ret->cache.next;
 	ret->cache.next=nullptr;
 	return ret;
@@ -721,14 +780,58 @@ void CacheBlock::Clear()
 	cache.DeleteWriteMask();
 }
 
-static CacheBlock *cache_openblock()
+// returns the block following this one if there's enough room left in the
+// cache to open a new block there
+static CacheBlock *cache_next_block(const CacheBlock *block)
+{
+#if (C_DYNAMIC_X86)
+	return block->cache.next;
+#elif (C_DYNREC)
+	const uint8_t *limit = (cache_code_start_ptr + cache_code_total - CACHE_MAXSIZE);
+	if (!block->cache.next || (block->cache.next->cache.start > limit))
+		return nullptr;
+	return block->cache.next;
+#endif
+}
+
+// starting at the active block, find room for a new block that doesn't
+// evict hot code. hot blocks that are skipped age, so they're eventually
+// replaced if they're no longer used.
+static CacheBlock *cache_find_cold_block()
 {
 	CacheBlock *block = cache.block.active;
+	for (int skips = 0; skips < MaxHotBlockSkips; skips++) {
+		// look for hot blocks among the ones the new block replaces
+		CacheBlock *last_hot = nullptr;
+		Bitu size = 0;
+		for (auto b = block; b && size < CACHE_MAXSIZE; b = b->cache.next) {
+			size += b->cache.size;
+			if (b->page.handler && b->exec_count >= HotBlockThreshold)
+				last_hot = b;
+			b->exec_count /= 2;
+		}
+		if (!last_hot)
+			break;
+		// continue after the hot block, or wrap around
+		block = cache_next_block(last_hot);
+		if (!block)
+			block = cache.block.first;
+	}
+	return block;
+}
+
+static CacheBlock *cache_openblock()
+{
+	CacheBlock *block = cache_find_cold_block();
+	cache.block.active = block;
+	cache_stats.translations++;
 	// check for enough space in this block
 	Bitu size=block->cache.size;
 	CacheBlock *nextblock = block->cache.next;
-	if (block->page.handler)
+	if (block->page.handler) {
 		block->Clear();
+		cache_stats.evictions++;
+	}
 	// block size must be at least CACHE_MAXSIZE
 	while (size<CACHE_MAXSIZE) {
 		if (!nextblock)
@@ -736,8 +839,10 @@ static CacheBlock *cache_openblock()
 		// merge blocks
 		size+=nextblock->cache.size;
 		CacheBlock *tempblock = nextblock->cache.next;
-		if (nextblock->page.handler)
+		if (nextblock->page.handler) {
 			nextblock->Clear();
+			cache_stats.evictions++;
+		}
 		// block is free now
 		cache_add_unused_block(nextblock);
 		nextblock=tempblock;
@@ -746,10 +851,45 @@ skipresize:
 	// adjust parameters and open this block
 	block->cache.size=size;
 	block->cache.next=nextblock;
+	block->exec_count = 0;
 	cache.pos=block->cache.start;
 	return block;
 }
 
+// add another CACHE_TOTAL bytes to the end of the code cache, unless it's
+// at its maximum size already
+static bool cache_grow(CacheBlock *block)
+{
+	if (cache_code_total + CACHE_TOTAL > cache_code_max_total)
+		return false;
+
+	CacheBlock *last = block;
+	while (last->cache.next)
+		last = last->cache.next;
+
+	if (last == block) {
+		// the last block may have run past its end, keep that code
+		const auto written = (Bitu)(cache.pos - block->cache.start);
+		if (written > block->cache.size)
+			block->cache.size = ((written - 1) | (CACHE_ALIGN - 1)) + 1;
+	}
+	cache_code_total += CACHE_TOTAL;
+	const uint8_t *end = cache_code + cache_code_total;
+
+	if (last->page.handler) {
+		CacheBlock *newblock = cache_getblock();
+		newblock->cache.start = last->cache.start + last->cache.size;
+		newblock->cache.size = (Bitu)(end - newblock->cache.start);
+		newblock->cache.next = nullptr;
+		last->cache.next = newblock;
+	} else {
+		last->cache.size = (Bitu)(end - last->cache.start);
+	}
+	LOG_MSG("DYNCACHE: Code cache grown to %d MB",
+	        static_cast<int>(cache_code_total / (1024 * 1024)));
+	return true;
+}
+
 static void cache_closeblock()
 {
 	CacheBlock *block = cache.block.active;
@@ -787,19 +927,44 @@ static void cache_closeblock()
 		}
 	}
 	// advance the active block pointer
-#if (C_DYNAMIC_X86)
-	const bool cache_is_full = !block->cache.next;
-#elif (C_DYNREC)
-	const uint8_t *limit = (cache_code_start_ptr + CACHE_TOTAL - CACHE_MAXSIZE);
-	const bool cache_is_full = (!block->cache.next ||
-	                            (block->cache.next->cache.start > limit));
-#endif
-	if (cache_is_full) {
+	CacheBlock *nextblock = cache_next_block(block);
+	if (!nextblock && cache_grow(block))
+		nextblock = cache_next_block(block);
+	if (!nextblock) {
 		// LOG_DEBUG("Cache full; restarting");
+		// cache_openblock() skips past the hot blocks from here
 		cache.block.active=cache.block.first;
 	} else {
-		cache.block.active=block->cache.next;
+		cache.block.active=nextblock;
+	}
+}
+
+static void cache_set_max_size(const size_t num_bytes)
+{
+	// the cache memory is only allocated once
+	if (cache_code_start_ptr)
+		return;
+	// round up to whole growth steps
+	const auto num_steps = std::max(num_bytes, size_t{CACHE_TOTAL}) +
+	                       CACHE_TOTAL - 1;
+	cache_code_max_total = num_steps - (num_steps % CACHE_TOTAL);
+}
+
+static CPU_DynamicCacheStats cache_get_stats()
+{
+	CPU_DynamicCacheStats stats = {};
+	stats.translations  = cache_stats.translations;
+	stats.evictions     = cache_stats.evictions;
+	stats.invalidations = cache_stats.invalidations;
+	for (auto block = cache.block.first; block; block = block->cache.next) {
+		if (block->page.handler) {
+			stats.num_blocks++;
+			stats.used_bytes += block->cache.size;
+		}
 	}
+	stats.total_bytes     = cache_code_total;
+	stats.max_total_bytes = cache_code_max_total;
+	return stats;
 }
 
 // TODO functions cache_addb, cache_addw, cache_addd, cache_addq definitely
@@ -874,7 +1039,10 @@ static void cache_block_before_close();
 static void cache_block_closing(const uint8_t *block_start, Bitu block_size);
 #endif
 
-static constexpr size_t cache_code_size = CACHE_TOTAL + CACHE_MAXSIZE + host_pagesize - 1 + host_pagesize;
+static size_t get_cache_code_size()
+{
+	return cache_code_max_total + CACHE_MAXSIZE + host_pagesize - 1 + host_pagesize;
+}
 constexpr bool is_64bit_platform = sizeof(void *) == 8;
 
 static inline void dyn_mem_adjust(void *&ptr, size_t &size)
@@ -991,14 +1159,10 @@ static void cache_init(bool enable) {
 			return;
 		}
 		cache_initialized = true;
-		cache.block.free = &cache_blocks[0];
 		// initialize the cache blocks
-		for (int i=0;i<CACHE_BLOCKS-1;i++) {
-			cache_blocks[i].link[0].to = (CacheBlock *)1;
-			cache_blocks[i].link[1].to = (CacheBlock *)1;
-			cache_blocks[i].cache.next = &cache_blocks[i + 1];
-		}
+		cache_add_block_chunk(CACHE_BLOCKS);
 		if (cache_code_start_ptr == nullptr) {
+			const auto cache_code_size = get_cache_code_size();
 			// allocate the code cache memory
 #if defined (WIN32)
 			LPVOID lp_vmem = nullptr;
@@ -1042,6 +1206,7 @@ static void cache_init(bool enable) {
 			block->cache.start=&cache_code[0];
 			block->cache.size=CACHE_TOTAL;
 			block->cache.next = nullptr; // last block in the list
+			cache_code_total = CACHE_TOTAL;
 		}
 
 		auto cache_addr = static_cast<void *>(cache_code);
@@ -135,6 +135,44 @@ bool PageHandler::writeq_checked(PhysPt addr, uint64_t val)
 	return false;
 }
 
+void PageHandler::NotifyBlockWritten(PhysPt /*addr*/, size_t /*num_bytes*/) {}
+
+void PageHandler::FillBlock(PhysPt addr, const uint32_t val, const uint8_t width,
+                            uint32_t count)
+{
+	for (; count > 0; --count, addr += width) {
+		switch (width) {
+		case 1: writeb(addr, static_cast<uint8_t>(val)); break;
+		case 2: writew(addr, static_cast<uint16_t>(val)); break;
+		default: writed(addr, val); break;
+		}
+	}
+}
+
+void PageHandler::WriteBlock(PhysPt addr, const uint8_t* data,
+                             const uint8_t width, uint32_t count)
+{
+	for (; count > 0; --count, addr += width, data += width) {
+		switch (width) {
+		case 1: writeb(addr, host_readb(data)); break;
+		case 2: writew(addr, host_readw(data)); break;
+		default: writed(addr, host_readd(data)); break;
+		}
+	}
+}
+
+void PageHandler::CopyBlock(PhysPt dest, PhysPt src, const uint8_t width,
+                            uint32_t count)
+{
+	for (; count > 0; --count, dest += width, src += width) {
+		switch (width) {
+		case 1: writeb(dest, readb(src)); break;
+		case 2: writew(dest, readw(src)); break;
+		default: writed(dest, readd(src)); break;
+		}
+	}
+}
+
 struct PF_Entry {
 	uint32_t cs;
 	uint32_t eip;
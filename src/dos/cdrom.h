@@ -24,19 +24,25 @@
 
 #include "dosbox.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "support.h"
 #include "mem.h"
 #include "mixer.h"
 #include "rwqueue.h"
+#include "spsc_queue.h"
 
 #include "decoders/SDL_sound.h"
 
@@ -195,6 +201,51 @@ public:
 	}
 };
 
+// A least-recently-used cache of whole sector frames, as stored in the image
+class CdSectorCache {
+public:
+	static constexpr uint16_t FrameSize = BYTES_PER_RAW_REDBOOK_FRAME;
+
+	// Drops all frames; frame storage is allocated as the cache fills
+	void Resize(const size_t max_frames);
+	size_t Capacity() const
+	{
+		return max_frames;
+	}
+	size_t Size() const
+	{
+		return slots.size();
+	}
+
+	// Returns the sector's frame and marks it as most recently used, or
+	// nullptr if the sector isn't cached
+	const uint8_t* Find(const uint32_t sector);
+
+	// Returns the frame to fill for the sector, evicting the least recently
+	// used one if the cache is full. The pointer is valid until the next
+	// call to Insert().
+	uint8_t* Insert(const uint32_t sector);
+
+private:
+	static constexpr uint32_t None = std::numeric_limits<uint32_t>::max();
+
+	void Unlink(const uint32_t slot);
+	void PushFront(const uint32_t slot);
+
+	struct Slot {
+		uint32_t sector = 0;
+		uint32_t prev   = None;
+		uint32_t next   = None;
+	};
+
+	std::vector<uint8_t> frames                  = {};
+	std::vector<Slot> slots                      = {};
+	std::unordered_map<uint32_t, uint32_t> index = {};
+	uint32_t head                                = None;
+	uint32_t tail                                = None;
+	size_t max_frames                            = 0;
+};
+
 class CDROM_Interface_Image final : public CDROM_Interface
 {
 private:
@@ -256,7 +307,14 @@ private:
 		}
 
 	private:
+		// Seeks without taking the mutex, for use by the locked calls
+		bool seekFile(const uint32_t offset);
+
 		std::ifstream* file;
+
+		// Audio is decoded in its own thread, while data sectors of
+		// the same file are read in the main thread
+		std::mutex mutex = {};
 	};
 
 	class AudioFile final : public TrackFile {
@@ -286,6 +344,60 @@ private:
 		Sound_Sample* sample = nullptr;
 	};
 
+	// Seeks and decodes the playing audio track in its own thread and
+	// queues the PCM ahead of the mixer, so the mixer thread never waits
+	// on codec work
+	class AudioDecoder {
+	public:
+		static constexpr uint16_t FramesPerChunk = 1024;
+
+		enum class ChunkType : uint8_t { Audio, EndOfTrack, SeekFailed };
+
+		struct Chunk {
+			uint32_t generation = 0;
+			uint16_t num_frames = 0;
+			ChunkType type      = ChunkType::Audio;
+
+			int16_t samples[FramesPerChunk * REDBOOK_CHANNELS] = {};
+		};
+
+		AudioDecoder();
+		~AudioDecoder();
+
+		AudioDecoder(const AudioDecoder&)            = delete;
+		AudioDecoder& operator=(const AudioDecoder&) = delete;
+
+		// Replaces the current job with decoding the track from the
+		// given Redbook byte offset
+		void Start(const std::shared_ptr<TrackFile>& track_file,
+		           const uint32_t byte_offset);
+		void Stop();
+
+		// Chunks from older generations are stale and must be skipped
+		uint32_t GetGeneration() const
+		{
+			return generation;
+		}
+
+		// Consumed by the mixer thread
+		SPSCQueue<Chunk> chunks;
+
+	private:
+		void Run();
+		bool Enqueue(const Chunk& chunk, const uint32_t job_generation);
+		void Decode(const std::shared_ptr<TrackFile>& track_file,
+		            const uint32_t byte_offset, const uint32_t job_generation);
+
+		std::thread thread                   = {};
+		std::mutex mutex                     = {};
+		std::condition_variable job_changed  = {};
+		std::shared_ptr<TrackFile> next_file = nullptr;
+		uint32_t next_offset                 = 0;
+		bool has_next_job                    = false;
+		std::atomic<uint32_t> generation     = 0;
+		std::atomic<bool> should_quit        = false;
+	};
+
 public:
 	// Nested struct definition
 	struct Track {
@@ -331,9 +443,14 @@ public:
 private:
 	static struct imagePlayer {
 		// Objects, pointers, and then scalars; in descending size-order.
-		std::weak_ptr<TrackFile> trackFile = {};
-		MixerChannelPtr channel            = nullptr;
-		CDROM_Interface_Image* cd          = nullptr;
+		std::weak_ptr<TrackFile> trackFile    = {};
+		MixerChannelPtr channel               = nullptr;
+		std::unique_ptr<AudioDecoder> decoder = nullptr;
+		CDROM_Interface_Image* cd             = nullptr;
+
+		// The chunk being played and the position in it
+		AudioDecoder::Chunk chunk = {};
+		uint16_t chunkPos         = 0;
 
 		void (MixerChannel::*addFrames)(int, const int16_t*) = nullptr;
 
@@ -341,20 +458,9 @@ private:
 		uint32_t totalTrackFrames   = 0;
 		uint32_t startSector        = 0;
 		uint32_t totalRedbookFrames = 0;
+		uint8_t trackChannels       = 0;
 		bool isPlaying              = false;
 		bool isPaused               = false;
-
-		// TODO `MixerBufferByteSize` is hardcoded to 1024 * 16 bytes,
-		// so this buffer has been 32k long for a while now. There's
-		// potential for buffer overflows, though; the code that writes
-		// to the buffer asserts the max length of the writes, but
-		// allows lengths far greater than the 32k limit. So it kinda
-		// works, but by fluke.
-		//
-		// Probably the safest way going forward is to turn this into a
-		// `std::vector` and size it as needed at runtime.
-		//
-		int16_t buffer[MixerBufferByteSize * 2] = {};
 	} player;
 
 	// Private utility functions
@@ -363,6 +469,7 @@ private:
 	                 const uint16_t sectorSize,
 	                 const bool mode2);
 	std::vector<Track>::iterator GetTrack(const uint32_t sector);
+	const uint8_t* ReadCachedFrame(const Track& track, const uint32_t sector);
 	void CDAudioCallBack(const int desired_track_frames);
 
 	// Private functions for cue sheet processing
@@ -380,6 +487,13 @@ private:
 	std::vector<Track>   tracks;
 	std::vector<uint8_t> readBuffer;
 	std::string          mcn;
+
+	// Data sectors, shared by the ISO 9660 drive and MSCDEX reads
+	CdSectorCache        sectorCache      = {};
+	std::vector<uint8_t> readAheadBuffer  = {};
+	uint32_t             lastReadSector   = std::numeric_limits<uint32_t>::max();
+	uint32_t             readAheadSectors = 1;
+
 	static int           refCount;
 };
 
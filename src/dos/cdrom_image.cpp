@@ -23,6 +23,7 @@
 
 #include "cdrom.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <chrono>
@@ -47,6 +48,7 @@
 #include "math_utils.h"
 #include "setup.h"
 #include "string_utils.h"
+#include "support.h"
 
 // String maximums, local to this file
 #define MAX_LINE_LENGTH 512
@@ -57,6 +59,13 @@ using track_iter       = std::vector<CDROM_Interface_Image::Track>::iterator;
 using track_const_iter = std::vector<CDROM_Interface_Image::Track>::const_iterator;
 using tracks_size_t    = std::vector<CDROM_Interface_Image::Track>::size_type;
 
+// Bounds of the read-ahead for sequential data reads, in sectors
+constexpr uint32_t MinReadAheadSectors = 16;
+constexpr uint32_t MaxReadAheadSectors = 128;
+
+// Sector cache size per image, set by the 'cdrom_cache_size' setting
+static size_t sector_cache_frames = 4 * 1024 * 1024 / CdSectorCache::FrameSize;
+
 // Ensure the maximum allowed redbook bytes stays within the API type sizes
 static_assert(MAX_REDBOOK_BYTES <= UINT32_MAX);
 
@@ -104,6 +113,11 @@ CDROM_Interface_Image::BinaryFile::BinaryFile(const char *filename, bool &error)
 	file = new std::ifstream(filename, std::ios::in | std::ios::binary);
 	// If new fails, an exception is generated and scope leaves this constructor
 	error = file->fail();
+
+	// Cache the length up-front so the audio and data threads never race
+	// on the file position to determine it
+	if (!error)
+		getLength();
 }
 
 CDROM_Interface_Image::BinaryFile::~BinaryFile()
@@ -129,8 +143,10 @@ bool CDROM_Interface_Image::BinaryFile::read(uint8_t *buffer,
 	if (adjusted_bytes == 0) // no work to do!
 		return true;
 
+	const std::lock_guard lock(mutex);
+
 	// Reposition if needed
-	if (!seek(offset))
+	if (!seekFile(offset))
 		return false;
 
 	file->read((char *)buffer, adjusted_bytes);
@@ -144,8 +160,9 @@ int CDROM_Interface_Image::BinaryFile::getLength()
 		file->seekg(0, std::ios::end);
 		/**
 		 *  All read(..) operations involve an absolute position and
-		 *  this function isn't called in other threads, therefore
-		 *  we don't need to restore the original file position.
+		 *  this runs once in the constructor before any other thread
+		 *  sees the file, therefore we don't need to restore the
+		 *  original file position.
 		 */
 		length_redbook_bytes = static_cast<int>(file->tellg());
 
@@ -167,6 +184,12 @@ uint16_t CDROM_Interface_Image::BinaryFile::getEndian()
 }
 
 bool CDROM_Interface_Image::BinaryFile::seek(const uint32_t offset)
+{
+	const std::lock_guard lock(mutex);
+	return seekFile(offset);
+}
+
+bool CDROM_Interface_Image::BinaryFile::seekFile(const uint32_t offset)
 {
 	// Check for logic bugs and illegal values
 	assertm(file, "The file pointer needs to be valid, but is the nullptr");
@@ -199,9 +222,11 @@ uint32_t CDROM_Interface_Image::BinaryFile::decode(int16_t *buffer,
 	assertm(audio_pos < MAX_REDBOOK_BYTES,
 	        "Tried to decode audio before the playback position was set");
 
+	const std::lock_guard lock(mutex);
+
 	// Reposition against our last audio position if needed
 	if (static_cast<uint32_t>(file->tellg()) != audio_pos)
-		if (!seek(audio_pos))
+		if (!seekFile(audio_pos))
 			return 0;
 
 	file->read((char*)buffer, desired_track_frames * BYTES_PER_REDBOOK_PCM_FRAME);
@@ -477,6 +502,129 @@ int CDROM_Interface_Image::AudioFile::getLength()
 	return length_redbook_bytes;
 }
 
+// About three seconds of audio is decoded ahead of the mixer
+constexpr size_t DecodeAheadFrames = REDBOOK_PCM_FRAMES_PER_SECOND * 3;
+
+CDROM_Interface_Image::AudioDecoder::AudioDecoder()
+        : chunks(DecodeAheadFrames / FramesPerChunk)
+{
+	thread = std::thread(&AudioDecoder::Run, this);
+	set_thread_name(thread, "dosbox:cdaudio");
+}
+
+CDROM_Interface_Image::AudioDecoder::~AudioDecoder()
+{
+	{
+		const std::lock_guard lock(mutex);
+		should_quit = true;
+	}
+	chunks.Stop();
+	job_changed.notify_all();
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void CDROM_Interface_Image::AudioDecoder::Start(const std::shared_ptr<TrackFile>& track_file,
+                                                const uint32_t byte_offset)
+{
+	{
+		const std::lock_guard lock(mutex);
+		next_file    = track_file;
+		next_offset  = byte_offset;
+		has_next_job = true;
+		++generation;
+	}
+	job_changed.notify_all();
+}
+
+void CDROM_Interface_Image::AudioDecoder::Stop()
+{
+	{
+		const std::lock_guard lock(mutex);
+		next_file.reset();
+		has_next_job = false;
+		++generation;
+	}
+	job_changed.notify_all();
+}
+
+void CDROM_Interface_Image::AudioDecoder::Run()
+{
+	while (true) {
+		std::shared_ptr<TrackFile> track_file = {};
+		uint32_t byte_offset    = 0;
+		uint32_t job_generation = 0;
+		{
+			std::unique_lock lock(mutex);
+			job_changed.wait(lock, [this] {
+				return has_next_job || should_quit;
+			});
+			if (should_quit) {
+				return;
+			}
+			track_file     = std::move(next_file);
+			byte_offset    = next_offset;
+			job_generation = generation;
+			has_next_job   = false;
+		}
+		Decode(track_file, byte_offset, job_generation);
+	}
+}
+
+// Waits for room in the queue; returns false if the job was replaced or
+// the decoder is shutting down in the meantime
+bool CDROM_Interface_Image::AudioDecoder::Enqueue(const Chunk& chunk,
+                                                  const uint32_t job_generation)
+{
+	using namespace std::chrono_literals;
+
+	const auto is_cancelled = [&] {
+		return generation != job_generation || should_quit;
+	};
+	while (chunks.NonblockingBulkEnqueue({&chunk, 1}) == 0) {
+		// The mixer frees room without notifying us, so poll
+		std::unique_lock lock(mutex);
+		if (job_changed.wait_for(lock, 5ms, is_cancelled)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void CDROM_Interface_Image::AudioDecoder::Decode(const std::shared_ptr<TrackFile>& track_file,
+                                                 const uint32_t byte_offset,
+                                                 const uint32_t job_generation)
+{
+	Chunk chunk      = {};
+	chunk.generation = job_generation;
+
+	// Guard: Bail if our track could not be seeked
+	if (!track_file->seek(byte_offset)) {
+		LOG_MSG("CDROM: Track failed to seek to byte %u, so cancelling playback",
+		        byte_offset);
+		chunk.type = ChunkType::SeekFailed;
+		Enqueue(chunk, job_generation);
+		return;
+	}
+
+	// We're performing an audio-task, so update the audio position
+	track_file->setAudioPosition(byte_offset);
+
+	while (generation == job_generation && !should_quit) {
+		chunk.num_frames = check_cast<uint16_t>(
+		        track_file->decode(chunk.samples, FramesPerChunk));
+
+		chunk.type = chunk.num_frames ? ChunkType::Audio
+		                              : ChunkType::EndOfTrack;
+
+		if (!Enqueue(chunk, job_generation) ||
+		    chunk.type == ChunkType::EndOfTrack) {
+			return;
+		}
+	}
+}
+
 // initialize static members
 int CDROM_Interface_Image::refCount = 0;
 CDROM_Interface_Image::imagePlayer CDROM_Interface_Image::player;
@@ -486,6 +634,8 @@ CDROM_Interface_Image::CDROM_Interface_Image()
           readBuffer{},
           mcn("")
 {
+	sectorCache.Resize(sector_cache_frames);
+
 	if (refCount == 0) {
 		if (!player.channel) {
 			MIXER_LockMixerThread();
@@ -500,6 +650,8 @@ CDROM_Interface_Image::CDROM_Interface_Image()
 
 			player.channel->Enable(false); // only enabled during playback periods
 			MIXER_UnlockMixerThread();
+
+			player.decoder = std::make_unique<AudioDecoder>();
 		}
 #ifdef DEBUG
 		LOG_MSG("CDROM: Initialised the %s audio channel", ChannelName::CdAudio);
@@ -522,8 +674,11 @@ CDROM_Interface_Image::~CDROM_Interface_Image()
 		}
 		MIXER_DeregisterChannel(player.channel);
 		player.channel.reset();
+		player.decoder.reset();
 	}
 	if (player.cd == this) {
+		// Release our track file, which the decoder may still hold
+		StopAudio();
 		player.cd = nullptr;
 	}
 	MIXER_UnlockMixerThread();
@@ -711,7 +866,7 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 
 	// Guard: sanity check the request beyond what GetTrack already checks
 	if (len == 0 || track == tracks.end() || !track_file ||
-	    track->attr == 0x40 || !player.channel) {
+	    track->attr == 0x40 || !player.channel || !player.decoder) {
 		StopAudio();
 #ifdef DEBUG
 		LOG_MSG("CDROM: PlayAudioSector => sanity check failed");
@@ -732,17 +887,6 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 	const auto sector_offset = start - track->start;
 	const auto byte_offset = track->skip + sector_offset * track->sectorSize;
 
-	// Guard: Bail if our track could not be seeked
-	if (!track_file->seek(byte_offset)) {
-		LOG_MSG("CDROM: Track %d failed to seek to byte %u, so cancelling playback",
-		        track->number, byte_offset);
-		StopAudio();
-		return false;
-	}
-
-	// We're performing an audio-task, so update the audio position
-	track_file->setAudioPosition(byte_offset);
-
 	// Get properties about the current track
 	const uint8_t track_channels = track_file->getChannels();
 	const uint32_t track_rate = track_file->getRate();
@@ -754,6 +898,7 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 	player.totalRedbookFrames = len;
 	player.isPlaying = true;
 	player.isPaused = false;
+	player.trackChannels = track_channels;
 
 	// Assign the mixer function associated with this track's content type
 	if (track_file->getEndian() == AUDIO_S16SYS) {
@@ -801,6 +946,9 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 	}
 #endif
 
+	// The decoder seeks and fills its queue while the channel starts
+	player.decoder->Start(track_file, byte_offset);
+
 	// start the channel!
 	player.channel->SetSampleRate(track_rate);
 	player.channel->Enable(true);
@@ -824,6 +972,9 @@ bool CDROM_Interface_Image::StopAudio(void)
 {
 	player.isPlaying = false;
 	player.isPaused = false;
+	if (player.decoder) {
+		player.decoder->Stop();
+	}
 	if (player.channel) {
 		player.channel->Enable(false);
 	}
@@ -954,6 +1105,136 @@ track_iter CDROM_Interface_Image::GetTrack(const uint32_t sector)
 	return track;
 }
 
+void CdSectorCache::Resize(const size_t new_max_frames)
+{
+	frames.clear();
+	slots.clear();
+	index.clear();
+	head       = None;
+	tail       = None;
+	max_frames = new_max_frames;
+}
+
+const uint8_t* CdSectorCache::Find(const uint32_t sector)
+{
+	const auto it = index.find(sector);
+	if (it == index.end()) {
+		return nullptr;
+	}
+	const auto slot = it->second;
+	if (slot != head) {
+		Unlink(slot);
+		PushFront(slot);
+	}
+	return &frames[slot * FrameSize];
+}
+
+uint8_t* CdSectorCache::Insert(const uint32_t sector)
+{
+	assert(max_frames > 0);
+
+	uint32_t slot = None;
+	if (const auto it = index.find(sector); it != index.end()) {
+		slot = it->second;
+		Unlink(slot);
+	} else if (slots.size() < max_frames) {
+		slot = static_cast<uint32_t>(slots.size());
+		slots.emplace_back();
+		frames.resize(slots.size() * FrameSize);
+	} else {
+		// Reuse the least recently used frame
+		slot = tail;
+		Unlink(slot);
+		index.erase(slots[slot].sector);
+	}
+	slots[slot].sector = sector;
+	index[sector]      = slot;
+	PushFront(slot);
+
+	return &frames[slot * FrameSize];
+}
+
+void CdSectorCache::Unlink(const uint32_t slot)
+{
+	auto& entry = slots[slot];
+	if (entry.prev != None) {
+		slots[entry.prev].next = entry.next;
+	} else {
+		head = entry.next;
+	}
+	if (entry.next != None) {
+		slots[entry.next].prev = entry.prev;
+	} else {
+		tail = entry.prev;
+	}
+	entry.prev = None;
+	entry.next = None;
+}
+
+void CdSectorCache::PushFront(const uint32_t slot)
+{
+	slots[slot].prev = None;
+	slots[slot].next = head;
+	if (head != None) {
+		slots[head].prev = slot;
+	}
+	head = slot;
+	if (tail == None) {
+		tail = slot;
+	}
+}
+
+// Returns the sector's frame from the cache, reading it in first on a miss.
+// Misses during sequential reads pull in the following sectors too, doubling
+// the read-ahead while the run continues.
+const uint8_t* CDROM_Interface_Image::ReadCachedFrame(const Track& track,
+                                                      const uint32_t sector)
+{
+	const bool is_sequential = (sector == lastReadSector + 1);
+	lastReadSector           = sector;
+
+	if (const auto frame = sectorCache.Find(sector); frame) {
+		return frame;
+	}
+
+	readAheadSectors = is_sequential ? std::clamp(readAheadSectors * 2,
+	                                              MinReadAheadSectors,
+	                                              MaxReadAheadSectors)
+	                                 : 1;
+
+	// Stay within the track and leave most of the cache to other data
+	const auto track_end   = track.start + track.length;
+	const auto cache_share = std::max(sectorCache.Capacity() / 4, size_t{1});
+	const auto num_sectors = static_cast<uint32_t>(
+	        std::min({static_cast<size_t>(readAheadSectors),
+	                  static_cast<size_t>(track_end - sector),
+	                  cache_share}));
+
+	const uint32_t frame_size = track.sectorSize;
+	const uint32_t offset = track.skip + (sector - track.start) * frame_size;
+
+	readAheadBuffer.resize(num_sectors * frame_size);
+	auto sectors_read = num_sectors;
+	if (!track.file->read(readAheadBuffer.data(), offset, num_sectors * frame_size)) {
+		// The read-ahead ran into trouble; settle for the one sector
+		if (num_sectors == 1 ||
+		    !track.file->read(readAheadBuffer.data(), offset, frame_size)) {
+			return nullptr;
+		}
+		sectors_read = 1;
+	}
+
+	// Insert the requested sector last so it's the most recently used
+	for (auto i = sectors_read; i-- > 0;) {
+		const auto frame = sectorCache.Insert(sector + i);
+		memcpy(frame, &readAheadBuffer[i * frame_size], frame_size);
+		if (i == 0) {
+			return frame;
+		}
+	}
+	return nullptr;
+}
+
 bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const uint32_t sector)
 {
 	track_const_iter track = GetTrack(sector);
@@ -972,10 +1253,11 @@ bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const ui
 	if (track->sectorSize != BYTES_PER_RAW_REDBOOK_FRAME && raw) {
 		return false;
 	}
+	uint32_t frame_offset = 0;
 	if (track->sectorSize == BYTES_PER_RAW_REDBOOK_FRAME && !track->mode2 && !raw)
-		offset += 16;
+		frame_offset = 16;
 	if (track->mode2 && !raw)
-		offset += 24;
+		frame_offset = 24;
 
 #if 0 // Excessively verbose.. only enable if needed
 #ifdef DEBUG
@@ -986,7 +1268,17 @@ bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const ui
 	        length);
 #endif
 #endif
-	return track->file->read(buffer, offset, length);
+	// Data tracks go through the sector cache
+	if (track->attr == 0x40 && sectorCache.Capacity() > 0 &&
+	    track->sectorSize <= CdSectorCache::FrameSize) {
+		const auto frame = ReadCachedFrame(*track, sector);
+		if (!frame) {
+			return false;
+		}
+		memcpy(buffer, frame + frame_offset, length);
+		return true;
+	}
+	return track->file->read(buffer, offset + frame_offset, length);
 }
 
 bool CDROM_Interface_Image::ReadSectorsHost(void *buffer, bool raw, unsigned long sector, unsigned long num)
@@ -1025,44 +1317,73 @@ void CDROM_Interface_Image::CDAudioCallBack(const int desired_track_frames)
 		return;
 	}
 
-	const auto decoded_track_frames = check_cast<uint16_t>(
-	        track_file->decode(player.buffer, desired_track_frames));
-
-	if (!decoded_track_frames) {
-		// This particular CDDA track has come to an end, but the
-		// program has requested we continue playing for a longer
-		// period. So keep going!
-		const auto fraction_played = static_cast<double>(
-		                                     player.playedTrackFrames) /
-		                             player.totalTrackFrames;
+	using ChunkType = AudioDecoder::ChunkType;
 
-		const auto played_redbook_frames = static_cast<uint32_t>(
-		        ceil(fraction_played * player.totalRedbookFrames));
+	const auto generation = player.decoder->GetGeneration();
+	auto& chunk           = player.chunk;
 
-		const auto new_redbook_start_frame = player.startSector +
-		                                     played_redbook_frames;
-
-		const auto remaining_redbook_frames = player.totalRedbookFrames -
-		                                      played_redbook_frames;
+	int added_frames = 0;
+	while (added_frames < desired_track_frames) {
+		// Take the next chunk once the current one is used up, skipping
+		// any that were decoded before the last seek
+		if (chunk.generation != generation || player.chunkPos == chunk.num_frames) {
+			if (player.decoder->chunks.NonblockingBulkDequeue({&chunk, 1}) == 0) {
+				// The decoder is still catching up
+				return;
+			}
+			player.chunkPos = 0;
+			if (chunk.generation != generation) {
+				continue;
+			}
+			if (chunk.type == ChunkType::SeekFailed) {
+				player.cd->StopAudio();
+				return;
+			}
+			if (chunk.type == ChunkType::EndOfTrack) {
+				// This particular CDDA track has come to an end,
+				// but the program has requested we continue
+				// playing for a longer period. So keep going!
+				const auto fraction_played =
+				        static_cast<double>(player.playedTrackFrames) /
+				        player.totalTrackFrames;
+
+				const auto played_redbook_frames = static_cast<uint32_t>(
+				        ceil(fraction_played * player.totalRedbookFrames));
+
+				const auto new_redbook_start_frame = player.startSector +
+				                                     played_redbook_frames;
+
+				const auto remaining_redbook_frames = player.totalRedbookFrames -
+				                                      played_redbook_frames;
+
+				player.cd->PlayAudioSector(new_redbook_start_frame,
+				                           remaining_redbook_frames);
+				return;
+			}
+		}
 
-		player.cd->PlayAudioSector(new_redbook_start_frame,
-		                           remaining_redbook_frames);
+		const auto num_frames = std::min(chunk.num_frames - player.chunkPos,
+		                                 desired_track_frames - added_frames);
 
-		return;
-	}
+		// Use the stereo or mono and native or nonnative AddSamples
+		// call assigned during construction
+		(player.channel.get()->*player.addFrames)(
+		        num_frames, chunk.samples + player.chunkPos * player.trackChannels);
 
-	// Use the stereo or mono and native or nonnative AddSamples call
-	// assigned during construction
-	(player.channel.get()->*player.addFrames)(decoded_track_frames, player.buffer);
+		player.chunkPos = check_cast<uint16_t>(player.chunkPos + num_frames);
+		added_frames += num_frames;
 
-	player.playedTrackFrames += decoded_track_frames;
-	if (player.playedTrackFrames >= player.totalTrackFrames) {
+		player.playedTrackFrames += num_frames;
+		if (player.playedTrackFrames >= player.totalTrackFrames) {
 #ifdef DEBUG
-		LOG_MSG("CDROM: CDAudioCallBack stopping because "
-		"playedTrackFrames (%u) >= totalTrackFrames (%u)",
-		player.playedTrackFrames, player.totalTrackFrames);
+			LOG_MSG("CDROM: CDAudioCallBack stopping because "
+			        "playedTrackFrames (%u) >= totalTrackFrames (%u)",
+			        player.playedTrackFrames,
+			        player.totalTrackFrames);
 #endif
-		player.cd->StopAudio();
+			player.cd->StopAudio();
+			return;
+		}
 	}
 }
 
@@ -1469,6 +1790,11 @@ void CDROM_Image_Init(Section* sec)
 {
 	if (sec != nullptr) {
 		sec->AddDestroyFunction(CDROM_Image_Destroy);
+
+		const auto section = static_cast<Section_prop*>(sec);
+		const auto cache_bytes = section->Get_int("cdrom_cache_size") * 1024 * 1024;
+		sector_cache_frames = static_cast<size_t>(cache_bytes) /
+		                      CdSectorCache::FrameSize;
 	}
 	Sound_Init();
 }
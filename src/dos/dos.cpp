@@ -1348,23 +1348,37 @@ static uint16_t DOS_SectorAccess(const bool read)
 	} else if (sectorEnd > 0xffff)
 		return 0x0207; // must use large partition form
 
-	uint8_t sectorBuf[512];
-	while (sectorCnt--) {
-		if (sectorNum >= sectorEnd)
-			return 0x0408; // sector not found
-		if (read) {
-			if (drive->readSector(sectorNum++, &sectorBuf))
-				return 0x0408;
-			for (const auto& sectorVal : sectorBuf)
-				real_writeb(bufferSeg, bufferOff++, sectorVal);
-		} else {
-			for (auto &sectorVal : sectorBuf)
-				sectorVal = real_readb(bufferSeg, bufferOff++);
-			if (drive->writeSector(sectorNum++, &sectorBuf))
-				return 0x0408;
+	// Absolute access bypasses the cached FAT, so the disk has to be up
+	// to date before it and the cache after it
+	drive->flushFat();
+
+	bool fat_written = false;
+	auto access_sectors = [&]() -> uint16_t {
+		uint8_t sectorBuf[512];
+		while (sectorCnt--) {
+			if (sectorNum >= sectorEnd)
+				return 0x0408; // sector not found
+			if (read) {
+				if (drive->readSector(sectorNum++, &sectorBuf))
+					return 0x0408;
+				for (const auto& sectorVal : sectorBuf)
+					real_writeb(bufferSeg, bufferOff++, sectorVal);
+			} else {
+				for (auto &sectorVal : sectorBuf)
+					sectorVal = real_readb(bufferSeg, bufferOff++);
+				fat_written |= drive->isFatSector(sectorNum);
+				if (drive->writeSector(sectorNum++, &sectorBuf))
+					return 0x0408;
+			}
 		}
+		return 0;
+	};
+
+	const auto result = access_sectors();
+	if (fat_written) {
+		drive->reloadFat();
 	}
-	return 0;
+	return result;
 }
 
 static Bitu DOS_25Handler(void)
@@ -760,7 +760,7 @@ bool DOS_FlushFile(uint16_t entry) {
 		return false;
 	};
 	LOG(LOG_DOSMISC,LOG_NORMAL)("FFlush used.");
-	return true;
+	return Files[handle]->Flush();
 }
 
 bool DOS_CreateFile(const char* name, FatAttributeFlags attributes,
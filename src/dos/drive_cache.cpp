@@ -20,9 +20,17 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <iterator>
+#include <string>
 #include <vector>
 
+#if defined(LINUX)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #include "cross.h"
 #include "dos_inc.h"
 #include "drives.h"
@@ -31,6 +39,25 @@
 
 int fileInfoCounter = 0;
 
+// Set by the 'host_dir_watch' setting
+static bool host_watch_enabled = false;
+
+// Host names are matched case-insensitively on Windows
+static std::string host_name_key(const char* name)
+{
+	std::string key = name;
+#if defined(WIN32)
+	lowcase(key);
+#endif
+	return key;
+}
+
+static bool is_shortname_less(const DOS_Drive_Cache::CFileInfo* const a,
+                              const DOS_Drive_Cache::CFileInfo* const b)
+{
+	return strcmp(a->shortname, b->shortname) < 0;
+}
+
 bool SortByName(DOS_Drive_Cache::CFileInfo* const a,
                 DOS_Drive_Cache::CFileInfo* const b)
 {
@@ -100,6 +127,7 @@ DOS_Drive_Cache::~DOS_Drive_Cache(void) {
 		DeleteFileInfo(dirFindFirst[i]);
 		dirFindFirst[i] = nullptr;
 	}
+	DisableHostWatch();
 }
 
 void DOS_Drive_Cache::Clear(void) {
@@ -184,6 +212,8 @@ char* DOS_Drive_Cache::GetExpandNameAndNormaliseCase(const char* path)
 	static char work [CROSS_LEN] = { 0 };
 	char dir [CROSS_LEN];
 
+	ProcessHostChanges();
+
 	work[0] = 0;
 	safe_strcpy (dir, path);
 
@@ -355,6 +385,10 @@ void DOS_Drive_Cache::CacheOut(const char* path, bool ignoreLastDir) {
 	}
 
 //	LOG_DEBUG("DIR: Caching out %s : dir %s",expand,dir->orgname);
+	CacheOutDir(dir);
+}
+
+void DOS_Drive_Cache::CacheOutDir(CFileInfo* dir) {
 	// delete file objects...
 	//Maybe check if it is a file and then only delete the file and possibly the long name. instead of all objects in the dir.
 	for(uint32_t i=0; i<dir->fileList.size(); i++) {
@@ -366,6 +400,9 @@ void DOS_Drive_Cache::CacheOut(const char* path, bool ignoreLastDir) {
 	// clear lists
 	dir->fileList.clear();
 	dir->longNameList.clear();
+	dir->shortNameIndex.clear();
+	dir->longNameIndex.clear();
+	dir->wineNameIndex.clear();
 	save_dir = nullptr;
 }
 
@@ -375,6 +412,8 @@ bool DOS_Drive_Cache::IsCachedIn(CFileInfo* curDir) {
 
 
 bool DOS_Drive_Cache::GetShortName(const char* fullname, char* shortname) {
+	ProcessHostChanges();
+
 	// Get Dir Info
 	char expand[CROSS_LEN] = {0};
 	CFileInfo* curDir = FindDirInfo(fullname,expand);
@@ -385,23 +424,17 @@ bool DOS_Drive_Cache::GetShortName(const char* fullname, char* shortname) {
 	else
 		return false;
 
-	std::vector<CFileInfo*>::size_type filelist_size = curDir->longNameList.size();
-	if (filelist_size <= 0) {
+	const auto it = curDir->longNameIndex.find(host_name_key(pos));
+	if (it == curDir->longNameIndex.end()) {
 		return false;
 	}
-
-	// The orgname part of the list is not sorted (shortname is)! So we can only walk through it.
-	for(Bitu i = 0; i < filelist_size; i++) {
-#if defined (WIN32)
-		if (strcasecmp(pos,curDir->longNameList[i]->orgname) == 0) {
-#else
-		if (strcmp(pos,curDir->longNameList[i]->orgname) == 0) {
-#endif
-			safe_strncpy(shortname, curDir->longNameList[i]->shortname, DOS_NAMELENGTH_ASCII);
-			return true;
-		}
+	// Only names that needed a generated short name are reported
+	const CFileInfo* info = it->second;
+	if (info->shortNr == 0) {
+		return false;
 	}
-	return false;
+	safe_strncpy(shortname, info->shortname, DOS_NAMELENGTH_ASCII);
+	return true;
 }
 
 int DOS_Drive_Cache::CompareShortname(const char* compareName, const char* shortName) {
@@ -558,46 +591,55 @@ static Bits wine_hash_short_file_name( char* name, char* buffer )
 #endif
 
 Bits DOS_Drive_Cache::GetLongName(CFileInfo* curDir, char* shortName, const size_t shortName_len) {
-	std::vector<CFileInfo*>::size_type filelist_size = curDir->fileList.size();
-	if (filelist_size <= 0) {
+	if (curDir->fileList.empty()) {
 		return -1;
 	}
 
 	// Remove dot, if no extension...
 	RemoveTrailingDot(shortName);
-	// Search long name and return array number of element
-	Bits low	= 0;
-	Bits high	= (Bits)(filelist_size-1);
-	Bits mid,res;
-	while (low<=high) {
-		mid = (low+high)/2;
-		res = strcmp(shortName,curDir->fileList[mid]->shortname);
-		if (res>0)	low  = mid+1; else
-		if (res<0)	high = mid-1; else
-		{	// Found
-			safe_strncpy(shortName, curDir->fileList[mid]->orgname, shortName_len);
-			return mid;
-		};
+	// Look up the long name and return array number of element
+	if (const auto it = curDir->shortNameIndex.find(shortName);
+	    it != curDir->shortNameIndex.end()) {
+		safe_strncpy(shortName, it->second->orgname, shortName_len);
+		return GetEntryIndex(curDir, it->second);
 	}
 #ifdef WINE_DRIVE_SUPPORT
 	if (strlen(shortName) < 8 || shortName[4] != '~' || shortName[5] == '.' || shortName[6] == '.' || shortName[7] == '.') return -1; // not available
 	// else it's most likely a Wine style short name ABCD~###, # = not dot  (length at least 8) 
-	// The above test is rather strict as the following loop can be really slow if filelist_size is large.
-	char buff[CROSS_LEN];
-	for (Bitu i = 0; i < filelist_size; i++) {
-		res = wine_hash_short_file_name(curDir->fileList[i]->orgname,buff);
-		buff[res] = 0;
-		if (!strcmp(shortName,buff)) {	
-			// Found
-			safe_strncpy(shortName, curDir->fileList[i]->orgname, shortName_len);
-			return (Bits)i;
+	// Hashing every name is slow for large directories, so it's done
+	// once and kept until the directory changes.
+	if (curDir->wineNameIndex.empty()) {
+		char buff[CROSS_LEN];
+		for (const auto info : curDir->fileList) {
+			const auto len = wine_hash_short_file_name(info->orgname, buff);
+			curDir->wineNameIndex.try_emplace(std::string(buff, len), info);
 		}
 	}
+	if (const auto it = curDir->wineNameIndex.find(shortName);
+	    it != curDir->wineNameIndex.end()) {
+		// Found
+		safe_strncpy(shortName, it->second->orgname, shortName_len);
+		return GetEntryIndex(curDir, it->second);
+	}
 #endif
 	// not available
 	return -1;
 }
 
+Bits DOS_Drive_Cache::GetEntryIndex(CFileInfo* dir, CFileInfo* info) {
+	// fileList is sorted by short name, which is nearly always unique
+	auto it = std::lower_bound(dir->fileList.begin(), dir->fileList.end(),
+	                           info, is_shortname_less);
+	while (it != dir->fileList.end() && *it != info &&
+	       strcmp((*it)->shortname, info->shortname) == 0) {
+		++it;
+	}
+	if (it == dir->fileList.end() || *it != info) {
+		return -1;
+	}
+	return static_cast<Bits>(std::distance(dir->fileList.begin(), it));
+}
+
 bool DOS_Drive_Cache::RemoveSpaces(char* str) {
 // Removes all spaces
 	char*	curpos	= str;
@@ -688,28 +730,11 @@ void DOS_Drive_Cache::CreateShortName(CFileInfo* curDir, CFileInfo* info) {
 		}
 
 		// keep list sorted for CreateShortNameID to work correctly
-		if (curDir->longNameList.size()>0) {
-			if (!(strcmp(info->shortname,curDir->longNameList.back()->shortname)<0)) {
-				// append at end of list
-				curDir->longNameList.push_back(info);
-			} else {
-				// look for position where to insert this element
-				bool found=false;
-				std::vector<CFileInfo*>::iterator it;
-				for (it=curDir->longNameList.begin(); it!=curDir->longNameList.end(); ++it) {
-					if (strcmp(info->shortname,(*it)->shortname)<0) {
-						found = true;
-						break;
-					}
-				}
-				// Put it in longname list...
-				if (found) curDir->longNameList.insert(it,info);
-				else curDir->longNameList.push_back(info);
-			}
-		} else {
-			// empty file list, append
-			curDir->longNameList.push_back(info);
-		}
+		const auto it = std::upper_bound(curDir->longNameList.begin(),
+		                                 curDir->longNameList.end(),
+		                                 info,
+		                                 is_shortname_less);
+		curDir->longNameList.insert(it, info);
 	} else {
 		safe_strcpy(info->shortname, tmpName);
 	}
@@ -806,6 +831,8 @@ DOS_Drive_Cache::CFileInfo* DOS_Drive_Cache::FindDirInfo(const char* path, char*
 }
 
 bool DOS_Drive_Cache::OpenDir(const char* path, uint16_t& id) {
+	ProcessHostChanges();
+
 	char expand[CROSS_LEN] = {0};
 	CFileInfo* dir = FindDirInfo(path,expand);
 	if (OpenDir(dir,expand,id)) {
@@ -853,30 +880,18 @@ void DOS_Drive_Cache::CreateEntry(CFileInfo* dir, const char* name, bool is_dire
 	// Check for long filenames...
 	CreateShortName(dir, info);		
 
-	bool found = false;
-
-	// keep list sorted (so GetLongName works correctly, used by CreateShortName in this routine)
-	if (dir->fileList.size()>0) {
-		if (!(strcmp(info->shortname,dir->fileList.back()->shortname)<0)) {
-			// append at end of list
-			dir->fileList.push_back(info);
-		} else {
-			// look for position where to insert this element
-			std::vector<CFileInfo*>::iterator it;
-			for (it=dir->fileList.begin(); it!=dir->fileList.end(); ++it) {
-				if (strcmp(info->shortname,(*it)->shortname)<0) {
-					found = true;
-					break;
-				}
-			}
-			// Put file in lists
-			if (found) dir->fileList.insert(it,info);
-			else dir->fileList.push_back(info);
-		}
-	} else {
-		// empty file list, append
-		dir->fileList.push_back(info);
-	}
+	// keep list sorted (so GetEntryIndex works correctly)
+	const auto it = std::upper_bound(dir->fileList.begin(),
+	                                 dir->fileList.end(),
+	                                 info,
+	                                 is_shortname_less);
+	dir->fileList.insert(it, info);
+
+	// duplicates only come from AddEntry() without checkExist; the
+	// first entry keeps the name
+	dir->shortNameIndex.try_emplace(info->shortname, info);
+	dir->longNameIndex.try_emplace(host_name_key(info->orgname), info);
+	dir->wineNameIndex.clear();
 }
 
 void DOS_Drive_Cache::CopyEntry(CFileInfo* dir, CFileInfo* from) {
@@ -918,6 +933,8 @@ bool DOS_Drive_Cache::ReadDir(uint16_t id, char* &result) {
 		// close dir
 		close_directory(dirp);
 
+		WatchHostDir(dirSearch[id], dirPath);
+
 		// Info
 /*		if (!dirp) {
 			LOG_DEBUG("DIR: Error Caching in %s",dirPath);			
@@ -1029,6 +1046,7 @@ void DOS_Drive_Cache::ClearFileInfo(CFileInfo *dir) {
 		dirSearch[dir->id] = nullptr;
 		dir->id = MAX_OPENDIRS;
 	}
+	UnwatchHostDir(dir);
 }
 
 void DOS_Drive_Cache::DeleteFileInfo(CFileInfo *dir) {
@@ -1037,3 +1055,124 @@ void DOS_Drive_Cache::DeleteFileInfo(CFileInfo *dir) {
 		delete dir;
 	}
 }
+
+void DOS_Drive_Cache::SetHostWatchEnabled(const bool enabled)
+{
+	host_watch_enabled = enabled;
+}
+
+void DOS_Drive_Cache::DisableHostWatch()
+{
+	hostWatchAllowed = false;
+#if defined(LINUX)
+	for (const auto& [wd, dir] : watchedDirs) {
+		dir->watchId = -1;
+	}
+	watchedDirs.clear();
+	if (watchFd >= 0) {
+		close(watchFd);
+		watchFd = -1;
+	}
+#endif
+}
+
+void DOS_Drive_Cache::WatchHostDir([[maybe_unused]] CFileInfo* dir,
+                                   [[maybe_unused]] const char* path)
+{
+#if defined(LINUX)
+	if (!host_watch_enabled || !hostWatchAllowed || dir->watchId >= 0) {
+		return;
+	}
+	if (watchFd < 0) {
+		watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (watchFd < 0) {
+			LOG_WARNING("DIRCACHE: Can't watch host directories for changes: %s",
+			            strerror(errno));
+			hostWatchAllowed = false;
+			return;
+		}
+	}
+	constexpr uint32_t Events = IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+	                            IN_MOVED_TO | IN_ONLYDIR;
+
+	const auto wd = inotify_add_watch(watchFd, path, Events);
+	if (wd < 0) {
+		// Usually the per-user watch limit; RESCAN still works
+		LOG(LOG_FILES, LOG_NORMAL)("DIRCACHE: Can't watch %s for changes: %s",
+		                           path,
+		                           strerror(errno));
+		return;
+	}
+	// The same host directory may be reachable by two paths
+	if (watchedDirs.try_emplace(wd, dir).second) {
+		dir->watchId = wd;
+	}
+#endif
+}
+
+void DOS_Drive_Cache::UnwatchHostDir([[maybe_unused]] CFileInfo* dir)
+{
+#if defined(LINUX)
+	if (dir->watchId < 0) {
+		return;
+	}
+	inotify_rm_watch(watchFd, dir->watchId);
+	watchedDirs.erase(dir->watchId);
+	dir->watchId = -1;
+#endif
+}
+
+void DOS_Drive_Cache::ProcessHostChanges()
+{
+#if defined(LINUX)
+	if (watchFd < 0) {
+		return;
+	}
+
+	bool has_overflowed = false;
+
+	alignas(inotify_event) char buffer[4096];
+	ssize_t num_bytes = 0;
+	while ((num_bytes = read(watchFd, buffer, sizeof(buffer))) > 0) {
+		const char* pos = buffer;
+		while (pos < buffer + num_bytes) {
+			const auto event = reinterpret_cast<const inotify_event*>(pos);
+			pos += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				has_overflowed = true;
+				continue;
+			}
+			const auto it = watchedDirs.find(event->wd);
+			if (it == watchedDirs.end()) {
+				// The directory was cached out since
+				continue;
+			}
+			CFileInfo* dir = it->second;
+			if (event->mask & IN_IGNORED) {
+				// The host directory itself is gone
+				dir->watchId = -1;
+				watchedDirs.erase(it);
+				continue;
+			}
+			if (event->len == 0) {
+				continue;
+			}
+
+			// Changes made through the DOS drive are already in
+			// the cache, so only the others drop the directory
+			const bool is_added = event->mask & (IN_CREATE | IN_MOVED_TO);
+			const bool is_cached = dir->longNameIndex.contains(
+			        host_name_key(event->name));
+			if (is_added != is_cached) {
+				CacheOutDir(dir);
+			}
+		}
+	}
+
+	// Changes were lost, so nothing cached can be trusted
+	if (has_overflowed) {
+		EmptyCache();
+	}
+#endif
+}
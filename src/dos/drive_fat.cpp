@@ -18,6 +18,7 @@
 
 #include "drives.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -39,6 +40,92 @@
 
 static constexpr uint16_t BytePerSector = 512;
 
+// Maps a file's cluster indexes to disk clusters. It's built lazily from the
+// FAT chain and kept as runs of consecutive clusters, so sequential access
+// costs one step per cluster and seeks don't walk the chain from the start.
+class FatExtentMap {
+public:
+	// Returns the disk cluster holding the file's given cluster index, or 0
+	// if the chain ends before it
+	uint32_t Lookup(fatDrive& drive, uint32_t first_cluster, uint32_t cluster_index);
+
+private:
+	struct Extent {
+		uint32_t file_index   = 0;
+		uint32_t disk_cluster = 0;
+		uint32_t count        = 0;
+	};
+
+	std::vector<Extent> extents = {};
+	size_t last_extent          = 0;
+	uint32_t start_cluster      = 0;
+	uint32_t generation         = 0;
+};
+
+uint32_t FatExtentMap::Lookup(fatDrive& drive, const uint32_t first_cluster,
+                              const uint32_t cluster_index)
+{
+	if (first_cluster < 2) {
+		return 0;
+	}
+	if (first_cluster != start_cluster ||
+	    generation != drive.getChainGeneration() || extents.empty()) {
+		extents       = {{0, first_cluster, 1}};
+		last_extent   = 0;
+		start_cluster = first_cluster;
+		generation    = drive.getChainGeneration();
+	}
+
+	auto disk_cluster_in = [cluster_index](const Extent& extent) -> uint32_t {
+		if (cluster_index < extent.file_index ||
+		    cluster_index - extent.file_index >= extent.count) {
+			return 0;
+		}
+		return extent.disk_cluster + (cluster_index - extent.file_index);
+	};
+
+	// Sequential access stays in the last used extent or moves to the next
+	for (const auto i : {last_extent, last_extent + 1}) {
+		if (i < extents.size()) {
+			if (const auto cluster = disk_cluster_in(extents[i]); cluster) {
+				last_extent = i;
+				return cluster;
+			}
+		}
+	}
+
+	auto mapped = extents.back().file_index + extents.back().count;
+	if (cluster_index < mapped) {
+		const auto it = std::upper_bound(extents.begin(),
+		                                 extents.end(),
+		                                 cluster_index,
+		                                 [](const uint32_t index, const Extent& extent) {
+			                                 return index < extent.file_index;
+		                                 });
+		last_extent = static_cast<size_t>(it - extents.begin()) - 1;
+		return disk_cluster_in(extents[last_extent]);
+	}
+
+	// Follow the chain beyond what's mapped so far
+	while (mapped <= cluster_index) {
+		auto& back = extents.back();
+
+		const auto last_cluster = back.disk_cluster + back.count - 1;
+		const auto next_cluster = drive.getNextCluster(last_cluster);
+		if (next_cluster == 0) {
+			return 0;
+		}
+		if (next_cluster == last_cluster + 1) {
+			++back.count;
+		} else {
+			extents.push_back({mapped, next_cluster, 1});
+		}
+		++mapped;
+	}
+	last_extent = extents.size() - 1;
+	return disk_cluster_in(extents.back());
+}
+
 class fatFile final : public DOS_File {
 public:
 	fatFile(const char* name, uint32_t startCluster, uint32_t fileLen, std::shared_ptr<fatDrive> useDrive, bool _read_only_medium);
@@ -48,8 +135,10 @@ public:
 	bool Write(uint8_t * data,uint16_t * size) override;
 	bool Seek(uint32_t * pos,uint32_t type) override;
 	void Close() override;
+	bool Flush() override;
 	uint16_t GetInformation(void) override;
 	bool IsOnReadOnlyMedium() const override;
+	uint32_t GetSectorAt(uint32_t pos);
 public:
 	std::shared_ptr<fatDrive> myDrive   = nullptr;
 	uint32_t firstCluster               = 0;
@@ -62,6 +151,8 @@ public:
 	uint32_t dirCluster = 0;
 	uint32_t dirIndex   = 0;
 
+	FatExtentMap extents = {};
+
 	bool set_archive_on_close   = false;
 	bool loadedSector           = false;
 	const bool read_only_medium = false;
@@ -111,7 +202,7 @@ bool fatFile::Read(uint8_t * data, uint16_t *size) {
 	}
 
 	if (!loadedSector) {
-		currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+		currentSector = GetSectorAt(seekpos);
 		if(currentSector == 0) {
 			/* EOC reached before EOF */
 			*size = 0;
@@ -123,6 +214,8 @@ bool fatFile::Read(uint8_t * data, uint16_t *size) {
 		loadedSector = true;
 	}
 
+	const auto sector_size = myDrive->getSectorSize();
+
 	sizedec = *size;
 	sizecount = 0;
 	while(sizedec != 0) {
@@ -130,10 +223,17 @@ bool fatFile::Read(uint8_t * data, uint16_t *size) {
 			*size = sizecount;
 			return true; 
 		}
-		data[sizecount++] = sectorBuffer[curSectOff++];
-		seekpos++;
-		if(curSectOff >= myDrive->getSectorSize()) {
-			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+		const auto chunk = static_cast<uint16_t>(
+		        std::min({static_cast<uint32_t>(sizedec),
+		                  sector_size - curSectOff,
+		                  filelength - seekpos}));
+		memcpy(data + sizecount, sectorBuffer + curSectOff, chunk);
+		sizecount += chunk;
+		curSectOff += chunk;
+		seekpos += chunk;
+		sizedec -= chunk;
+		if(curSectOff >= sector_size) {
+			currentSector = GetSectorAt(seekpos);
 			if(currentSector == 0) {
 				/* EOC reached before EOF */
 				//LOG_MSG("EOC reached before EOF, seekpos %d, filelen %d", seekpos, filelength);
@@ -146,7 +246,6 @@ bool fatFile::Read(uint8_t * data, uint16_t *size) {
 			loadedSector = true;
 			//LOG_MSG("Reading absolute sector at %d for seekpos %d", currentSector, seekpos);
 		}
-		--sizedec;
 	}
 	*size =sizecount;
 	return true;
@@ -201,17 +300,17 @@ bool fatFile::Write(uint8_t * data, uint16_t *size) {
 				firstCluster = myDrive->getFirstFreeClust();
 				if(firstCluster == 0) goto finalizeWrite; // out of space
 				myDrive->allocateCluster(firstCluster, 0);
-				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+				currentSector = GetSectorAt(seekpos);
 				myDrive->readSector(currentSector, sectorBuffer);
 				loadedSector = true;
 			}
 			if (!loadedSector) {
-				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+				currentSector = GetSectorAt(seekpos);
 				if(currentSector == 0) {
 					/* EOC reached before EOF - try to increase file allocation */
 					myDrive->appendCluster(firstCluster);
 					/* Try getting sector again */
-					currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+					currentSector = GetSectorAt(seekpos);
 					if(currentSector == 0) {
 						/* No can do. lets give up and go home.  We must be out of room */
 						goto finalizeWrite;
@@ -228,7 +327,7 @@ bool fatFile::Write(uint8_t * data, uint16_t *size) {
 		if(curSectOff >= myDrive->getSectorSize()) {
 			if(loadedSector) myDrive->writeSector(currentSector, sectorBuffer);
 
-			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+			currentSector = GetSectorAt(seekpos);
 			if(currentSector == 0) loadedSector = false;
 			else {
 				curSectOff = 0;
@@ -274,7 +373,7 @@ bool fatFile::Seek(uint32_t *pos, uint32_t type) {
 
 	if(seekto<0) seekto = 0;
 	seekpos = (uint32_t)seekto;
-	currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+	currentSector = GetSectorAt(seekpos);
 	if (currentSector == 0) {
 		/* not within file size, thus no sector is available */
 		loadedSector = false;
@@ -309,11 +408,38 @@ void fatFile::Close()
 		if (loadedSector) {
 			myDrive->writeSector(currentSector, sectorBuffer);
 		}
+		myDrive->flushFat();
 	}
 
 	set_archive_on_close = false;
 }
 
+bool fatFile::Flush()
+{
+	if ((flags & 0xf) != OPEN_READ && !myDrive->IsReadOnly()) {
+		if (loadedSector) {
+			myDrive->writeSector(currentSector, sectorBuffer);
+		}
+		myDrive->flushFat();
+	}
+	return true;
+}
+
+uint32_t fatFile::GetSectorAt(const uint32_t pos)
+{
+	const auto sector_index        = pos / myDrive->getSectorSize();
+	const auto sectors_per_cluster = myDrive->getClusterSize() /
+	                                 myDrive->getSectorSize();
+
+	const auto cluster = extents.Lookup(*myDrive,
+	                                    firstCluster,
+	                                    sector_index / sectors_per_cluster);
+	if (cluster == 0) {
+		return 0;
+	}
+	return myDrive->getClustFirstSect(cluster) + sector_index % sectors_per_cluster;
+}
+
 bool fatFile::IsOnReadOnlyMedium() const
 {
 	return read_only_medium;
@@ -327,37 +453,27 @@ uint32_t fatDrive::getClustFirstSect(uint32_t clustNum) {
 	return ((clustNum - 2) * bootbuffer.sectorspercluster) + firstDataSector;
 }
 
-uint32_t fatDrive::getClusterValue(uint32_t clustNum) {
-	uint32_t fatoffset=0;
-	uint32_t fatsectnum;
-	uint32_t fatentoff;
-	uint32_t clustValue=0;
-
-	switch(fattype) {
-		case FAT12:
-			fatoffset = clustNum + (clustNum / 2);
-			break;
-		case FAT16:
-			fatoffset = clustNum * 2;
-			break;
-		case FAT32:
-			fatoffset = clustNum * 4;
-			break;
+// Byte offset of a cluster's entry in the FAT
+static uint32_t fat_entry_offset(const uint8_t fattype, const uint32_t clustNum)
+{
+	switch (fattype) {
+	case FAT12: return clustNum + (clustNum / 2);
+	case FAT16: return clustNum * 2;
+	case FAT32: return clustNum * 4;
 	}
-	fatsectnum = bootbuffer.reservedsectors + (fatoffset / bootbuffer.bytespersector) + partSectOff;
-	fatentoff = fatoffset % bootbuffer.bytespersector;
+	return 0;
+}
 
-	if(curFatSect != fatsectnum) {
-		/* Load two sectors at once for FAT12 */
-		readSector(fatsectnum, &fatSectBuffer[0]);
-		if (fattype==FAT12)
-			readSector(fatsectnum + 1, &fatSectBuffer[BytePerSector]);
-		curFatSect = fatsectnum;
+uint32_t fatDrive::getClusterValue(uint32_t clustNum) {
+	const auto fatoffset = fat_entry_offset(fattype, clustNum);
+	if (fatoffset + sizeof(uint32_t) > fatCache.size()) {
+		return 0;
 	}
+	uint32_t clustValue = 0;
 
 	switch(fattype) {
 		case FAT12:
-			clustValue = var_read((uint16_t *)&fatSectBuffer[fatentoff]);
+			clustValue = var_read((uint16_t *)&fatCache[fatoffset]);
 			if(clustNum & 0x1) {
 				clustValue >>= 4;
 			} else {
@@ -365,10 +481,10 @@ uint32_t fatDrive::getClusterValue(uint32_t clustNum) {
 			}
 			break;
 		case FAT16:
-			clustValue = var_read((uint16_t *)&fatSectBuffer[fatentoff]);
+			clustValue = var_read((uint16_t *)&fatCache[fatoffset]);
 			break;
 		case FAT32:
-			clustValue = var_read((uint32_t *)&fatSectBuffer[fatentoff]);
+			clustValue = var_read((uint32_t *)&fatCache[fatoffset]);
 			break;
 	}
 
@@ -376,36 +492,25 @@ uint32_t fatDrive::getClusterValue(uint32_t clustNum) {
 }
 
 void fatDrive::setClusterValue(uint32_t clustNum, uint32_t clustValue) {
-	uint32_t fatoffset=0;
-	uint32_t fatsectnum;
-	uint32_t fatentoff;
-
-	switch(fattype) {
-		case FAT12:
-			fatoffset = clustNum + (clustNum / 2);
-			break;
-		case FAT16:
-			fatoffset = clustNum * 2;
-			break;
-		case FAT32:
-			fatoffset = clustNum * 4;
-			break;
+	const auto fatoffset = fat_entry_offset(fattype, clustNum);
+	if (fatoffset + sizeof(uint32_t) > fatCache.size()) {
+		return;
 	}
-	fatsectnum = bootbuffer.reservedsectors + (fatoffset / bootbuffer.bytespersector) + partSectOff;
-	fatentoff = fatoffset % bootbuffer.bytespersector;
 
-	if(curFatSect != fatsectnum) {
-		/* Load two sectors at once for FAT12 */
-		readSector(fatsectnum, &fatSectBuffer[0]);
-		if (fattype==FAT12)
-			        readSector(fatsectnum + 1,
-			                   &fatSectBuffer[BytePerSector]);
-		curFatSect = fatsectnum;
+	const auto old_value = getClusterValue(clustNum);
+	if (old_value == clustValue) {
+		return;
+	}
+	// Extending a chain or allocating a free cluster keeps existing chains
+	// intact; anything else may invalidate the extent maps of open files
+	if (clustValue == 0 || (old_value != 0 && !isEndOfChain(old_value))) {
+		++chainGeneration;
 	}
 
+	uint32_t entry_size = 0;
 	switch(fattype) {
 		case FAT12: {
-			uint16_t tmpValue = var_read((uint16_t *)&fatSectBuffer[fatentoff]);
+			uint16_t tmpValue = var_read((uint16_t *)&fatCache[fatoffset]);
 			if(clustNum & 0x1) {
 				clustValue &= 0xfff;
 				clustValue <<= 4;
@@ -417,25 +522,117 @@ void fatDrive::setClusterValue(uint32_t clustNum, uint32_t clustValue) {
 				tmpValue &= 0xf000;
 				tmpValue |= (uint16_t)clustValue;
 			}
-			var_write((uint16_t *)&fatSectBuffer[fatentoff], tmpValue);
+			var_write((uint16_t *)&fatCache[fatoffset], tmpValue);
+			entry_size = 2;
 			break;
 			}
 		case FAT16:
-			var_write((uint16_t *)&fatSectBuffer[fatentoff], (uint16_t)clustValue);
+			var_write((uint16_t *)&fatCache[fatoffset], (uint16_t)clustValue);
+			entry_size = 2;
 			break;
 		case FAT32:
-			var_write((uint32_t *)&fatSectBuffer[fatentoff], clustValue);
+			var_write((uint32_t *)&fatCache[fatoffset], clustValue);
+			entry_size = 4;
 			break;
 	}
-	for(int fc=0;fc<bootbuffer.fatcopies;fc++) {
-		writeSector(fatsectnum + (fc * bootbuffer.sectorsperfat), &fatSectBuffer[0]);
-		if (fattype==FAT12) {
-			if (fatentoff>=511)
-				writeSector(fatsectnum + 1 +
-				                    (fc * bootbuffer.sectorsperfat),
-				            &fatSectBuffer[BytePerSector]);
+
+	/* A FAT12 entry can straddle two sectors */
+	const auto first_sector = fatoffset / bootbuffer.bytespersector;
+	const auto last_sector = std::min((fatoffset + entry_size - 1) / bootbuffer.bytespersector,
+	                                  static_cast<uint32_t>(dirtyFatSectors.size() - 1));
+	for (auto sector = first_sector; sector <= last_sector; ++sector) {
+		dirtyFatSectors[sector] = true;
+	}
+	isFatDirty = true;
+}
+
+bool fatDrive::isEndOfChain(const uint32_t clustValue) const
+{
+	switch (fattype) {
+	case FAT12: return clustValue >= 0xff8;
+	case FAT16: return clustValue >= 0xfff8;
+	case FAT32: return clustValue >= 0xfffffff8;
+	}
+	return true;
+}
+
+// Returns the cluster following the given one in its chain, or 0 at the end
+// of the chain or on a free, reserved or bad cluster
+uint32_t fatDrive::getNextCluster(const uint32_t clustNum)
+{
+	const auto is_data_cluster = [this](const uint32_t cluster) {
+		return cluster >= 2 && cluster < CountOfClusters + 2;
+	};
+	if (!is_data_cluster(clustNum)) {
+		return 0;
+	}
+	const auto next_cluster = getClusterValue(clustNum);
+	return is_data_cluster(next_cluster) ? next_cluster : 0;
+}
+
+bool fatDrive::loadFat()
+{
+	const uint32_t fat_size = bootbuffer.sectorsperfat * bootbuffer.bytespersector;
+
+	// Padded so an entry at the very end can be read as a whole word
+	fatCache.assign(fat_size + sizeof(uint32_t), 0);
+	dirtyFatSectors.assign(bootbuffer.sectorsperfat, false);
+	isFatDirty = false;
+
+	return readSectors(bootbuffer.reservedsectors + partSectOff,
+	                   bootbuffer.sectorsperfat,
+	                   fatCache.data()) == 0;
+}
+
+// Writes the changed FAT sectors to every FAT copy, coalescing runs of
+// consecutive sectors
+void fatDrive::flushFat()
+{
+	if (!isFatDirty) {
+		return;
+	}
+	const uint32_t fat_start   = bootbuffer.reservedsectors + partSectOff;
+	const uint32_t num_sectors = bootbuffer.sectorsperfat;
+
+	uint32_t sector = 0;
+	while (sector < num_sectors) {
+		if (!dirtyFatSectors[sector]) {
+			++sector;
+			continue;
+		}
+		auto run_end = sector;
+		while (run_end < num_sectors && dirtyFatSectors[run_end]) {
+			dirtyFatSectors[run_end] = false;
+			++run_end;
 		}
+		for (int fc = 0; fc < bootbuffer.fatcopies; fc++) {
+			writeSectors(fat_start + sector + (fc * bootbuffer.sectorsperfat),
+			             run_end - sector,
+			             &fatCache[sector * bootbuffer.bytespersector]);
+		}
+		sector = run_end;
+	}
+	isFatDirty = false;
+}
+
+// Whether an absolute sector lies in the cached (first) FAT copy
+bool fatDrive::isFatSector(const uint32_t sectnum) const
+{
+	const uint32_t fat_start = bootbuffer.reservedsectors + partSectOff;
+	return sectnum >= fat_start &&
+	       sectnum < fat_start + bootbuffer.sectorsperfat;
+}
+
+// Re-reads the FAT after it was changed behind our back, e.g. by absolute
+// sector writes. Any cluster chain may have changed, so open files have to
+// drop their extent maps.
+void fatDrive::reloadFat()
+{
+	flushFat();
+	if (!loadFat()) {
+		LOG_WARNING("FAT: Failed to re-read the FAT of %s", info);
 	}
+	++chainGeneration;
 }
 
 bool fatDrive::getEntryName(const char *fullname, char *entname) {
@@ -582,6 +779,28 @@ uint8_t fatDrive::readSector(uint32_t sectnum, void * data) {
 	return loadedDisk->Read_Sector(head, cylinder, sector, data);
 }
 
+// Reads consecutive logical sectors; they're only consecutive in the image
+// with absolute addressing, otherwise this goes sector by sector
+uint8_t fatDrive::readSectors(uint32_t sectnum, const uint32_t num_sectors, void* data)
+{
+	// Guard
+	if (!loadedDisk) {
+		return 0;
+	}
+
+	if (absolute) {
+		return loadedDisk->Read_AbsoluteSectors(sectnum, num_sectors, data);
+	}
+	auto sector_data = static_cast<uint8_t*>(data);
+	for (uint32_t i = 0; i < num_sectors; ++i) {
+		if (const auto ret = readSector(sectnum + i, sector_data); ret != 0) {
+			return ret;
+		}
+		sector_data += getSectorSize();
+	}
+	return 0;
+}
+
 uint8_t fatDrive::writeSector(uint32_t sectnum, void * data) {
 	// Guard
 	if (!loadedDisk) {
@@ -599,6 +818,27 @@ uint8_t fatDrive::writeSector(uint32_t sectnum, void * data) {
 	return loadedDisk->Write_Sector(head, cylinder, sector, data);
 }
 
+// Writes consecutive logical sectors, see readSectors()
+uint8_t fatDrive::writeSectors(uint32_t sectnum, const uint32_t num_sectors, void* data)
+{
+	// Guard
+	if (!loadedDisk) {
+		return 0;
+	}
+
+	if (absolute) {
+		return loadedDisk->Write_AbsoluteSectors(sectnum, num_sectors, data);
+	}
+	auto sector_data = static_cast<uint8_t*>(data);
+	for (uint32_t i = 0; i < num_sectors; ++i) {
+		if (const auto ret = writeSector(sectnum + i, sector_data); ret != 0) {
+			return ret;
+		}
+		sector_data += getSectorSize();
+	}
+	return 0;
+}
+
 uint32_t fatDrive::getSectorCount()
 {
 	if (bootbuffer.totalsectorcount != 0)
@@ -791,9 +1031,7 @@ fatDrive::fatDrive(const char *sysFilename,
 	  CountOfClusters(0),
 	  firstDataSector(0),
 	  firstRootDirSect(0),
-	  cwdDirCluster(0),
-	  fatSectBuffer{0},
-	  curFatSect(0)
+	  cwdDirCluster(0)
 {
 	FILE *diskfile;
 	uint32_t filesize;
@@ -984,13 +1222,21 @@ fatDrive::fatDrive(const char *sysFilename,
 	/* There is no cluster 0, this means we are in the root directory */
 	cwdDirCluster = 0;
 
-	memset(fatSectBuffer,0,1024);
-	curFatSect = 0xffffffff;
+	if (!loadFat()) {
+		LOG_MSG("FAT: Failed to read the FAT of %s", sysFilename);
+		created_successfully = false;
+		return;
+	}
 
 	type = DosDriveType::Fat;
 	safe_strcpy(info, sysFilename);
 }
 
+fatDrive::~fatDrive()
+{
+	flushFat();
+}
+
 bool fatDrive::AllocationInfo(uint16_t *_bytes_sector, uint8_t *_sectors_cluster, uint16_t *_total_clusters, uint16_t *_free_clusters) {
 	// Guard
 	if (!loadedDisk) {
@@ -1126,6 +1372,8 @@ std::unique_ptr<DOS_File> fatDrive::FileCreate(const char* name,
 	fat_file->time       = fileEntry.modTime;
 	fat_file->date       = fileEntry.modDate;
 
+	flushFat();
+
 	dos.errorcode=save_errorcode;
 	return fat_file;
 }
@@ -1209,6 +1457,7 @@ bool fatDrive::FileUnlink(const char * name) {
 	directoryChange(dirClust, &fileEntry, subEntry);
 
 	if(fileEntry.loFirstClust != 0) deleteClustChain(fileEntry.loFirstClust, 0);
+	flushFat();
 
 	return true;
 }
@@ -1600,6 +1849,7 @@ bool fatDrive::MakeDir(const char* dir)
 	tmpentry.hiFirstClust = (uint16_t)(dirClust >> 16);
 	tmpentry.attrib       = FatAttributeFlags::Directory;
 	addDirectoryEntry(dummyClust, tmpentry);
+	flushFat();
 
 	return true;
 }
@@ -1650,6 +1900,7 @@ bool fatDrive::RemoveDir(const char *dir) {
 			tmpentry.entryname[0] = 0xe5;
 			directoryChange(dirClust, &tmpentry, fileidx);
 			deleteClustChain(dummyClust, 0);
+			flushFat();
 
 			break;
 		}
@@ -1690,6 +1941,7 @@ bool fatDrive::Rename(const char * oldname, const char * newname) {
 		memcpy(&fileEntry2, &fileEntry1, sizeof(direntry));
 		memcpy(&fileEntry2.entryname, &pathName2[0], 11);
 		addDirectoryEntry(dirClust2, fileEntry2);
+		flushFat();
 
 		/* Check if file exists now */
 		if(!getFileDirEntry(newname, &fileEntry2, &dirClust2, &subEntry2)) return false;
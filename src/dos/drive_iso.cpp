@@ -20,6 +20,7 @@
 
 #include <cctype>
 #include <cstring>
+#include <utility>
 
 #include "cdrom.h"
 #include "dos_mscdex.h"
@@ -158,7 +159,6 @@ isoDrive::isoDrive(char driveLetter, const char *fileName, uint8_t mediaid, int
 	this->fileName[0]  = '\0';
 	this->discLabel[0] = '\0';
 	memset(dirIterators, 0, sizeof(dirIterators));
-	memset(sectorHashEntries, 0, sizeof(sectorHashEntries));
 	memset(&rootEntry, 0, sizeof(isoDirEntry));
 
 	safe_strcpy(this->fileName, fileName);
@@ -404,12 +404,7 @@ Bits isoDrive::UnMount()
 int isoDrive::GetDirIterator(const isoDirEntry* de) {
 	int dirIterator = nextFreeDirIterator;
 
-	// get start and end sector of the directory entry (pad end sector if necessary)
-	dirIterators[dirIterator].currentSector = EXTENT_LOCATION(*de);
-	dirIterators[dirIterator].endSector =
-		EXTENT_LOCATION(*de) + DATA_LENGTH(*de) / ISO_FRAMESIZE - 1;
-	if (DATA_LENGTH(*de) % ISO_FRAMESIZE != 0)
-		dirIterators[dirIterator].endSector++;
+	dirIterators[dirIterator].entries = GetDirEntries(de);
 
 	// reset position and mark as valid
 	dirIterators[dirIterator].pos = 0;
@@ -422,37 +417,14 @@ int isoDrive::GetDirIterator(const isoDirEntry* de) {
 }
 
 bool isoDrive::GetNextDirEntry(const int dirIteratorHandle, isoDirEntry* de) {
-	bool result = false;
-	uint8_t* buffer = nullptr;
 	DirIterator& dirIterator = dirIterators[dirIteratorHandle];
 
-	// check if the directory entry is valid
-	if (dirIterator.valid && ReadCachedSector(&buffer, dirIterator.currentSector)) {
-		// check if the next sector has to be read
-		if ((dirIterator.pos >= ISO_FRAMESIZE)
-		 || (buffer[dirIterator.pos] == 0)
-		 || (dirIterator.pos + buffer[dirIterator.pos] > ISO_FRAMESIZE)) {
-
-			// check if there is another sector available
-		 	if (dirIterator.currentSector < dirIterator.endSector) {
-			 	dirIterator.pos = 0;
-			 	dirIterator.currentSector++;
-			 	if (!ReadCachedSector(&buffer, dirIterator.currentSector)) {
-			 		return false;
-			 	}
-		 	} else {
-		 		return false;
-		 	}
-		 }
-		 // read sector and advance sector pointer
-		 const int length = readDirEntry(de, &buffer[dirIterator.pos]);
-		 result = length >= 0;
-		 if (length >= 0)
-			 dirIterator.pos += static_cast<unsigned>(length);
-		 else // read failed, so step back to our prior iterator
-			 dirIterator.pos--;
+	if (!dirIterator.valid || !dirIterator.entries ||
+	    dirIterator.pos >= dirIterator.entries->size()) {
+		return false;
 	}
-	return result;
+	*de = (*dirIterator.entries)[dirIterator.pos++];
+	return true;
 }
 
 void isoDrive::FreeDirIterator(const int dirIterator) {
@@ -468,22 +440,41 @@ void isoDrive::FreeDirIterator(const int dirIterator) {
 	}
 }
 
-bool isoDrive::ReadCachedSector(uint8_t** buffer, const uint32_t sector) {
-	// get hash table entry
-	int pos = sector % ISO_MAX_HASH_TABLE_SIZE;
-	SectorHashEntry& he = sectorHashEntries[pos];
+// Returns the parsed entries of a directory, reading and caching them on first
+// use, or nullptr if the directory can't be read
+const std::vector<isoDirEntry>* isoDrive::GetDirEntries(const isoDirEntry* de) {
+	const auto first_sector = EXTENT_LOCATION(*de);
+	if (const auto it = dirCache.find(first_sector); it != dirCache.end()) {
+		return &it->second;
+	}
 
-	// check if the entry is valid and contains the correct sector
-	if (!he.valid || he.sector != sector) {
-		if (!CDROM::cdroms[subUnit]->ReadSector(he.data, false, sector)) {
-			return false;
+	// get the number of sectors of the directory (pad if necessary)
+	auto num_sectors = DATA_LENGTH(*de) / ISO_FRAMESIZE;
+	if (DATA_LENGTH(*de) % ISO_FRAMESIZE != 0 || num_sectors == 0)
+		num_sectors++;
+
+	std::vector<isoDirEntry> entries = {};
+	uint8_t buffer[ISO_FRAMESIZE];
+	for (uint32_t i = 0; i < num_sectors; ++i) {
+		if (!readSector(buffer, first_sector + i)) {
+			return nullptr;
+		}
+		// entries don't cross sectors; a zero length pads out the rest
+		uint32_t pos = 0;
+		while (pos < ISO_FRAMESIZE && buffer[pos] != 0 &&
+		       pos + buffer[pos] <= ISO_FRAMESIZE) {
+			isoDirEntry entry = {};
+			const int length = readDirEntry(&entry, &buffer[pos]);
+			if (length < 0) {
+				// unsupported entries end the directory listing
+				i = num_sectors;
+				break;
+			}
+			entries.push_back(entry);
+			pos += static_cast<uint32_t>(length);
 		}
-		he.valid = true;
-		he.sector = sector;
 	}
-
-	*buffer = he.data;
-	return true;
+	return &dirCache.emplace(first_sector, std::move(entries)).first->second;
 }
 
 inline bool isoDrive::readSector(uint8_t *buffer, uint32_t sector) {
@@ -545,6 +536,8 @@ bool isoDrive :: loadImage() {
 	uint16_t offset = iso ? 156 : 180;
 	if (readDirEntry(&this->rootEntry, &pvd[offset])>0) {
 		dataCD = true;
+		// index the root directory up front
+		GetDirEntries(&this->rootEntry);
 		return true;
 	}
 	return false;
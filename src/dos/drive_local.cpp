@@ -25,6 +25,7 @@
 #include "drives.h"
 #include "drive_local.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <climits>
 #include <cstdio>
@@ -39,7 +40,7 @@
 #include "fs_utils.h"
 #include "string_utils.h"
 #include "cross.h"
-#include "inout.h"
+#include "pic.h"
 
 bool localDrive::FileIsReadOnly(const char* name)
 {
@@ -77,8 +78,12 @@ std::unique_ptr<DOS_File> localDrive::FileCreate(const char* name,
 
 	const bool file_exists = FileExists(expanded_name);
 
+	// Creating an existing file truncates it under any open handles
+	localFile::FlushPendingWrites();
+
 	attributes.archive = true;
 	NativeFileHandle file_handle = create_native_file(expanded_name, attributes);
+	localFile::DropReadBuffers();
 
 	if (file_handle == InvalidNativeFileHandle) {
 		LOG_MSG("Warning: file creation failed: %s", expanded_name);
@@ -135,6 +140,7 @@ void localDrive::MaybeLogFilesystemProtection(const std::string& filename)
 
 std::unique_ptr<DOS_File> localDrive::FileOpen(const char* name, uint8_t flags)
 {
+	localFile::FlushPendingWrites();
 	bool write_access = false;
 	switch (flags & 0xf) {
 		case OPEN_READ:
@@ -220,6 +226,7 @@ std::unique_ptr<DOS_File> localDrive::FileOpen(const char* name, uint8_t flags)
 
 FILE* localDrive::GetHostFilePtr(const char* const name, const char* const type)
 {
+	localFile::FlushPendingWrites();
 	return fopen(MapDosToHostFilename(name).c_str(), type);
 }
 
@@ -235,6 +242,7 @@ std::string localDrive::MapDosToHostFilename(const char* const dos_name)
 // Attempt to delete the file name from our local drive mount
 bool localDrive::FileUnlink(const char* name)
 {
+	localFile::FlushPendingWrites();
 	assert(!IsReadOnly());
 
 	if (!FileExists(name)) {
@@ -270,6 +278,7 @@ bool localDrive::FileUnlink(const char* name)
 
 bool localDrive::FindFirst(const char* _dir, DOS_DTA& dta, bool fcb_findfirst)
 {
+	localFile::FlushPendingWrites();
 	char tempDir[CROSS_LEN];
 	safe_strcpy(tempDir, basedir);
 	safe_strcat(tempDir, _dir);
@@ -333,6 +342,7 @@ bool localDrive::FindFirst(const char* _dir, DOS_DTA& dta, bool fcb_findfirst)
 
 bool localDrive::FindNext(DOS_DTA& dta)
 {
+	localFile::FlushPendingWrites();
 	char* dir_ent;
 	struct stat stat_block;
 	char full_name[CROSS_LEN];
@@ -413,6 +423,7 @@ bool localDrive::FindNext(DOS_DTA& dta)
 
 bool localDrive::GetFileAttr(const char* name, FatAttributeFlags* attr)
 {
+	localFile::FlushPendingWrites();
 	if (local_drive_get_attributes(MapDosToHostFilename(name), *attr) != DOSERR_NONE) {
 		// The caller is responsible to act accordingly, possibly
 		// it should set DOS error code (setting it here is not allowed)
@@ -429,6 +440,7 @@ bool localDrive::GetFileAttr(const char* name, FatAttributeFlags* attr)
 
 bool localDrive::SetFileAttr(const char* name, const FatAttributeFlags attr)
 {
+	localFile::FlushPendingWrites();
 	assert(!IsReadOnly());
 	const std::string host_filename = MapDosToHostFilename(name);
 
@@ -492,6 +504,7 @@ bool localDrive::TestDir(const char* dir)
 
 bool localDrive::Rename(const char* oldname, const char* newname)
 {
+	localFile::FlushPendingWrites();
 	assert(!IsReadOnly());
 	const std::string old_host_filename = MapDosToHostFilename(oldname);
 
@@ -565,6 +578,161 @@ localDrive::localDrive(const char* startdir, uint16_t _bytes_sector,
 	dirCache.SetBaseDir(basedir);
 }
 
+// Host-side buffering of local files
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Several DOS handles (even on different drives) can refer to the same host
+// file, so at most one local file holds unwritten data at a time: any other
+// file flushes it before it touches the host. Every write that reaches the
+// host bumps a generation counter, which invalidates all read-ahead buffers
+// filled before it.
+
+constexpr size_t MinReadAheadSize    = 4 * 1024;
+constexpr size_t MaxReadAheadSize    = 64 * 1024;
+constexpr size_t WriteBufferCapacity = 32 * 1024;
+
+// Writes at least this big gain nothing from buffering
+constexpr size_t DirectWriteSize = 16 * 1024;
+
+static localFile* pending_writer        = nullptr;
+static uint64_t native_write_generation = 0;
+
+void localFile::FlushPendingWrites()
+{
+	if (pending_writer) {
+		pending_writer->FlushWriteBuffer();
+	}
+}
+
+void localFile::DropReadBuffers()
+{
+	++native_write_generation;
+}
+
+bool localFile::SeekNative(const uint32_t native_pos)
+{
+	if (native_position == native_pos) {
+		return true;
+	}
+	native_position = seek_native_file(file_handle, native_pos, NativeSeek::Set);
+	if (native_position == NativeSeekFailed) {
+		LOG_WARNING("FS: File seek failed for '%s'", path.string().c_str());
+		return false;
+	}
+	return true;
+}
+
+bool localFile::FlushWriteBuffer()
+{
+	if (write_buffer.empty()) {
+		return true;
+	}
+	if (pending_writer == this) {
+		pending_writer = nullptr;
+	}
+	const auto num_bytes = static_cast<int64_t>(write_buffer.size());
+
+	NativeIoResult ret = {};
+	if (SeekNative(write_buffer_start)) {
+		ret = write_native_file(file_handle, write_buffer.data(), num_bytes);
+		native_position = ret.error ? NativeSeekFailed
+		                            : native_position + ret.num_bytes;
+	} else {
+		ret.error = true;
+	}
+	++native_write_generation;
+	write_buffer.clear();
+
+	if (ret.error || ret.num_bytes != num_bytes) {
+		LOG_WARNING("FS: Failed writing back %lld bytes to '%s'",
+		            static_cast<long long>(num_bytes),
+		            path.string().c_str());
+		DOS_SetError(DOSERR_ACCESS_DENIED);
+		return false;
+	}
+	return true;
+}
+
+bool localFile::SyncNativeFile()
+{
+	assert(file_handle != InvalidNativeFileHandle);
+
+	const auto flushed = FlushWriteBuffer();
+	read_buffer_size   = 0;
+	return SeekNative(position) && flushed;
+}
+
+bool localFile::Flush()
+{
+	return FlushWriteBuffer();
+}
+
+// Copies as much of the request as the read-ahead buffer holds
+size_t localFile::ReadFromBuffer(uint8_t* data, const size_t num_bytes)
+{
+	if (read_buffer_generation != native_write_generation ||
+	    position < read_buffer_start ||
+	    position >= read_buffer_start + read_buffer_size) {
+		return 0;
+	}
+	const auto offset = position - read_buffer_start;
+	const auto chunk  = std::min(num_bytes, read_buffer_size - offset);
+	memcpy(data, read_buffer.data() + offset, chunk);
+	position += check_cast<uint32_t>(chunk);
+	return chunk;
+}
+
+// Reads straight into the caller's buffer, for requests at least as big as
+// the read-ahead
+size_t localFile::ReadDirect(uint8_t* data, const size_t num_bytes)
+{
+	if (!SeekNative(position)) {
+		return 0;
+	}
+	const auto ret = read_native_file(file_handle,
+	                                  data,
+	                                  static_cast<int64_t>(num_bytes));
+	if (ret.error) {
+		native_position = NativeSeekFailed;
+		return 0;
+	}
+	native_position += ret.num_bytes;
+	position += check_cast<uint32_t>(ret.num_bytes);
+	return static_cast<size_t>(ret.num_bytes);
+}
+
+bool localFile::FillReadBuffer()
+{
+	// Grow the read-ahead while the file is read sequentially, and start
+	// over small after a seek
+	const bool is_sequential = (read_buffer_size > 0 &&
+	                            position == read_buffer_start + read_buffer_size);
+	read_ahead_size = is_sequential
+	                        ? std::min(read_ahead_size * 2, MaxReadAheadSize)
+	                        : MinReadAheadSize;
+
+	read_buffer_size = 0;
+	if (!SeekNative(position)) {
+		return false;
+	}
+	if (read_buffer.size() < read_ahead_size) {
+		read_buffer.resize(read_ahead_size);
+	}
+	const auto ret = read_native_file(file_handle,
+	                                  read_buffer.data(),
+	                                  static_cast<int64_t>(read_ahead_size));
+	if (ret.error) {
+		native_position = NativeSeekFailed;
+		return false;
+	}
+	native_position += ret.num_bytes;
+
+	read_buffer_start      = position;
+	read_buffer_size       = static_cast<size_t>(ret.num_bytes);
+	read_buffer_generation = native_write_generation;
+	is_read_buffer_at_eof  = (read_buffer_size < read_ahead_size);
+	return true;
+}
+
 bool localFile::Read(uint8_t *data, uint16_t *size)
 {
 	assert(file_handle != InvalidNativeFileHandle);
@@ -574,9 +742,43 @@ bool localFile::Read(uint8_t *data, uint16_t *size)
 		return false;
 	}
 
-	const auto ret = read_native_file(file_handle, data, *size);
-	*size          = check_cast<uint16_t>(ret.num_bytes);
-	if (ret.error) {
+	// Reads have to see all writes, ours and those to other handles
+	FlushPendingWrites();
+
+	const size_t num_requested = *size;
+	size_t num_read            = 0;
+	bool is_ok                 = true;
+
+	while (num_read < num_requested) {
+		const auto num_remaining = num_requested - num_read;
+
+		const auto from_buffer = ReadFromBuffer(data + num_read, num_remaining);
+		if (from_buffer) {
+			num_read += from_buffer;
+			continue;
+		}
+		const bool is_at_buffered_eof = is_read_buffer_at_eof &&
+		                                read_buffer_generation ==
+		                                        native_write_generation &&
+		                                position == read_buffer_start +
+		                                                    read_buffer_size;
+		if (is_at_buffered_eof) {
+			break;
+		}
+		if (num_remaining >= std::max(read_ahead_size, MinReadAheadSize)) {
+			const auto direct = ReadDirect(data + num_read, num_remaining);
+			is_ok = (native_position != NativeSeekFailed);
+			num_read += direct;
+			break;
+		}
+		is_ok = FillReadBuffer();
+		if (!is_ok || read_buffer_size == 0) {
+			break;
+		}
+	}
+
+	*size = check_cast<uint16_t>(num_read);
+	if (!is_ok) {
 		DOS_SetError(DOSERR_ACCESS_DENIED);
 		return false;
 	}
@@ -585,25 +787,20 @@ bool localFile::Read(uint8_t *data, uint16_t *size)
 	/* Same for Igor */
 	/* hardrive motion => unmask irq 2. Only do it when it's masked as
 	 * unmasking is realitively heavy to emulate */
-	uint8_t mask = IO_Read(0x21);
-	if (mask & 0x4)
-		IO_Write(0x21, mask & 0xfb);
+	if (PIC_IsIRQMasked(2)) {
+		PIC_SetIRQMask(2, false);
+	}
 	return true;
 }
 
-bool localFile::Write(uint8_t *data, uint16_t *size)
+// Writes straight to the host, for truncation and writes too big to buffer
+bool localFile::WriteDirect(const uint8_t* data, uint16_t* size)
 {
-	assert(file_handle != InvalidNativeFileHandle);
-	uint8_t lastflags = this->flags & 0xf;
-	if (lastflags == OPEN_READ || lastflags == OPEN_READ_NO_MOD) {	// check if file opened in read-only mode
+	if (!SyncNativeFile()) {
 		DOS_SetError(DOSERR_ACCESS_DENIED);
 		return false;
 	}
-
-	// File should always be opened in read-only mode if on read-only drive
-	assert(!IsOnReadOnlyMedium());
-
-	set_archive_on_close = true;
+	++native_write_generation;
 
 	// Truncate the file
 	if (*size == 0) {
@@ -619,9 +816,57 @@ bool localFile::Write(uint8_t *data, uint16_t *size)
 	const auto ret = write_native_file(file_handle, data, *size);
 	*size          = check_cast<uint16_t>(ret.num_bytes);
 	if (ret.error) {
+		native_position = NativeSeekFailed;
 		DOS_SetError(DOSERR_ACCESS_DENIED);
 		return false;
 	}
+	native_position += ret.num_bytes;
+	position += *size;
+	return true;
+}
+
+bool localFile::Write(uint8_t *data, uint16_t *size)
+{
+	assert(file_handle != InvalidNativeFileHandle);
+	uint8_t lastflags = this->flags & 0xf;
+	if (lastflags == OPEN_READ || lastflags == OPEN_READ_NO_MOD) {	// check if file opened in read-only mode
+		DOS_SetError(DOSERR_ACCESS_DENIED);
+		return false;
+	}
+
+	// File should always be opened in read-only mode if on read-only drive
+	assert(!IsOnReadOnlyMedium());
+
+	set_archive_on_close = true;
+
+	// Only one file may hold unwritten data
+	if (pending_writer && pending_writer != this) {
+		pending_writer->FlushWriteBuffer();
+	}
+
+	const size_t num_bytes = *size;
+	if (num_bytes == 0 || num_bytes >= DirectWriteSize) {
+		return WriteDirect(data, size);
+	}
+
+	// Our own read-ahead data is stale from here on
+	read_buffer_size = 0;
+
+	// Only append to the write-back buffer if the write continues it
+	const bool is_contiguous = (position == write_buffer_start +
+	                                                write_buffer.size());
+	if (!write_buffer.empty() &&
+	    (!is_contiguous || write_buffer.size() + num_bytes > WriteBufferCapacity) &&
+	    !FlushWriteBuffer()) {
+		return false;
+	}
+	if (write_buffer.empty()) {
+		write_buffer.reserve(WriteBufferCapacity);
+		write_buffer_start = position;
+	}
+	write_buffer.insert(write_buffer.end(), data, data + num_bytes);
+	position += *size;
+	pending_writer = this;
 
 	return true;
 }
@@ -643,17 +888,15 @@ bool localFile::Seek(uint32_t *pos_addr, uint32_t type)
 			break;
 		}
 		case DOS_SEEK_CUR: {
-			const auto current_pos = get_native_file_position(file_handle);
-			if (current_pos == NativeSeekFailed) {
-				LOG_WARNING("FS: File seek failed for '%s'", path.string().c_str());
-				DOS_SetError(DOSERR_ACCESS_DENIED);
-				return false;
-			}
-			seek_to = check_cast<uint32_t>(current_pos) + *pos_addr;
+			// The position is tracked here, so no need to ask the host
+			seek_to = position + *pos_addr;
 			break;
 		}
 		case DOS_SEEK_END: {
+			// The file size has to include all buffered writes
+			FlushPendingWrites();
 			const auto end_pos = seek_native_file(file_handle, 0, NativeSeek::End);
+			native_position = end_pos;
 			if (end_pos == NativeSeekFailed) {
 				LOG_WARNING("FS: File seek failed for '%s'", path.string().c_str());
 				DOS_SetError(DOSERR_ACCESS_DENIED);
@@ -670,18 +913,9 @@ bool localFile::Seek(uint32_t *pos_addr, uint32_t type)
 		}
 	}
 
-	// Always use NativeSeek::Set set since we calculate the absolute value above
-	auto returned_pos = seek_native_file(file_handle, seek_to, NativeSeek::Set);
-
-	if (returned_pos == NativeSeekFailed) {
-		LOG_WARNING("FS: File seek failed for '%s'", path.string().c_str());
-		DOS_SetError(DOSERR_ACCESS_DENIED);
-		return false;
-	}
-
-	// The returned value is always positive.
-	// It can exceed 32-bit signed max (ex. Blackthorne)
-	*pos_addr = check_cast<uint32_t>(returned_pos);
+	// The host file only gets seeked once it's read or written
+	position  = seek_to;
+	*pos_addr = seek_to;
 
 	return true;
 }
@@ -726,6 +960,10 @@ void localFile::Close()
 {
 	assert(file_handle != InvalidNativeFileHandle);
 
+	// Write back before the attributes and time are set, as writing would
+	// change them again
+	FlushWriteBuffer();
+
 	// only close if one reference left
 	if (refCtr == 1) {
 		if (set_archive_on_close) {
@@ -745,7 +983,9 @@ void localFile::Close()
 		MaybeFlushTime();
 
 		close_native_file(file_handle);
-		file_handle = InvalidNativeFileHandle;
+		file_handle      = InvalidNativeFileHandle;
+		read_buffer      = {};
+		read_buffer_size = 0;
 	} else {
 		MaybeFlushTime();
 	}
@@ -780,6 +1020,12 @@ localFile::localFile(const char* _name, const std_fs::path& path,
 
 localFile::~localFile()
 {
+	// Ownership of the handle may have been taken over, leaving data
+	// that was never written back
+	if (pending_writer == this) {
+		pending_writer = nullptr;
+	}
+
 	// Make sure we close the host file handle and flush the timestamps.
 	// This can happen if the user closes DOSBox while a game is running.
 	// It can also happen if a game leaks file handles. Ex: Crystal Caves
@@ -23,6 +23,8 @@
 #include "dos_system.h"
 #include "drives.h"
 
+#include <vector>
+
 class localFile : public DOS_File {
 public:
 	localFile(const char* name, const std_fs::path& path,
@@ -36,6 +38,7 @@ public:
 	bool Write(uint8_t* data, uint16_t* size) override;
 	bool Seek(uint32_t* pos, uint32_t type) override;
 	void Close() override;
+	bool Flush() override;
 	uint16_t GetInformation() override;
 	bool IsOnReadOnlyMedium() const override { return read_only_medium; }
 	const char* GetBaseDir() const
@@ -46,14 +49,57 @@ public:
 	{
 		return path;
 	}
+
+	// Writes back buffered data, drops the read-ahead buffer, and moves the
+	// host file position to the DOS file position. Call this before using
+	// the file_handle directly.
+	bool SyncNativeFile();
+
+	// Writes back the buffered data of whichever local file has some, so
+	// the host file system is up to date before it gets inspected.
+	static void FlushPendingWrites();
+
+	// Drops the read-ahead data of all local files, for when host files
+	// were changed without going through them.
+	static void DropReadBuffers();
+
 	const std::weak_ptr<localDrive> local_drive = {};
 	NativeFileHandle file_handle = InvalidNativeFileHandle;
 
 private:
 	void MaybeFlushTime();
+	bool FlushWriteBuffer();
+	bool SeekNative(uint32_t native_pos);
+	bool FillReadBuffer();
+	size_t ReadFromBuffer(uint8_t* data, size_t num_bytes);
+	size_t ReadDirect(uint8_t* data, size_t num_bytes);
+	bool WriteDirect(const uint8_t* data, uint16_t* size);
+
 	const std_fs::path path = {};
 	const char* basedir     = nullptr;
 
+	// Host-side buffering
+	// ~~~~~~~~~~~~~~~~~~~
+	// DOS programs often read and write files a few bytes at a time, so
+	// reads are served from a read-ahead buffer that grows while the file
+	// is read sequentially, and small sequential writes are collected in a
+	// write-back buffer. The DOS file position is tracked here, so the host
+	// file is only seeked when it actually gets read or written.
+	uint32_t position = 0;
+
+	// Where the host file handle is; unknown until the first seek
+	int64_t native_position = NativeSeekFailed;
+
+	std::vector<uint8_t> read_buffer = {};
+	uint32_t read_buffer_start       = 0;
+	size_t read_buffer_size          = 0;
+	size_t read_ahead_size           = 0;
+	uint64_t read_buffer_generation  = 0;
+	bool is_read_buffer_at_eof       = false;
+
+	std::vector<uint8_t> write_buffer = {};
+	uint32_t write_buffer_start       = 0;
+
 	const bool read_only_medium = false;
 	bool set_archive_on_close   = false;
 };
@@ -27,6 +27,7 @@
 #include <cstring>
 #include <ctime>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "dos_inc.h"
@@ -225,6 +226,9 @@ public:
 	{
 		refCtr = file->refCtr;
 
+		// Nothing may be left buffered for the handle we take over
+		file->SyncNativeFile();
+
 		// We are taking ownership of the file handle.
 		// Set this to invalid so localFile's destructor won't close it.
 		file->file_handle = InvalidNativeFileHandle;
@@ -282,6 +286,9 @@ std::pair<NativeFileHandle, std_fs::path> Overlay_Drive::create_file_in_overlay(
 		//try again
 		file_handle = create_native_file(newname, attributes);
 	}
+	if (file_handle != InvalidNativeFileHandle) {
+		add_DOSname_to_cache(dos_filename);
+	}
 
 	return {file_handle, newname};
 }
@@ -311,6 +318,11 @@ bool OverlayFile::create_copy()
 
 	assert(file_handle != InvalidNativeFileHandle);
 
+	// Copy what we've written so far, from the current position
+	if (!SyncNativeFile()) {
+		return false;
+	}
+
 	const auto location_in_old_file = get_native_file_position(file_handle);
 	if (location_in_old_file == NativeSeekFailed) {
 		LOG_ERR("OVERLAY: Failed getting current position in file '%s': %s",
@@ -383,8 +395,13 @@ Overlay_Drive::Overlay_Drive(const char *startdir,
           overlap_folder(),
           DOSnames_cache{},
           DOSdirs_cache{},
+          DOSdirs_index{},
           special_prefix("DBOVERLAY")
 {
+	// The cache holds entries that only exist in the overlay, which a
+	// watched directory would lose when it's cached out
+	dirCache.DisableHostWatch();
+
 	//Currently this flag does nothing, as the current behavior is to not reread due to caching everything.
 #if defined (WIN32)	
 	if (strcasecmp(startdir,overlay) == 0) {
@@ -415,7 +432,12 @@ Overlay_Drive::Overlay_Drive(const char *startdir,
 	//add_deleted_path(dirname); //update_cache will add the overlap_folder
 	overlap_folder = dirname;
 
-	update_cache(true);
+	// Only scan the overlay if it has no journal yet
+	if (load_journal()) {
+		update_cache(false);
+	} else {
+		update_cache(true);
+	}
 }
 
 void Overlay_Drive::convert_overlay_to_DOSname_in_base(char* dirname ) 
@@ -472,6 +494,8 @@ void Overlay_Drive::convert_overlay_to_DOSname_in_base(char* dirname )
 
 std::unique_ptr<DOS_File> Overlay_Drive::FileOpen(const char* name, uint8_t flags)
 {
+	localFile::FlushPendingWrites();
+
 	bool write_access = false;
 	switch (flags & 0xf) {
 	case OPEN_READ:
@@ -556,7 +580,11 @@ std::unique_ptr<DOS_File> Overlay_Drive::FileCreate(const char* name,
 		return nullptr;
 	}
 
+	// Creating an existing file truncates it under any open handles
+	localFile::FlushPendingWrites();
+
 	auto [file_handle, path] = create_file_in_overlay(name, attributes);
+	localFile::DropReadBuffers();
 	if (file_handle == InvalidNativeFileHandle) {
 		if (logoverlay) {
 			LOG_MSG("File creation in overlay system failed %s", name);
@@ -594,17 +622,15 @@ std::unique_ptr<DOS_File> Overlay_Drive::FileCreate(const char* name,
 }
 
 void Overlay_Drive::add_DOSname_to_cache(const char* name) {
-	for (std::vector<std::string>::const_iterator itc = DOSnames_cache.begin(); itc != DOSnames_cache.end(); ++itc){
-		if (name == (*itc)) return;
+	if (DOSnames_cache.insert(name).second) {
+		append_to_journal('+', 'F', name);
 	}
-	DOSnames_cache.push_back(name);
 }
 
 void Overlay_Drive::remove_DOSname_from_cache(const char* name) {
-	for (std::vector<std::string>::iterator it = DOSnames_cache.begin(); it != DOSnames_cache.end(); ++it) {
-		if (name == (*it)) { DOSnames_cache.erase(it); return;}
+	if (DOSnames_cache.erase(name)) {
+		append_to_journal('-', 'F', name);
 	}
-
 }
 
 bool Overlay_Drive::Sync_leading_dirs(const char* dos_filename){
@@ -660,9 +686,13 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 	std::vector<std::string> dirnames;
 	std::vector<std::string> filenames;
 	if (read_directory_contents) {
+		//The journal is rewritten from the lists once they're rebuilt
+		is_journal_active = false;
+
 		//Clear all lists
 		DOSnames_cache.clear();
 		DOSdirs_cache.clear();
+		DOSdirs_index.clear();
 		deleted_files_in_base.clear();
 		deleted_paths_in_base.clear();
 		//Ensure hiding of the folder that contains the overlay, if it is part of the base folder.
@@ -787,7 +817,7 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 			upcase(dosname);  //Should not be really needed, as uppercase in the overlay is a requirement...
 			CROSS_DOSFILENAME(dosname);
 			if (logoverlay) LOG_MSG("update cache add dosname %s",dosname);
-			DOSnames_cache.push_back(dosname);
+			DOSnames_cache.insert(dosname);
 		}
 	}
 
@@ -801,10 +831,10 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 	}
 #endif
 
-	for (i = DOSnames_cache.begin(); i != DOSnames_cache.end(); ++i) {
+	for (const auto& dosname : DOSnames_cache) {
 		char fakename[CROSS_LEN];
 		safe_strcpy(fakename, basedir);
-		safe_strcat(fakename, (*i).c_str());
+		safe_strcat(fakename, dosname.c_str());
 		CROSS_FILENAME(fakename);
 		dirCache.AddEntry(fakename,true);
 	}
@@ -848,6 +878,7 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 			}
 
 		}
+		write_journal();
 	}
 	if (logoverlay) {
 		LOG_MSG("OPTIMISE: update cache took %" PRId64, GetTicksSince(a));
@@ -855,6 +886,7 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 }
 
 bool Overlay_Drive::FindNext(DOS_DTA & dta) {
+	localFile::FlushPendingWrites();
 
 	char * dir_ent;
 	struct stat stat_block;
@@ -966,6 +998,7 @@ again:
 
 
 bool Overlay_Drive::FileUnlink(const char * name) {
+	localFile::FlushPendingWrites();
 	// TODO check the basedir for file existence in order if we need to add the file to deleted file list.
 	const auto a = logoverlay ? GetTicks() : 0;
 	if (logoverlay)
@@ -1048,6 +1081,8 @@ bool Overlay_Drive::GetFileAttr(const char* name, FatAttributeFlags* attr)
 
 bool Overlay_Drive::SetFileAttr(const char* name, FatAttributeFlags attr)
 {
+	localFile::FlushPendingWrites();
+
 	char overlayname[CROSS_LEN];
 	safe_strcpy(overlayname, overlaydir);
 	safe_strcat(overlayname, name);
@@ -1073,8 +1108,8 @@ bool Overlay_Drive::SetFileAttr(const char* name, FatAttributeFlags attr)
 
 void Overlay_Drive::add_deleted_file(const char* name,bool create_on_disk) {
 	if (logoverlay) LOG_MSG("add del file %s",name);
-	if (!is_deleted_file(name)) {
-		deleted_files_in_base.push_back(name);
+	if (deleted_files_in_base.insert(name).second) {
+		append_to_journal('+', 'X', name);
 		if (create_on_disk) add_special_file_to_disk(name, "DEL");
 
 	}
@@ -1106,7 +1141,7 @@ void Overlay_Drive::remove_special_file_from_disk(const char* dosname, const cha
 	if(unlink(overlayname) != 0) E_Exit("Failed removal of %s",overlayname);
 }
 
-std::string Overlay_Drive::create_filename_of_special_operation(const char* dosname, const char* operation) {
+std::string Overlay_Drive::create_filename_of_special_operation(const char* dosname, const char* operation) const {
 	std::string res(dosname);
 	std::string::size_type s = res.rfind('\\'); //CHECK DOS or host endings.... on update_cache
 	if (s == std::string::npos) s = 0; else s++;
@@ -1116,55 +1151,226 @@ std::string Overlay_Drive::create_filename_of_special_operation(const char* dosn
 }
 
 
+// Journal of the overlay state
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// One line per change: '+' or '-', the kind of entry, and its DOS name.
+//   F = file in the overlay, D = directory only in the overlay,
+//   X = base file marked deleted, P = base path marked deleted.
+// The DBOVERLAY_ prefix hides it from DOS like the other special files. Only
+// changes made through DOSBox are recorded; entries that no longer match the
+// disk make the mount rescan the overlay, but files added by hand need a
+// RESCAN to show up.
+
+constexpr char JournalHeader[] = "DBOVERLAY JOURNAL 1\n";
+
+// Rewrite the journal once it holds this many lines per live entry
+constexpr size_t JournalCompactionFactor = 4;
+
+std::string Overlay_Drive::get_journal_path() const {
+	return std::string(overlaydir) + special_prefix + "_JOURNAL";
+}
+
+bool Overlay_Drive::load_journal() {
+	FILE* f = fopen(get_journal_path().c_str(), "rb");
+	if (!f) return false;
+
+	char line[CROSS_LEN + 8];
+	if (!fgets(line, sizeof(line), f) || strcmp(line, JournalHeader) != 0) {
+		fclose(f);
+		return false;
+	}
+	is_journal_active = false;
+	DOSnames_cache.clear();
+	DOSdirs_cache.clear();
+	DOSdirs_index.clear();
+	deleted_files_in_base.clear();
+	deleted_paths_in_base.clear();
+
+	journal_entries = 0;
+	while (fgets(line, sizeof(line), f)) {
+		//A line without its newline was cut short, so skip it.
+		const auto len = safe_strlen(line);
+		if (len < 5 || line[len - 1] != '\n' || line[2] != ' ') continue;
+		line[len - 1] = 0;
+
+		const bool is_added = (line[0] == '+');
+		const std::string name = line + 3;
+		switch (line[1]) {
+		case 'F':
+			if (is_added) DOSnames_cache.insert(name);
+			else DOSnames_cache.erase(name);
+			break;
+		case 'D':
+			if (is_added) {
+				if (DOSdirs_index.insert(name).second) DOSdirs_cache.push_back(name);
+			} else if (DOSdirs_index.erase(name)) {
+				DOSdirs_cache.erase(std::find(DOSdirs_cache.begin(), DOSdirs_cache.end(), name));
+			}
+			break;
+		case 'X':
+			if (is_added) deleted_files_in_base.insert(name);
+			else deleted_files_in_base.erase(name);
+			break;
+		case 'P':
+			if (is_added) deleted_paths_in_base.insert(name);
+			else deleted_paths_in_base.erase(name);
+			break;
+		default: continue;
+		}
+		++journal_entries;
+	}
+	fclose(f);
+
+	//The overlay folder may have been changed by hand since the journal was
+	//written, so check each entry against the disk and rescan if one is off.
+	if (!is_journal_on_disk()) {
+		LOG_MSG("OVERLAY: The journal in '%s' is out of date, rescanning the overlay",
+		        overlaydir);
+		return false;
+	}
+
+	//Ensure hiding of the folder that contains the overlay, if it is part of the base folder.
+	add_deleted_path(overlap_folder.c_str(), false);
+	is_journal_active = true;
+
+	const auto num_entries = DOSnames_cache.size() + DOSdirs_cache.size() +
+	                         deleted_files_in_base.size() +
+	                         deleted_paths_in_base.size();
+	if (journal_entries > JournalCompactionFactor * (num_entries + 16)) {
+		write_journal();
+	}
+	if (logoverlay) LOG_MSG("loaded overlay journal with %zu entries", num_entries);
+	return true;
+}
+
+// Whether the replayed entries match the overlay folder, at one stat each
+bool Overlay_Drive::is_journal_on_disk() const {
+	auto exists_in_overlay = [&](const std::string& name, const bool is_dir) {
+		char overlayname[CROSS_LEN];
+		safe_strcpy(overlayname, overlaydir);
+		safe_strcat(overlayname, name.c_str());
+		CROSS_FILENAME(overlayname);
+		std::error_code ec = {};
+		return is_dir ? std_fs::is_directory(overlayname, ec)
+		              : std_fs::is_regular_file(overlayname, ec);
+	};
+	auto has_special_file = [&](const std::string& name, const char* operation) {
+		return exists_in_overlay(create_filename_of_special_operation(name.c_str(), operation),
+		                         false);
+	};
+
+	for (const auto& name : DOSnames_cache) {
+		if (!exists_in_overlay(name, false)) return false;
+	}
+	for (const auto& name : DOSdirs_cache) {
+		if (!exists_in_overlay(name, true)) return false;
+	}
+	//Deleted paths are also listed as deleted files, without a file of their own.
+	for (const auto& name : deleted_files_in_base) {
+		if (deleted_paths_in_base.contains(name)) continue;
+		if (!has_special_file(name, "DEL")) return false;
+	}
+	for (const auto& name : deleted_paths_in_base) {
+		if (name == overlap_folder) continue;
+		if (!has_special_file(name, "RMD")) return false;
+	}
+	return true;
+}
+
+void Overlay_Drive::write_journal() {
+	is_journal_active = false;
+
+	const auto journal_path = get_journal_path();
+	const auto temp_path    = journal_path + ".TMP";
+
+	std::error_code ec = {};
+	FILE* f = fopen(temp_path.c_str(), "wb");
+	if (!f) {
+		//A stale journal must not outlive the state it describes.
+		std_fs::remove(journal_path, ec);
+		LOG_WARNING("OVERLAY: Can't write the journal in '%s', the overlay will be scanned on every mount",
+		            overlaydir);
+		return;
+	}
+	fputs(JournalHeader, f);
+	journal_entries = 0;
+	auto write_entries = [&](const char kind, const auto& names) {
+		for (const auto& name : names) {
+			fprintf(f, "+%c %s\n", kind, name.c_str());
+			++journal_entries;
+		}
+	};
+	write_entries('D', DOSdirs_cache);
+	write_entries('F', DOSnames_cache);
+	write_entries('X', deleted_files_in_base);
+	write_entries('P', deleted_paths_in_base);
+	const bool is_written = (fclose(f) == 0);
+
+	if (is_written) std_fs::rename(temp_path, journal_path, ec);
+	if (!is_written || ec) {
+		std_fs::remove(temp_path, ec);
+		std_fs::remove(journal_path, ec);
+		return;
+	}
+	is_journal_active = true;
+}
+
+void Overlay_Drive::append_to_journal(const char op, const char kind, const char* name) {
+	if (!is_journal_active) return;
+
+	FILE* f = fopen(get_journal_path().c_str(), "ab");
+	const bool is_written = f && fprintf(f, "%c%c %s\n", op, kind, name) > 0;
+	if (f && fclose(f) != 0) f = nullptr;
+	if (!f || !is_written) {
+		//Without every change, the journal is useless; scan on the next mount.
+		is_journal_active = false;
+		std::error_code ec = {};
+		std_fs::remove(get_journal_path(), ec);
+		return;
+	}
+	++journal_entries;
+}
+
+
 bool Overlay_Drive::is_dir_only_in_overlay(const char* name) {
 	if (!name || !*name) return false;
-	if (DOSdirs_cache.empty()) return false;
-	for(std::vector<std::string>::iterator it = DOSdirs_cache.begin(); it != DOSdirs_cache.end(); ++it) {
-		if (*it == name) return true;
-	}
-	return false;
+	return DOSdirs_index.contains(name);
 }
 
 bool Overlay_Drive::is_deleted_file(const char* name) {
 	if (!name || !*name) return false;
-	if (deleted_files_in_base.empty()) return false;
-	for(std::vector<std::string>::iterator it = deleted_files_in_base.begin(); it != deleted_files_in_base.end(); ++it) {
-		if (*it == name) return true;
-	}
-	return false;
+	return deleted_files_in_base.contains(name);
 }
 
 void Overlay_Drive::add_DOSdir_to_cache(const char* name) {
 	if (!name || !*name ) return; //Skip empty file.
 	LOG_MSG("Adding name to overlay_only_dir_cache %s",name);
-	if (!is_dir_only_in_overlay(name)) {
+	if (DOSdirs_index.insert(name).second) {
 		DOSdirs_cache.push_back(name); 
+		append_to_journal('+', 'D', name);
 	}
 }
 
 void Overlay_Drive::remove_DOSdir_from_cache(const char* name) {
-	for(std::vector<std::string>::iterator it = DOSdirs_cache.begin(); it != DOSdirs_cache.end(); ++it) {
-		if ( *it == name) {
-			DOSdirs_cache.erase(it);
-			return;
-		}
+	if (DOSdirs_index.erase(name)) {
+		const auto it = std::find(DOSdirs_cache.begin(), DOSdirs_cache.end(), name);
+		if (it != DOSdirs_cache.end()) DOSdirs_cache.erase(it);
+		append_to_journal('-', 'D', name);
 	}
 }
 
 void Overlay_Drive::remove_deleted_file(const char* name,bool create_on_disk) {
-	for(std::vector<std::string>::iterator it = deleted_files_in_base.begin(); it != deleted_files_in_base.end(); ++it) {
-		if (*it == name) {
-			deleted_files_in_base.erase(it);
-			if (create_on_disk) remove_special_file_from_disk(name, "DEL");
-			return;
-		}
+	if (deleted_files_in_base.erase(name)) {
+		append_to_journal('-', 'X', name);
+		if (create_on_disk) remove_special_file_from_disk(name, "DEL");
 	}
 }
 void Overlay_Drive::add_deleted_path(const char* name, bool create_on_disk) {
 	if (!name || !*name ) return; //Skip empty file.
 	if (logoverlay) LOG_MSG("add del path %s",name);
 	if (!is_deleted_path(name)) {
-		deleted_paths_in_base.push_back(name);
+		deleted_paths_in_base.insert(name);
+		append_to_journal('+', 'P', name);
 		//Add it to deleted files as well, so it gets skipped in FindNext. 
 		//Maybe revise that.
 		if (create_on_disk) add_special_file_to_disk(name,"RMD");
@@ -1174,26 +1380,20 @@ void Overlay_Drive::add_deleted_path(const char* name, bool create_on_disk) {
 bool Overlay_Drive::is_deleted_path(const char* name) {
 	if (!name || !*name) return false;
 	if (deleted_paths_in_base.empty()) return false;
-	std::string sname(name);
-	std::string::size_type namelen = sname.length();;
-	for(std::vector<std::string>::iterator it = deleted_paths_in_base.begin(); it != deleted_paths_in_base.end(); ++it) {
-		std::string::size_type blockedlen = (*it).length();
-		if (namelen < blockedlen) continue;
-		//See if input starts with name. 
-		std::string::size_type n = sname.find(*it);
-		if (n == 0 && ((namelen == blockedlen) || *(name + blockedlen) == '\\' )) return true;
+	//See if the name or one of its leading directories is blocked.
+	const std::string_view sname(name);
+	for (auto pos = sname.find('\\'); pos != std::string_view::npos;
+	     pos = sname.find('\\', pos + 1)) {
+		if (deleted_paths_in_base.contains(std::string(sname.substr(0, pos)))) return true;
 	}
-	return false;
+	return deleted_paths_in_base.contains(name);
 }
 
 void Overlay_Drive::remove_deleted_path(const char* name, bool create_on_disk) {
-	for(std::vector<std::string>::iterator it = deleted_paths_in_base.begin(); it != deleted_paths_in_base.end(); ++it) {
-		if (*it == name) {
-			deleted_paths_in_base.erase(it);
-			remove_deleted_file(name,false); //Rethink maybe.
-			if (create_on_disk) remove_special_file_from_disk(name,"RMD");
-			break;
-		}
+	if (deleted_paths_in_base.erase(name)) {
+		append_to_journal('-', 'P', name);
+		remove_deleted_file(name,false); //Rethink maybe.
+		if (create_on_disk) remove_special_file_from_disk(name,"RMD");
 	}
 }
 bool Overlay_Drive::check_if_leading_is_deleted(const char* name){
@@ -1224,6 +1424,8 @@ bool Overlay_Drive::FileExists(const char* name) {
 
 #if 1
 bool Overlay_Drive::Rename(const char * oldname, const char * newname) {
+	localFile::FlushPendingWrites();
+
 	//TODO with cache function!
 	//Tricky function.
 	//Renaming directories is currently not supported, due the drive_cache not handling that smoothly.
@@ -1271,6 +1473,8 @@ bool Overlay_Drive::Rename(const char * oldname, const char * newname) {
 
 		if (success) {
 			timestamp_cache.erase(overlaynameold);
+			remove_DOSname_from_cache(oldname);
+			add_DOSname_to_cache(newname);
 		}
 
 		// Overlay file renamed: mark the old base file as deleted.
@@ -1313,7 +1517,7 @@ bool Overlay_Drive::Rename(const char * oldname, const char * newname) {
 		//Ensure that the file is not marked as deleted anymore.
 		if (is_deleted_file(newname)) remove_deleted_file(newname,true);
 		dirCache.EmptyCache();
-		update_cache(true);
+		update_cache(false);
 		if (logoverlay) {
 			LOG_MSG("OPTIMISE: rename took %" PRId64, GetTicksSince(a));
 		}
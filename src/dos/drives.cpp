@@ -21,6 +21,7 @@
 
 #include "bios_disk.h"
 #include "ide.h"
+#include "setup.h"
 #include "string_utils.h"
 
 extern char sfn[DOS_NAMELENGTH_ASCII];
@@ -339,4 +340,7 @@ void DriveManager::Init(Section* /* sec */) {
 
 void DRIVES_Init(Section* sec) {
 	DriveManager::Init(sec);
+
+	const auto section = static_cast<Section_prop*>(sec);
+	DOS_Drive_Cache::SetHostWatchEnabled(section->Get_bool("host_dir_watch"));
 }
@@ -1235,6 +1235,20 @@ void DOSBOX_Init()
 	secprop->AddInitFunction(&DRIVES_Init);
 	secprop->AddInitFunction(&CDROM_Image_Init);
 
+	pint = secprop->Add_int("cdrom_cache_size", only_at_start, 4);
+	pint->SetMinMax(0, 256);
+	pint->Set_help(
+	        "Size of the sector cache of each mounted CD-ROM image in MB (4 by default).\n"
+	        "Sequential reads fill it ahead of the program, which smooths out video\n"
+	        "streaming from slow storage. Set to 0 to disable the cache.");
+
+	pbool = secprop->Add_bool("host_dir_watch", only_at_start, false);
+	pbool->Set_help(
+	        "Pick up files added, removed, or renamed in mounted host directories by other\n"
+	        "programs without running RESCAN (disabled by default). Only the changed\n"
+	        "directories are re-read. Only supported on Linux; overlay drives are not\n"
+	        "watched.");
+
 #if C_IPX
 	secprop = control->AddSection_prop("ipx", &IPX_Init, changeable_at_runtime);
 #else
@@ -147,6 +147,9 @@ static void start_line_handler(const void* s)
 			if (src_val != cache[0]) {
 				if (!GFX_StartUpdate(render.scale.outWrite,
 				                     render.scale.outPitch)) {
+					// The remaining lines won't reach the
+					// cache, so don't trust it next frame
+					render.scale.clearCache = true;
 					RENDER_DrawLine = empty_line_handler;
 					return;
 				}
@@ -96,6 +96,9 @@ static inline void ScalerAddLines( Bitu changed, Bitu count ) {
 
 #define CC scalerChangeCache
 
+// The VGA passes the lines drawn from unchanged video memory as a nullptr
+#define RENDER_NULL_INPUT
+
 /* Include the different rendering routines */
 #define SBPP 8
 #define DBPP 8
@@ -208,7 +208,7 @@ static SDL_Rect to_sdl_rect(const DosBox::Rect& r)
 static void clean_up_sdl_resources();
 static void handle_video_resize(int width, int height);
 
-static void update_frame_texture([[maybe_unused]] const uint16_t* changedLines);
+static void update_frame_texture(const uint16_t* changedLines);
 static bool present_frame_texture();
 #if C_OPENGL
 static void update_frame_gl(const uint16_t *changedLines);
@@ -2525,12 +2525,35 @@ void GFX_EndUpdate(const uint16_t* changedLines)
 
 // Texture update and presentation
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-static void update_frame_texture([[maybe_unused]] const uint16_t *changedLines)
+static void update_frame_texture(const uint16_t *changedLines)
 {
-	SDL_UpdateTexture(sdl.texture.texture,
-	                  nullptr, // update entire texture
-	                  sdl.texture.input_surface->pixels,
-	                  sdl.texture.input_surface->pitch);
+	const auto surface = sdl.texture.input_surface;
+
+	if (!changedLines) {
+		SDL_UpdateTexture(sdl.texture.texture,
+		                  nullptr, // update entire texture
+		                  surface->pixels,
+		                  surface->pitch);
+		return;
+	}
+
+	// Only upload the runs of changed lines; the list alternates between
+	// the number of unchanged and changed lines, starting with unchanged
+	const auto pixels = static_cast<const uint8_t*>(surface->pixels);
+	int y = 0;
+	size_t index = 0;
+	while (y < surface->h) {
+		const int height_px = changedLines[index];
+		if (index & 1) {
+			const SDL_Rect rect = {0, y, surface->w, height_px};
+			SDL_UpdateTexture(sdl.texture.texture,
+			                  &rect,
+			                  pixels + y * surface->pitch,
+			                  surface->pitch);
+		}
+		y += height_px;
+		index++;
+	}
 }
 
 static std::optional<RenderedImage> get_rendered_output_from_backbuffer()
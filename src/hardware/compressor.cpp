@@ -67,48 +67,60 @@ void Compressor::Configure(const int _sample_rate_hz,
 
 void Compressor::Reset()
 {
-	comp_ratio      = 0.0f;
-	run_db          = 0.0f;
-	run_sum_squares = 0.0f;
-	over_db         = 0.0f;
-	run_max_db      = 0.0f;
-	max_over_db     = 0.0f;
+	state = {};
 }
 
 AudioFrame Compressor::Process(const AudioFrame in)
+{
+	return ProcessFrame(in, state);
+}
+
+void Compressor::Process(std::span<AudioFrame> frames)
+{
+	// Work on a local copy of the state so it can be kept in registers;
+	// otherwise every store to the frames could alias it.
+	auto s = state;
+	for (auto& frame : frames) {
+		frame = ProcessFrame(frame, s);
+	}
+	state = s;
+}
+
+AudioFrame Compressor::ProcessFrame(const AudioFrame in, State& s) const
 {
 	const float left  = in.left * scale_in;
 	const float right = in.right * scale_in;
 
 	const auto sum_squares = (left * left) + (right * right);
-	run_sum_squares = sum_squares + rms_coeff * (run_sum_squares - sum_squares);
-	const auto det = std::sqrt(std::max(0.0f, run_sum_squares));
+	s.run_sum_squares = sum_squares + rms_coeff * (s.run_sum_squares - sum_squares);
+	const auto det = std::sqrt(std::max(0.0f, s.run_sum_squares));
 
-	over_db = 2.08136898f * std::log(det / threshold_value) * log_to_db;
+	s.over_db = 2.08136898f * std::log(det / threshold_value) * log_to_db;
 
-	if (over_db > max_over_db) {
-		max_over_db = over_db;
+	if (s.over_db > s.max_over_db) {
+		s.max_over_db = s.over_db;
 	}
 
-	over_db = std::max(0.0f, over_db);
+	s.over_db = std::max(0.0f, s.over_db);
 
-	run_db = over_db + (run_db - over_db) * (over_db > run_db ? attack_coeff
-	                                                          : release_coeff);
+	s.run_db = s.over_db + (s.run_db - s.over_db) *
+	                               (s.over_db > s.run_db ? attack_coeff
+	                                                     : release_coeff);
 
-	over_db = run_db;
+	s.over_db = s.run_db;
 
 	constexpr auto ratio_threshold_db = 6.0f;
-	comp_ratio = 1.0f + ratio * std::min(over_db, ratio_threshold_db) /
-	                            ratio_threshold_db;
+	s.comp_ratio = 1.0f + ratio * std::min(s.over_db, ratio_threshold_db) /
+	                              ratio_threshold_db;
 
-	const auto gain_reduction_db = -over_db * (comp_ratio - 1.0f) / comp_ratio;
+	const auto gain_reduction_db = -s.over_db * (s.comp_ratio - 1.0f) /
+	                               s.comp_ratio;
 	const auto gain_reduction_factor = std::exp(gain_reduction_db * db_to_log);
 
-	run_max_db  = max_over_db + release_coeff * (run_max_db - max_over_db);
-	max_over_db = run_max_db;
+	s.run_max_db  = s.max_over_db + release_coeff * (s.run_max_db - s.max_over_db);
+	s.max_over_db = s.run_max_db;
 
 	const auto gain_scalar = gain_reduction_factor * scale_out;
 
 	return {left * gain_scalar, right * gain_scalar};
 }
-
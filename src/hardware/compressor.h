@@ -62,6 +62,7 @@
 #include "dosbox.h"
 
 #include <cstdint>
+#include <span>
 
 typedef struct AudioFrame AudioFrame_;
 
@@ -87,6 +88,9 @@ public:
 
 	AudioFrame Process(const AudioFrame in);
 
+	// Processes a block of frames in-place
+	void Process(std::span<AudioFrame> frames);
+
 	// prevent copying
 	Compressor(const Compressor &) = delete;
 	// prevent assignment
@@ -103,13 +107,18 @@ private:
 	float release_coeff   = {};
 	float rms_coeff       = {};
 
-	// state variables
-	float comp_ratio      = {};
-	float run_db          = {};
-	float run_sum_squares = {};
-	float over_db         = {};
-	float run_max_db      = {};
-	float max_over_db     = {};
+	struct State {
+		float comp_ratio      = {};
+		float run_db          = {};
+		float run_sum_squares = {};
+		float over_db         = {};
+		float run_max_db      = {};
+		float max_over_db     = {};
+	};
+
+	AudioFrame ProcessFrame(const AudioFrame in, State& s) const;
+
+	State state = {};
 };
 
 #endif
@@ -53,11 +53,12 @@ static void UpdateEMSMapping()
 	}
 }
 
-// Generic function to read or write a block of data to or from memory.
-// Don't use this directly; call two helpers: DMA_BlockRead or DMA_BlockWrite
-static void perform_dma_io(const DMA_DIRECTION direction, const PhysPt spage,
-                           PhysPt mem_address, void* const data_start,
-                           const size_t num_words, const uint8_t is_dma16)
+// Splits a transfer into chunks that stay within one 4 KB page, resolving the
+// EMS page frame through the board mapping, and passes each chunk's physical
+// address and size to the callback.
+static void for_each_dma_chunk(const PhysPt spage, PhysPt mem_address,
+                               const size_t num_words, const uint8_t is_dma16,
+                               const std::function<void(PhysPt, uint16_t)>& chunk_callback)
 {
 	assert(is_dma16 == 0 || is_dma16 == 1);
 
@@ -66,12 +67,9 @@ static void perform_dma_io(const DMA_DIRECTION direction, const PhysPt spage,
 	// Maybe move the mem_address into the 16-bit range
 	mem_address <<= is_dma16;
 
-	// The data pointer will be incremented per transfer
-	auto data_pt = reinterpret_cast<uint8_t*>(data_start);
-
 	// Convert from DMA 'words' to actual bytes, no greater than 64 KB
 	auto remaining_bytes = check_cast<uint16_t>(num_words << is_dma16);
-	do {
+	while (remaining_bytes) {
 		// Find the right EMS page that contains the current address
 		auto page = highpart_addr_page + (mem_address >> 12);
 		if (page < EMM_PAGEFRAME4K) {
@@ -92,24 +90,32 @@ static void perform_dma_io(const DMA_DIRECTION direction, const PhysPt spage,
 		// Determine how many bytes to transfer within this page
 		const auto chunk_bytes = std::min(remaining_bytes, bytes_to_page_end);
 
-		// Copy the data from the page address into the data pointer
-		if (direction == DMA_DIRECTION::READ) {
-			for (auto i = 0; i < chunk_bytes; ++i) {
-				data_pt[i] = phys_readb(chunk_start + i);
-			}
-		}
-
-		// Copy the data from the data pointer into the page address
-		else if (direction == DMA_DIRECTION::WRITE) {
-			for (auto i = 0; i < chunk_bytes; ++i) {
-				phys_writeb(chunk_start + i, data_pt[i]);
-			}
-		}
+		chunk_callback(chunk_start, chunk_bytes);
 
 		mem_address += chunk_bytes;
-		data_pt += chunk_bytes;
 		remaining_bytes -= chunk_bytes;
-	} while (remaining_bytes);
+	}
+}
+
+// Copies a chunk from guest memory into the buffer
+static void read_chunk(const PhysPt chunk_start, const uint16_t chunk_bytes,
+                       uint8_t* const buffer)
+{
+	std::memcpy(buffer, MemBase + chunk_start, chunk_bytes);
+}
+
+// Copies a chunk from the buffer into guest memory. The page's handler is
+// told afterwards, so the dynamic cores can drop any code that was compiled
+// from the overwritten range.
+static void write_chunk(const PhysPt chunk_start, const uint16_t chunk_bytes,
+                        const uint8_t* const buffer)
+{
+	std::memcpy(MemBase + chunk_start, buffer, chunk_bytes);
+
+	const auto handler = MEM_GetPageHandler(chunk_start / dos_pagesize);
+	if (handler->flags & PFLAG_HASCODE) {
+		handler->NotifyBlockWritten(chunk_start, chunk_bytes);
+	}
 }
 
 void TANDYSOUND_ShutDown(Section* = nullptr);
@@ -423,33 +429,46 @@ void DmaChannel::ClearRequest()
 
 size_t DmaChannel::Read(const size_t words, uint8_t* const dest_buffer)
 {
-	return ReadOrWrite(DMA_DIRECTION::READ, words, dest_buffer);
+	// incremented per chunk
+	auto curr_buffer = dest_buffer;
+	return Transfer(words, [&](const PhysPt chunk_start, const uint16_t chunk_bytes) {
+		read_chunk(chunk_start, chunk_bytes, curr_buffer);
+		curr_buffer += chunk_bytes;
+	});
 }
 
 size_t DmaChannel::Write(const size_t words, uint8_t* const src_buffer)
 {
-	return ReadOrWrite(DMA_DIRECTION::WRITE, words, src_buffer);
+	// incremented per chunk
+	auto curr_buffer = src_buffer;
+	return Transfer(words, [&](const PhysPt chunk_start, const uint16_t chunk_bytes) {
+		write_chunk(chunk_start, chunk_bytes, curr_buffer);
+		curr_buffer += chunk_bytes;
+	});
+}
+
+size_t DmaChannel::ReadSpans(const size_t words, const DMA_SpanCallback& span_callback)
+{
+	return Transfer(words, [&](const PhysPt chunk_start, const uint16_t chunk_bytes) {
+		span_callback({MemBase + chunk_start, chunk_bytes});
+	});
 }
 
-size_t DmaChannel::ReadOrWrite(const DMA_DIRECTION direction,
-                               const size_t words, uint8_t* const buffer)
+size_t DmaChannel::Transfer(const size_t words, const ChunkCallback& chunk_callback)
 {
 	auto want     = check_cast<uint16_t>(words);
 	uint16_t done = 0;
 	curr_addr &= dma_wrapping;
 
-	// incremented per transfer
-	auto curr_buffer = buffer;
 again:
 	Bitu left = (curr_count + 1);
 	if (want < left) {
-		perform_dma_io(direction, page_base, curr_addr, curr_buffer, want, is_16bit);
+		for_each_dma_chunk(page_base, curr_addr, want, is_16bit, chunk_callback);
 		done += want;
 		curr_addr += want;
 		curr_count -= want;
 	} else {
-		perform_dma_io(direction, page_base, curr_addr, curr_buffer, left, is_16bit);
-		curr_buffer += left << is_16bit;
+		for_each_dma_chunk(page_base, curr_addr, left, is_16bit, chunk_callback);
 		want -= left;
 		done += left;
 		ReachedTerminalCount();
@@ -24,7 +24,6 @@
 #include <array>
 #include <iomanip>
 #include <memory>
-#include <queue>
 #include <string>
 #include <unistd.h>
 #include <vector>
@@ -34,6 +33,7 @@
 #include "channel_names.h"
 #include "control.h"
 #include "dma.h"
+#include "frame_fifo.h"
 #include "hardware.h"
 #include "math_utils.h"
 #include "mixer.h"
@@ -288,7 +288,7 @@ private:
 	void WriteToRegister();
 
 	// Collections
-	std::queue<AudioFrame> fifo             = {};
+	FrameFifo<AudioFrame> fifo              = {};
 	vol_scalars_array_t vol_scalars         = {{}};
 	pan_scalars_array_t pan_scalars         = {{}};
 	ram_array_t ram                         = {};
@@ -757,9 +757,7 @@ void Gus::RenderUpToNow()
 
 		// Enqueue in the FIFO that will be drained when the mixer pulls
 		// frames
-		for (auto& frame : RenderFrames(num_elapsed_frames)) {
-			fifo.emplace(frame);
-		}
+		fifo.Enqueue(RenderFrames(num_elapsed_frames));
 		last_rendered_ms += num_elapsed_frames * ms_per_render;
 	}
 }
@@ -771,23 +769,23 @@ void Gus::AudioCallback(const int num_requested_frames)
 	std::lock_guard lock(mutex);
 
 #if 0
-	if (fifo.size())
-		LOG_MSG("GUS: Queued %2lu cycle-accurate frames", fifo.size());
+	if (fifo.Size())
+		LOG_MSG("GUS: Queued %2lu cycle-accurate frames", fifo.Size());
 #endif
 
-	auto num_frames_remaining = num_requested_frames;
+	auto num_frames_remaining = check_cast<size_t>(num_requested_frames);
 
 	// First, send any frames we've queued since the last callback
-	while (num_frames_remaining && fifo.size()) {
-		audio_channel->AddSamples_sfloat(1, &fifo.front()[0]);
-		fifo.pop();
-		--num_frames_remaining;
+	while (num_frames_remaining && !fifo.IsEmpty()) {
+		const auto frames = fifo.Front(num_frames_remaining);
+		audio_channel->AddSamples_sfloat(frames);
+		fifo.Discard(frames.size());
+		num_frames_remaining -= frames.size();
 	}
 	// If the queue's run dry, render the remainder and sync-up our time datum
 	if (num_frames_remaining > 0) {
-		const auto frames = RenderFrames(num_frames_remaining);
-		audio_channel->AddSamples_sfloat(num_frames_remaining,
-		                                 &frames[0][0]);
+		audio_channel->AddSamples_sfloat(
+		        RenderFrames(check_cast<int>(num_frames_remaining)));
 	}
 	last_rendered_ms = PIC_FullIndex();
 }
@@ -19,6 +19,7 @@
 
 #include "mem.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "inout.h"
@@ -203,22 +204,98 @@ void mem_strcpy(PhysPt dest,PhysPt src) {
 	mem_writeb_inline(dest,0);
 }
 
-void mem_memcpy(PhysPt dest,PhysPt src,Bitu size) {
-	while (size--) mem_writeb_inline(dest++,mem_readb_inline(src++));
+// Bulk access
+// ~~~~~~~~~~~
+// The bulk functions resolve the TLB once per page and then copy straight
+// from or to host memory. Pages without a host pointer in the TLB, such as
+// video memory, MMIO, and the pages holding code translated by the dynamic
+// cores, are accessed through their page handler a byte at a time, so the
+// handler sees every access (and can invalidate the translated code).
+
+// Returns how many of the bytes starting at the address fit in its page
+static inline size_t bytes_in_page(const PhysPt pt, const size_t size)
+{
+	const size_t bytes_left = dos_pagesize - (pt & (dos_pagesize - 1));
+	return std::min(size, bytes_left);
 }
 
-void MEM_BlockRead(PhysPt pt,void * data,Bitu size) {
-	uint8_t * write=reinterpret_cast<uint8_t *>(data);
-	while (size--) {
-		*write++=mem_readb_inline(pt++);
+static inline void update_read_breakpoints([[maybe_unused]] const PhysPt pt,
+                                           [[maybe_unused]] const size_t num_bytes)
+{
+#if C_DEBUG && C_HEAVY_DEBUG
+	for (size_t i = 0; i < num_bytes; ++i) {
+		DEBUG_UpdateMemoryReadBreakpoints<uint8_t>(pt + i);
+	}
+#endif
+}
+
+void mem_memcpy(PhysPt dest, PhysPt src, Bitu size)
+{
+	while (size) {
+		const auto read_addr  = get_tlb_read(src);
+		const auto write_addr = get_tlb_write(dest);
+		if (!read_addr || !write_addr) {
+			mem_writeb_inline(dest++, mem_readb_inline(src++));
+			--size;
+			continue;
+		}
+		const auto num_bytes = bytes_in_page(dest, bytes_in_page(src, size));
+		update_read_breakpoints(src, num_bytes);
+
+		const auto from = read_addr + src;
+		const auto to   = write_addr + dest;
+
+		// Overlapping copies to a higher address repeat the source
+		// bytes, like the byte-by-byte copy the guest would do
+		if (to > from && to < from + num_bytes) {
+			for (size_t i = 0; i < num_bytes; ++i) {
+				to[i] = from[i];
+			}
+		} else {
+			memmove(to, from, num_bytes);
+		}
+		dest += check_cast<PhysPt>(num_bytes);
+		src += check_cast<PhysPt>(num_bytes);
+		size -= num_bytes;
+	}
+}
+
+void MEM_BlockRead(PhysPt pt, void* data, Bitu size)
+{
+	auto write = static_cast<uint8_t*>(data);
+	while (size) {
+		const auto read_addr = get_tlb_read(pt);
+		if (!read_addr) {
+			*write++ = mem_readb_inline(pt++);
+			--size;
+			continue;
+		}
+		const auto num_bytes = bytes_in_page(pt, size);
+		update_read_breakpoints(pt, num_bytes);
+
+		memcpy(write, read_addr + pt, num_bytes);
+		write += num_bytes;
+		pt += check_cast<PhysPt>(num_bytes);
+		size -= num_bytes;
 	}
 }
 
 void MEM_BlockWrite(PhysPt pt, const void *data, size_t size)
 {
-	const uint8_t *read = static_cast<const uint8_t *>(data);
-	while (size--) {
-		mem_writeb_inline(pt++,*read++);
+	auto read = static_cast<const uint8_t*>(data);
+	while (size) {
+		const auto write_addr = get_tlb_write(pt);
+		if (!write_addr) {
+			mem_writeb_inline(pt++, *read++);
+			--size;
+			continue;
+		}
+		const auto num_bytes = bytes_in_page(pt, size);
+
+		memcpy(write_addr + pt, read, num_bytes);
+		read += num_bytes;
+		pt += check_cast<PhysPt>(num_bytes);
+		size -= num_bytes;
 	}
 }
 
@@ -226,11 +303,87 @@ void MEM_BlockCopy(PhysPt dest,PhysPt src,Bitu size) {
 	mem_memcpy(dest,src,size);
 }
 
-void MEM_StrCopy(PhysPt pt,char * data,Bitu size) {
-	while (size--) {
-		uint8_t r=mem_readb_inline(pt++);
-		if (!r) break;
-		*data++=r;
+// Returns the handler of the destination page if it takes block writes for
+// the whole run
+static PageHandler* get_block_writehandler(const PhysPt address,
+                                           const size_t num_bytes)
+{
+	if (get_tlb_write(address)) {
+		return nullptr;
+	}
+	const auto handler = get_tlb_writehandler(address);
+	if (!(handler->flags & PFLAG_BLOCKWRITE) ||
+	    bytes_in_page(address, num_bytes) < num_bytes) {
+		return nullptr;
+	}
+	return handler;
+}
+
+bool mem_fill_block(const PhysPt address, const uint32_t val,
+                    const uint8_t width, const uint32_t count)
+{
+	const auto handler = get_block_writehandler(address, size_t{width} * count);
+	if (!handler) {
+		return false;
+	}
+	handler->FillBlock(address, val, width, count);
+	return true;
+}
+
+bool mem_copy_block(const PhysPt dest, const PhysPt src, const uint8_t width,
+                    const uint32_t count)
+{
+	const auto num_bytes = size_t{width} * count;
+
+	const auto handler = get_block_writehandler(dest, num_bytes);
+	if (!handler || bytes_in_page(src, num_bytes) < num_bytes) {
+		return false;
+	}
+	if (const auto read_addr = get_tlb_read(src)) {
+		update_read_breakpoints(src, num_bytes);
+		handler->WriteBlock(dest, read_addr + src, width, count);
+		return true;
+	}
+	// Copies within the handler's memory, such as the latch copies of
+	// the planar VGA modes
+	if (get_tlb_readhandler(src) == handler) {
+		update_read_breakpoints(src, num_bytes);
+		handler->CopyBlock(dest, src, width, count);
+		return true;
+	}
+	return false;
+}
+
+void MEM_StrCopy(PhysPt pt, char* data, Bitu size)
+{
+	while (size) {
+		const auto read_addr = get_tlb_read(pt);
+		if (!read_addr) {
+			const auto r = mem_readb_inline(pt++);
+			if (!r) {
+				break;
+			}
+			*data++ = static_cast<char>(r);
+			--size;
+			continue;
+		}
+		const auto from      = read_addr + pt;
+		const auto max_bytes = bytes_in_page(pt, size);
+
+		// Copy up to the terminator, if it's in this page
+		const auto terminator = static_cast<const uint8_t*>(
+		        memchr(from, 0, max_bytes));
+		const auto num_bytes = terminator ? static_cast<size_t>(terminator - from)
+		                                  : max_bytes;
+		update_read_breakpoints(pt, num_bytes + (terminator ? 1 : 0));
+
+		memcpy(data, from, num_bytes);
+		data += num_bytes;
+		if (terminator) {
+			break;
+		}
+		pt += check_cast<PhysPt>(num_bytes);
+		size -= num_bytes;
 	}
 	*data=0;
 }
@@ -24,14 +24,21 @@
 #include <algorithm>
 #include <cinttypes>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
 #include <optional>
 #include <sys/types.h>
+#include <thread>
 
 #include <SDL.h>
+#include <SDL_cpuinfo.h> // for proper SSE defines for MSVC
 #include <speex/speex_resampler.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "audio_vector.h"
 #include "../capture/capture.h"
 #include "channel_names.h"
@@ -50,6 +57,7 @@
 #include "reelmagic/player.h"
 #include "ring_buffer.h"
 #include "rwqueue.h"
+#include "spsc_queue.h"
 #include "setup.h"
 #include "string_utils.h"
 #include "tandy_sound.h"
@@ -163,8 +171,133 @@ struct ChorusSettings {
 	}
 };
 
+// Renders mixer channels concurrently. The mixer thread hands a batch of
+// channels to the pool, then helps render them itself until the batch is done.
+// Only the rendering (MixerChannel::Mix) runs in parallel; the results are
+// always summed in the same channel order on the mixer thread, so the output
+// is identical to rendering the channels one after another.
+class MixerWorkerPool {
+public:
+	MixerWorkerPool() = default;
+	~MixerWorkerPool()
+	{
+		Stop();
+	}
+
+	MixerWorkerPool(const MixerWorkerPool&)            = delete;
+	MixerWorkerPool& operator=(const MixerWorkerPool&) = delete;
+
+	void Start(const int num_workers)
+	{
+		Stop();
+		should_quit = false;
+		for (auto i = 0; i < num_workers; ++i) {
+			workers.emplace_back(&MixerWorkerPool::WorkerLoop, this);
+			set_thread_name(workers.back(), "dosbox:mixer-worker");
+		}
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard lock(mutex);
+			should_quit = true;
+		}
+		work_ready.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+		workers.clear();
+	}
+
+	int NumWorkers() const
+	{
+		return static_cast<int>(workers.size());
+	}
+
+	void MixChannels(const std::vector<MixerChannel*>& channels,
+	                 const int frames_requested)
+	{
+		{
+			std::lock_guard lock(mutex);
+			batch         = &channels;
+			batch_frames  = frames_requested;
+			next_channel  = 0;
+			num_remaining = channels.size();
+			++batch_id;
+		}
+		work_ready.notify_all();
+
+		MixBatch(channels, frames_requested);
+
+		// Wait for the batch to be rendered and for all workers to let
+		// go of it before the caller can reuse the channel list
+		std::unique_lock lock(mutex);
+		batch_done.wait(lock, [this] {
+			return num_remaining == 0 && num_busy_workers == 0;
+		});
+		batch = nullptr;
+	}
+
+private:
+	// Claims and renders channels from the batch until none are left. Run
+	// by both the workers and the mixer thread.
+	void MixBatch(const std::vector<MixerChannel*>& channels,
+	              const int frames_requested)
+	{
+		size_t num_mixed = 0;
+		for (auto i = next_channel++; i < channels.size(); i = next_channel++) {
+			channels[i]->Mix(frames_requested);
+			++num_mixed;
+		}
+		std::lock_guard lock(mutex);
+		num_remaining -= num_mixed;
+	}
+
+	void WorkerLoop()
+	{
+		uint64_t last_batch_id = 0;
+		std::unique_lock lock(mutex);
+		while (true) {
+			work_ready.wait(lock, [&] {
+				return should_quit ||
+				       (batch && batch_id != last_batch_id);
+			});
+			if (should_quit) {
+				return;
+			}
+			last_batch_id = batch_id;
+
+			const auto& channels        = *batch;
+			const auto frames_requested = batch_frames;
+			++num_busy_workers;
+
+			lock.unlock();
+			MixBatch(channels, frames_requested);
+			lock.lock();
+
+			--num_busy_workers;
+			batch_done.notify_one();
+		}
+	}
+
+	std::vector<std::thread> workers = {};
+
+	std::mutex mutex                   = {};
+	std::condition_variable work_ready = {};
+	std::condition_variable batch_done = {};
+	bool should_quit                   = false;
+
+	const std::vector<MixerChannel*>* batch = nullptr;
+	int batch_frames                        = 0;
+	uint64_t batch_id                       = 0;
+	size_t num_remaining                    = 0;
+	int num_busy_workers                    = 0;
+	std::atomic<size_t> next_channel        = 0;
+};
+
 struct MixerSettings {
-	RWQueue<AudioFrame> final_output{1};
+	SPSCQueue<AudioFrame> final_output{1};
 	RWQueue<int16_t> capture_queue{1};
 
 	std::thread thread = {};
@@ -178,10 +311,22 @@ struct MixerSettings {
 	std::vector<AudioFrame> reverb_buffer       = {};
 	std::vector<AudioFrame> chorus_buffer       = {};
 	std::vector<int16_t> capture_buffer         = {};
+
+	// Non-interleaved working buffers for the reverb and chorus effects
+	std::array<std::vector<float>, 2> effect_in  = {};
+	std::array<std::vector<float>, 2> effect_out = {};
+
 	std::vector<AudioFrame> fast_forward_buffer = {};
 
 	std::map<std::string, MixerChannelPtr> channels = {};
 
+	// Renders channels in parallel when enabled; see MixerWorkerPool
+	MixerWorkerPool worker_pool = {};
+	bool do_parallel_mixing     = false;
+
+	// The channels to be rendered by the worker pool, in mixing order
+	std::vector<MixerChannel*> channels_to_mix = {};
+
 	std::map<std::string, MixerChannelSettings> channel_settings_cache = {};
 
 	std::atomic<bool> thread_should_quit = false;
@@ -664,6 +809,37 @@ void MIXER_SetChorusPreset(const ChorusPreset new_preset)
 	MIXER_UnlockMixerThread();
 }
 
+static void init_parallel_mixing(const bool parallel_mixing_enabled)
+{
+	MIXER_LockMixerThread();
+	mixer.do_parallel_mixing = parallel_mixing_enabled;
+
+	if (!mixer.do_parallel_mixing) {
+		mixer.worker_pool.Stop();
+		MIXER_UnlockMixerThread();
+		return;
+	}
+
+	// The mixer thread renders too, so leave one host thread for it and
+	// one for the emulation. A handful of workers is plenty as only a few
+	// channels (e.g., the MIDI synths, OPL, and GUS) are heavy.
+	constexpr auto MaxWorkers = 3;
+
+	const auto num_host_threads = static_cast<int>(
+	        std::thread::hardware_concurrency());
+	const auto num_workers = std::clamp(num_host_threads - 2, 0, MaxWorkers);
+
+	if (mixer.worker_pool.NumWorkers() != num_workers) {
+		mixer.worker_pool.Start(num_workers);
+	}
+	MIXER_UnlockMixerThread();
+
+	if (num_workers > 0) {
+		LOG_MSG("MIXER: Rendering channels in parallel using %d worker threads",
+		        num_workers);
+	}
+}
+
 static void init_compressor(const bool compressor_enabled)
 {
 	MIXER_LockMixerThread();
@@ -732,6 +908,10 @@ MixerChannelPtr MIXER_AddChannel(MIXER_Handler handler,
 	chan->SetSampleRate(sample_rate_hz);
 	chan->SetAppVolume({1.0f, 1.0f});
 
+	// Preallocate room for a couple of blocks, so steady state mixing
+	// doesn't need to grow the channel's frame buffer
+	chan->audio_frames.Reserve(static_cast<size_t>(mixer.blocksize) * 2);
+
 	const auto chan_rate_hz = chan->GetSampleRate();
 	if (chan_rate_hz == mixer.sample_rate_hz) {
 		LOG_MSG("%s: Operating at %d Hz without resampling", name, chan_rate_hz);
@@ -907,7 +1087,7 @@ void MixerChannel::Enable(const bool should_enable)
 		// we don't perform this zero'ing in the enable phase.
 
 		frames_needed = 0;
-		audio_frames.clear();
+		audio_frames.Clear();
 
 		prev_frame = {0.0f, 0.0f};
 		next_frame = {0.0f, 0.0f};
@@ -1151,14 +1331,14 @@ void MixerChannel::Mix(const int frames_requested)
 
 	frames_needed = frames_requested;
 
-	while (frames_needed > audio_frames.size()) {
+	while (frames_needed > audio_frames.Size()) {
 		std::unique_lock lock(mutex);
 
 		auto stretch_factor = static_cast<float>(sample_rate_hz) /
 						static_cast<float>(mixer.sample_rate_hz);
 
 		auto frames_remaining = iceil(
-		        static_cast<float>(frames_needed - audio_frames.size()) *
+		        static_cast<float>(frames_needed - audio_frames.Size()) *
 		        stretch_factor);
 
 		// Avoid underflow
@@ -1175,10 +1355,13 @@ void MixerChannel::AddSilence()
 {
 	std::lock_guard lock(mutex);
 
-	if (audio_frames.size() < frames_needed) {
+	if (audio_frames.Size() < frames_needed) {
 		if (prev_frame.left == 0.0f && prev_frame.right == 0.0f) {
-			while (audio_frames.size() < frames_needed) {
-				audio_frames.push_back({0.0f, 0.0f});
+			while (audio_frames.Size() < frames_needed) {
+				const auto silence = audio_frames.GetWriteSpan(
+				        frames_needed - audio_frames.Size());
+				std::fill(silence.begin(), silence.end(), AudioFrame{});
+				audio_frames.CommitWrite(silence.size());
 			}
 
 			// Make sure the next samples are zero when they get
@@ -1191,7 +1374,7 @@ void MixerChannel::AddSilence()
 			const auto mapped_output_left  = output_map.left;
 			const auto mapped_output_right = output_map.right;
 
-			while (audio_frames.size() < frames_needed) {
+			while (audio_frames.Size() < frames_needed) {
 				// Fade gradually to silence to avoid clicks.
 				// Maybe the fade factor f depends on the sample
 				// rate.
@@ -1216,7 +1399,7 @@ void MixerChannel::AddSilence()
 				out_frame[mapped_output_left]  = frame_with_gain.left;
 				out_frame[mapped_output_right] = frame_with_gain.right;
 
-				audio_frames.push_back(out_frame);
+				audio_frames.Enqueue(out_frame);
 				prev_frame = next_frame;
 			}
 		}
@@ -2069,8 +2252,8 @@ void MixerChannel::AddSamples(const int num_frames, const Type* data)
 	ConvertSamplesAndMaybeZohUpsample<Type, stereo, signeddata, nativeorder>(data, num_frames);
 
 	// Starting index this function will start writing to
-	// The audio_frames vector can contain previously converted/resampled audio
-	const size_t audio_frames_starting_size = audio_frames.size();
+	// The audio_frames FIFO can contain previously converted/resampled audio
+	const size_t audio_frames_starting_size = audio_frames.Size();
 
 	if (do_lerp_upsample) {
 		assert(!do_resample);
@@ -2090,7 +2273,7 @@ void MixerChannel::AddSamples(const int num_frames, const Type* data)
 			                            curr_frame.right,
 			                            s.pos);
 
-			audio_frames.push_back(lerped_frame);
+			audio_frames.Enqueue(lerped_frame);
 
 			s.pos += s.step;
 #if 0
@@ -2121,34 +2304,45 @@ void MixerChannel::AddSamples(const int num_frames, const Type* data)
 		auto out_frames = check_cast<spx_uint32_t>(
 		        estimate_max_out_frames(speex_resampler.state, in_frames));
 
-		// Store this as a temporary variable
-		// out_frames gets modified by Speex to reflect the actual frames it wrote
-		const auto estimated_frames = out_frames;
+		// The free space in the FIFO can wrap around the end of its
+		// buffer, so Speex may need a second call to write into the
+		// start of the buffer.
+		auto input_ptr = reinterpret_cast<const float*>(convert_buffer.data());
+
+		while (in_frames > 0 && out_frames > 0) {
+			const auto out_span = audio_frames.GetWriteSpan(out_frames);
 
-		audio_frames.resize(audio_frames_starting_size + estimated_frames);
+			// These are AudioFrames which are just 2 packed floats
+			auto output_ptr = reinterpret_cast<float*>(out_span.data());
 
-		// These are vectors of AudioFrame which is just 2 packed floats
-		const auto input_ptr = reinterpret_cast<const float*>(convert_buffer.data());
-		auto output_ptr = reinterpret_cast<float*>(audio_frames.data() + audio_frames_starting_size);
+			auto in_consumed = in_frames;
+			auto out_written = check_cast<spx_uint32_t>(out_span.size());
 
-		speex_resampler_process_interleaved_float(speex_resampler.state,
-		                                          input_ptr,
-		                                          &in_frames,
-		                                          output_ptr,
-		                                          &out_frames);
+			// Both counts get modified by Speex to reflect the
+			// actual frames it read and wrote
+			speex_resampler_process_interleaved_float(speex_resampler.state,
+			                                          input_ptr,
+			                                          &in_consumed,
+			                                          output_ptr,
+			                                          &out_written);
 
-		// 'out_frames' now contains the actual number of
-		// resampled frames, so ensure the number of output frames
-		// is within the logical size.
-		assert(out_frames <= estimated_frames);
-		audio_frames.resize(audio_frames_starting_size + out_frames); // only shrinks
+			assert(out_written <= out_span.size());
+			audio_frames.CommitWrite(out_written);
+
+			if (in_consumed == 0 && out_written == 0) {
+				break;
+			}
+			input_ptr += in_consumed * 2;
+			in_frames -= in_consumed;
+			out_frames -= std::min(out_frames, out_written);
+		}
 	} else {
-		audio_frames.insert(audio_frames.end(), convert_buffer.begin(), convert_buffer.end());
+		audio_frames.Enqueue(convert_buffer);
 	}
 
 	// Optionally filter, apply crossfeed
 	// Runs in-place over newly added frames
-	for (size_t i = audio_frames_starting_size; i < audio_frames.size(); ++i) {
+	for (size_t i = audio_frames_starting_size; i < audio_frames.Size(); ++i) {
 		if (filters.highpass.state == FilterState::On) {
 			audio_frames[i] = {filters.highpass.hpf[0].filter(audio_frames[i].left),
 			                   filters.highpass.hpf[1].filter(audio_frames[i].right)};
@@ -2209,7 +2403,7 @@ void MixerChannel::AddStretched(const int len, int16_t* data)
 		out_frame[mapped_output_left]  = frame_with_gain.left;
 		out_frame[mapped_output_right] = frame_with_gain.right;
 
-		audio_frames.push_back(out_frame);
+		audio_frames.Enqueue(out_frame);
 
 		// Advance input position
 		pos += step;
@@ -2271,6 +2465,19 @@ void MixerChannel::AddSamples_sfloat(const int num_frames, const float* data)
 	AddSamples<float, true, true, true>(num_frames, data);
 }
 
+void MixerChannel::AddSamples_mfloat(const std::span<const float> samples)
+{
+	AddSamples<float, false, true, true>(check_cast<int>(samples.size()),
+	                                     samples.data());
+}
+
+void MixerChannel::AddSamples_sfloat(const std::span<const AudioFrame> frames)
+{
+	static_assert(sizeof(AudioFrame) == 2 * sizeof(float));
+	AddSamples<float, true, true, true>(check_cast<int>(frames.size()),
+	                                    &frames.data()->left);
+}
+
 void MixerChannel::AddSamples_m16_nonnative(const int num_frames, const int16_t* data)
 {
 	AddSamples<int16_t, false, true, false>(num_frames, data);
@@ -2349,14 +2556,124 @@ MixerChannel::~MixerChannel()
 	}
 }
 
-// We use floats in the range of 16 bit integers everywhere.
-// SDL expects floats to be normalized from 1.0 to -1.0
-// It might be better for us to use normalized floats elsewhere in the future.
-// For now, that probably breaks some assumptions elsewhere in the mixer.
-// So just normalize as a final step before sending the data to SDL.
-static float normalize_sample(float sample)
+// Block helpers for the master mix
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The master mix and the effects work on whole blocks of frames rather than
+// frame by frame. The stateless steps (accumulating, deinterleaving,
+// scaling) are vectorised where SSE2 is available and otherwise written as
+// plain loops the compiler can auto-vectorise (e.g., NEON).
+
+static_assert(sizeof(AudioFrame) == 2 * sizeof(float),
+              "AudioFrame must be two tightly packed floats");
+
+// out[i] += in[i] * gain
+static void mix_frames(const AudioFrame* in, const float gain, AudioFrame* out,
+                       const size_t num_frames)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	const auto in_samples  = reinterpret_cast<const float*>(in);
+	const auto out_samples = reinterpret_cast<float*>(out);
+	const auto g           = _mm_set1_ps(gain);
+
+	// Two stereo frames per vector
+	for (; i + 2 <= num_frames; i += 2) {
+		const auto x = _mm_loadu_ps(in_samples + i * 2);
+		const auto y = _mm_loadu_ps(out_samples + i * 2);
+		_mm_storeu_ps(out_samples + i * 2, _mm_add_ps(y, _mm_mul_ps(x, g)));
+	}
+#endif
+	for (; i < num_frames; ++i) {
+		out[i] += in[i] * gain;
+	}
+}
+
+// Splits interleaved frames into separate left and right sample streams
+static void deinterleave_frames(const std::vector<AudioFrame>& in,
+                                std::array<std::vector<float>, 2>& out)
 {
-	return sample / 32768.0f;
+	const auto num_frames = in.size();
+	out[0].resize(num_frames);
+	out[1].resize(num_frames);
+
+	auto left  = out[0].data();
+	auto right = out[1].data();
+
+	size_t i = 0;
+#if defined(__SSE2__)
+	const auto in_samples = reinterpret_cast<const float*>(in.data());
+	for (; i + 4 <= num_frames; i += 4) {
+		// L0 R0 L1 R1 | L2 R2 L3 R3
+		const auto a = _mm_loadu_ps(in_samples + i * 2);
+		const auto b = _mm_loadu_ps(in_samples + i * 2 + 4);
+		_mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+#endif
+	for (; i < num_frames; ++i) {
+		left[i]  = in[i].left;
+		right[i] = in[i].right;
+	}
+}
+
+// Interleaves separate left and right sample streams and adds them to 'out'
+static void mix_deinterleaved(const std::array<std::vector<float>, 2>& in,
+                              std::vector<AudioFrame>& out)
+{
+	const auto num_frames = std::min(out.size(), in[0].size());
+	assert(in[1].size() >= num_frames);
+
+	const auto left  = in[0].data();
+	const auto right = in[1].data();
+
+	size_t i = 0;
+#if defined(__SSE2__)
+	const auto out_samples = reinterpret_cast<float*>(out.data());
+	for (; i + 4 <= num_frames; i += 4) {
+		const auto l = _mm_loadu_ps(left + i);
+		const auto r = _mm_loadu_ps(right + i);
+
+		auto out_lo = out_samples + i * 2;
+		auto out_hi = out_samples + i * 2 + 4;
+		_mm_storeu_ps(out_lo,
+		              _mm_add_ps(_mm_loadu_ps(out_lo), _mm_unpacklo_ps(l, r)));
+		_mm_storeu_ps(out_hi,
+		              _mm_add_ps(_mm_loadu_ps(out_hi), _mm_unpackhi_ps(l, r)));
+	}
+#endif
+	for (; i < num_frames; ++i) {
+		out[i] += {left[i], right[i]};
+	}
+}
+
+static void scale_frames(std::vector<AudioFrame>& frames, const float gain)
+{
+	const auto samples     = reinterpret_cast<float*>(frames.data());
+	const auto num_samples = frames.size() * 2;
+
+	size_t i = 0;
+#if defined(__SSE2__)
+	const auto g = _mm_set1_ps(gain);
+	for (; i + 4 <= num_samples; i += 4) {
+		_mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+	}
+#endif
+	for (; i < num_samples; ++i) {
+		samples[i] *= gain;
+	}
+}
+
+// The IIR filters are recursive so they can't be vectorised across time, but
+// running one channel at a time keeps each filter's state in registers.
+static void highpass_filter_frames(HighpassFilter& hpf,
+                                   std::vector<AudioFrame>& frames)
+{
+	for (auto& frame : frames) {
+		frame.left = hpf[0].filter(frame.left);
+	}
+	for (auto& frame : frames) {
+		frame.right = hpf[1].filter(frame.right);
+	}
 }
 
 // Mix a certain amount of new sample frames
@@ -2371,78 +2688,106 @@ static void mix_samples(const int frames_requested)
 	mixer.chorus_buffer.clear();
 	mixer.chorus_buffer.resize(frames_requested);
 
-	// Render all channels and accumulate results in the master mixbuffer
+	// Rendering the channels can be spread across the worker pool, but we
+	// fall back to rendering them one by one while capturing so the
+	// timing of the channel callbacks stays reproducible.
+	const auto is_capturing = CAPTURE_IsCapturingAudio() ||
+	                          CAPTURE_IsCapturingVideo();
+
+	const auto do_parallel_mixing = mixer.do_parallel_mixing &&
+	                                mixer.worker_pool.NumWorkers() > 0 &&
+	                                mixer.channels.size() > 1 && !is_capturing;
+
+	if (do_parallel_mixing) {
+		mixer.channels_to_mix.clear();
+		for (const auto& [_, channel] : mixer.channels) {
+			mixer.channels_to_mix.push_back(channel.get());
+		}
+		mixer.worker_pool.MixChannels(mixer.channels_to_mix, frames_requested);
+	}
+
+	// Accumulate the channels' results in the master mixbuffer, always in
+	// the same order
 	for (const auto& [_, channel] : mixer.channels) {
-		channel->Mix(frames_requested);
+		if (!do_parallel_mixing) {
+			channel->Mix(frames_requested);
+		}
 		std::lock_guard lock(channel->mutex);
-		const size_t num_frames = std::min(mixer.output_buffer.size(), channel->audio_frames.size());
-		for (size_t i = 0; i < num_frames; ++i) {
+		const size_t num_frames = std::min(mixer.output_buffer.size(), channel->audio_frames.Size());
+
+		// The channel's frames can wrap around the end of its FIFO, so
+		// they're consumed in (at most) two contiguous runs
+		size_t pos = 0;
+		while (pos < num_frames) {
+			const auto run = channel->audio_frames.Front(num_frames - pos);
+			const auto in  = run.data();
+
 			if (channel->do_sleep) {
-				mixer.output_buffer[i] += channel->sleeper.MaybeFadeOrListen(channel->audio_frames[i]);
+				for (size_t i = 0; i < run.size(); ++i) {
+					mixer.output_buffer[pos + i] += channel->sleeper.MaybeFadeOrListen(in[i]);
+				}
 			} else {
-				mixer.output_buffer[i] += channel->audio_frames[i];
+				constexpr auto UnityGain = 1.0f;
+				mix_frames(in, UnityGain, mixer.output_buffer.data() + pos, run.size());
 			}
 
 			if (mixer.do_reverb && channel->do_reverb_send) {
-				mixer.reverb_buffer[i] += channel->audio_frames[i] * channel->reverb.send_gain;
+				mix_frames(in, channel->reverb.send_gain, mixer.reverb_buffer.data() + pos, run.size());
 			}
 
 			if (mixer.do_chorus && channel->do_chorus_send) {
-				mixer.chorus_buffer[i] += channel->audio_frames[i] * channel->chorus.send_gain;
+				mix_frames(in, channel->chorus.send_gain, mixer.chorus_buffer.data() + pos, run.size());
 			}
+
+			channel->audio_frames.Discard(run.size());
+			pos += run.size();
 		}
-		channel->audio_frames.erase(channel->audio_frames.begin(), channel->audio_frames.begin() + num_frames);
 		if (channel->do_sleep) {
 			channel->sleeper.MaybeSleep();
 		}
 	}
 
-	if (mixer.do_reverb) {
-		for (size_t i = 0; i < mixer.reverb_buffer.size(); ++i) {
-			// High-pass filter the reverb input
-			auto& hpf = mixer.reverb.highpass_filter;
-
-			// MVerb operates on two non-interleaved sample streams
-			AudioFrame in_frame = mixer.reverb_buffer[i];
-			in_frame.left = hpf[0].filter(in_frame.left);
-			in_frame.right = hpf[1].filter(in_frame.right);
+	const auto num_frames = static_cast<int>(mixer.output_buffer.size());
 
-			float* in_buf[2] = {&in_frame.left, &in_frame.right};
+	if (mixer.do_reverb && num_frames > 0) {
+		// MVerb operates on two non-interleaved sample streams
+		auto& in  = mixer.effect_in;
+		auto& out = mixer.effect_out;
+		deinterleave_frames(mixer.reverb_buffer, in);
+		out[0].resize(in[0].size());
+		out[1].resize(in[1].size());
 
-			AudioFrame out_frame = {};
-			float* out_buf[2] = {&out_frame.left, &out_frame.right};
+		// High-pass filter the reverb input
+		auto& hpf = mixer.reverb.highpass_filter;
+		for (size_t ch = 0; ch < in.size(); ++ch) {
+			for (auto& sample : in[ch]) {
+				sample = hpf[ch].filter(sample);
+			}
+		}
 
-			constexpr auto NumFrames = 1;
-			mixer.reverb.mverb.process(in_buf, out_buf, NumFrames);
+		float* in_buf[2]  = {in[0].data(), in[1].data()};
+		float* out_buf[2] = {out[0].data(), out[1].data()};
+		mixer.reverb.mverb.process(in_buf, out_buf, num_frames);
 
-			mixer.output_buffer[i] += out_frame;
-		}
+		mix_deinterleaved(out, mixer.output_buffer);
 	}
 
-	if (mixer.do_chorus) {
+	if (mixer.do_chorus && num_frames > 0) {
 		// Apply chorus effect to the chorus aux buffer, then mix the
 		// results to the master output
-		for (size_t i = 0; i < mixer.chorus_buffer.size(); ++i) {
-			auto frame = mixer.chorus_buffer[i];
-			mixer.chorus.chorus_engine.process(&frame.left, &frame.right);
-			mixer.output_buffer[i] += frame;
-		}
+		auto& buf = mixer.effect_in;
+		deinterleave_frames(mixer.chorus_buffer, buf);
+		mixer.chorus.chorus_engine.process(buf[0].data(), buf[1].data(), num_frames);
+
+		mix_deinterleaved(buf, mixer.output_buffer);
 	}
 
 	// Apply high-pass filter to the master output
-	for (auto& frame : mixer.output_buffer) {
-		auto& hpf = mixer.highpass_filter;
-		frame = {
-			hpf[0].filter(frame.left),
-			hpf[1].filter(frame.right)
-		};
-	}
+	highpass_filter_frames(mixer.highpass_filter, mixer.output_buffer);
 
 	if (mixer.do_compressor) {
 		// Apply compressor to the master output as the very last step
-		for (auto& frame: mixer.output_buffer) {
-			frame = mixer.compressor.Process(frame);
-		}
+		mixer.compressor.Process(mixer.output_buffer);
 	}
 
 	// Capture audio output if requested
@@ -2472,11 +2817,14 @@ static void mix_samples(const int frames_requested)
 		mixer.capture_queue.NonblockingBulkEnqueue(mixer.capture_buffer, mixer.capture_buffer.size());
 	}
 
-	// Normalize the final output before sending to SDL
-	for (auto& frame: mixer.output_buffer) {
-		frame.left = normalize_sample(frame.left);
-		frame.right = normalize_sample(frame.right);
-	}
+	// We use floats in the range of 16 bit integers everywhere.
+	// SDL expects floats to be normalized from 1.0 to -1.0
+	// It might be better for us to use normalized floats elsewhere in the
+	// future. For now, that probably breaks some assumptions elsewhere in
+	// the mixer. So just normalize as a final step before sending the data
+	// to SDL.
+	constexpr auto NormalizeGain = 1.0f / 32768.0f;
+	scale_frames(mixer.output_buffer, NormalizeGain);
 }
 
 // Run in the main thread by a PIC Callback
@@ -2525,12 +2873,11 @@ static void SDLCALL mixer_callback([[maybe_unused]] void* userdata,
 	// Mac OSX has been observed to be problematic if we ever block inside SDL's callback
 	// This ensures that we do not block waiting for more audio
 	// In the queue has run dry, we write what we have available and the rest of the request is silence
-	const auto num_frames = std::min(check_cast<int>(mixer.final_output.Size()), frames_requested);
-	if (num_frames > 0) {
-		std::vector<AudioFrame> audio_frames = {};
-		mixer.final_output.BulkDequeue(audio_frames, num_frames);
-		memcpy(stream, audio_frames.data(), audio_frames.size() * sizeof(AudioFrame));
-	}
+	// The lock-free dequeue copies straight into SDL's buffer without locking or allocating.
+	static_assert(sizeof(AudioFrame) == BytesPerSampleFrame);
+	const auto audio_frames = std::span(reinterpret_cast<AudioFrame*>(stream),
+	                                    check_cast<size_t>(frames_requested));
+	mixer.final_output.NonblockingBulkDequeue(audio_frames);
 }
 
 static void mixer_thread_loop()
@@ -2574,7 +2921,7 @@ static void mixer_thread_loop()
 			// SDL callback remains active. Enqueue silence.
 			mixer.output_buffer.clear();
 			mixer.output_buffer.resize(mixer.blocksize);
-			mixer.final_output.BulkEnqueue(mixer.output_buffer, mixer.output_buffer.size());
+			mixer.final_output.BulkEnqueue(mixer.output_buffer);
 			continue;
 		}
 
@@ -2601,7 +2948,7 @@ static void mixer_thread_loop()
 		}
 
 		assert(to_mix.size() == static_cast<size_t>(mixer.blocksize));
-		mixer.final_output.BulkEnqueue(to_mix, to_mix.size());
+		mixer.final_output.BulkEnqueue(to_mix);
 	}
 }
 
@@ -2644,8 +2991,16 @@ static void set_mixer_state(const MixerState new_state)
 	}
 
 	if (new_state == MixerState::Muted) {
-		// Clear out any audio in the queue to avoid a stutter on un-mute
+		// Clear out any audio in the queue to avoid a stutter on un-mute.
+		// The queue's consumer is the SDL callback, so keep it out while
+		// clearing.
+		if (mixer.sdl_device > 0) {
+			SDL_LockAudioDevice(mixer.sdl_device);
+		}
 		mixer.final_output.Clear();
+		if (mixer.sdl_device > 0) {
+			SDL_UnlockAudioDevice(mixer.sdl_device);
+		}
 	}
 
 	mixer.state = new_state;
@@ -2660,6 +3015,7 @@ void MIXER_CloseAudioDevice()
 		mixer.final_output.Stop();
 		mixer.thread.join();
 	}
+	mixer.worker_pool.Stop();
 
 	for (const auto& [_, channel] : mixer.channels) {
 		channel->Enable(false);
@@ -2822,21 +3178,10 @@ void MIXER_Init(Section* sec)
 		mixer.sample_rate_hz = secprop->Get_int("rate");
 		mixer.blocksize      = secprop->Get_int("blocksize");
 
-		if (mixer_state == MixerState::NoSound) {
-			set_no_sound();
-
-		} else {
-			if (init_sdl_sound(secprop->Get_int("rate"),
-							   secprop->Get_int("blocksize"),
-							   secprop->Get_bool("negotiate"))) {
-
-				// This also unpauses the audio device which is
-				// opened in paused mode by SDL.
-				set_mixer_state(MixerState::On);
-			} else {
-				set_no_sound();
-			}
-		}
+		const auto sdl_sound_ok = (mixer_state != MixerState::NoSound) &&
+		                          init_sdl_sound(secprop->Get_int("rate"),
+		                                         secprop->Get_int("blocksize"),
+		                                         secprop->Get_bool("negotiate"));
 
 		const auto requested_prebuffer_ms = secprop->Get_int("prebuffer");
 		mixer.prebuffer_ms = clamp(requested_prebuffer_ms, 1, MaxPrebufferMs);
@@ -2847,11 +3192,22 @@ void MIXER_Init(Section* sec)
 
 		sec->AddDestroyFunction(&stop_mixer);
 
+		// Size the queues using the obtained rate and blocksize before
+		// the audio device is unpaused; from then on the SDL callback
+		// reads from the output queue.
 		mixer.final_output.Resize(mixer.blocksize + prebuffer_frames);
 
 		// One second of audio
 		mixer.capture_queue.Resize(mixer.sample_rate_hz * 2);
 
+		if (sdl_sound_ok) {
+			// This also unpauses the audio device which is
+			// opened in paused mode by SDL.
+			set_mixer_state(MixerState::On);
+		} else {
+			set_no_sound();
+		}
+
 		mixer.thread = std::thread(mixer_thread_loop);
 		set_thread_name(mixer.thread, "dosbox:mixer");
 
@@ -2884,6 +3240,8 @@ void MIXER_Init(Section* sec)
 
 	init_master_highpass_filter();
 
+	init_parallel_mixing(secprop->Get_bool("parallel_mixing"));
+
 	// Initialise master compressor
 	init_compressor(secprop->Get_bool("compressor"));
 
@@ -3007,6 +3365,14 @@ static void init_mixer_dosbox_settings(Section_prop& sec_prop)
 	        "  off:  Disable compressor.\n"
 	        "  on:   Enable compressor (default).");
 
+	bool_prop = sec_prop.Add_bool("parallel_mixing", WhenIdle, DefaultOn);
+	bool_prop->Set_help(
+	        "Render the audio channels in parallel on multiple host CPU cores (enabled by\n"
+	        "default). Reduces the chance of stuttering when several demanding devices are\n"
+	        "active at once (e.g., MT-32 and OPL3). The audio output is the same either\n"
+	        "way; the channels are always rendered one by one while capturing audio or\n"
+	        "video.");
+
 	auto string_prop = sec_prop.Add_string("crossfeed", WhenIdle, "off");
 	string_prop->Set_help(
 	        "Enable crossfeed globally on all stereo channels for headphone listening:\n"
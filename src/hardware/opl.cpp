@@ -437,7 +437,7 @@ void Opl::RenderUpToNow()
 	// Keep rendering until we're current
 	while (last_rendered_ms < now) {
 		last_rendered_ms += ms_per_frame;
-		fifo.emplace(RenderFrame());
+		fifo.Enqueue(RenderFrame());
 	}
 }
 
@@ -446,25 +446,28 @@ void Opl::AudioCallback(const int requested_frames)
 	std::lock_guard lock(mutex);
 	assert(channel);
 #if 0
-	if (fifo.size()) {
+	if (fifo.Size()) {
 		LOG_MSG("%s: Queued %2lu cycle-accurate frames",
 		        channel->GetName().c_str(),
-		        fifo.size());
+		        fifo.Size());
 	}
 #endif
-	auto frames_remaining = requested_frames;
+	auto frames_remaining = check_cast<size_t>(requested_frames);
 
 	// First, send any frames we've queued since the last callback
-	while (frames_remaining && fifo.size()) {
-		channel->AddSamples_sfloat(1, &fifo.front()[0]);
-		fifo.pop();
-		--frames_remaining;
+	while (frames_remaining && !fifo.IsEmpty()) {
+		const auto frames = fifo.Front(frames_remaining);
+		channel->AddSamples_sfloat(frames);
+		fifo.Discard(frames.size());
+		frames_remaining -= frames.size();
 	}
 	// If the queue's run dry, render the remainder and sync-up our time datum
-	while (frames_remaining) {
-		const auto frame = RenderFrame();
-		channel->AddSamples_sfloat(1, &frame[0]);
-		--frames_remaining;
+	if (frames_remaining) {
+		render_buffer.resize(frames_remaining);
+		for (auto& frame : render_buffer) {
+			frame = RenderFrame();
+		}
+		channel->AddSamples_sfloat(render_buffer);
 	}
 	last_rendered_ms = PIC_FullIndex();
 }
@@ -23,9 +23,10 @@
 
 #include <cmath>
 #include <memory>
-#include <queue>
+#include <vector>
 
 #include "adlib_gold.h"
+#include "frame_fifo.h"
 #include "hardware.h"
 #include "inout.h"
 #include "mixer.h"
@@ -118,7 +119,8 @@ private:
 	IO_ReadHandleObject ReadHandler[3];
 	IO_WriteHandleObject WriteHandler[3];
 
-	std::queue<AudioFrame> fifo = {};
+	FrameFifo<AudioFrame> fifo = {};
+	std::vector<AudioFrame> render_buffer = {};
 	std::mutex mutex = {};
 
 	OplChip chip[2]  = {};
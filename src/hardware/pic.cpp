@@ -17,6 +17,10 @@
  */
 
 #include "dosbox.h"
+
+#include <algorithm>
+#include <vector>
+
 #include "inout.h"
 #include "cpu.h"
 #include "callback.h"
@@ -38,8 +42,6 @@
 // "master-slave" relationship, which is misleading given that fact that the
 // primary has no control over the secondary.
 
-#define PIC_QUEUESIZE 512
-
 struct PIC_Controller {
 	Bitu icw_words;
 	Bitu icw_index;
@@ -190,19 +192,178 @@ void PIC_Controller::start_irq(uint8_t val) {
 }
 
 
+// PIC Event Queue
+// ~~~~~~~~~~~~~~~
+// Scheduled events are kept in a binary min-heap ordered by their index
+// (the time they're due, in milliseconds relative to the current tick). Ties
+// are broken by insertion order, so events due at the same time still fire
+// first-in, first-out. The heap holds slot numbers into a pool of entries that
+// grows on demand; freed slots are recycled via a free list.
+//
+// Cancelling a single event by its ID is O(1): the entry is only marked as
+// cancelled and is discarded once it reaches the top of the heap. Cancelled
+// entries are compacted away in bulk if they ever make up most of the heap.
+
 struct PICEntry {
-	double index;
-	Bitu value;
-	PIC_EventHandler pic_event;
-	PICEntry * next;
+	double index               = 0.0;
+	uint64_t sequence          = 0;
+	PIC_EventHandler pic_event = nullptr;
+	uint32_t value             = 0;
+	// Bumped every time the slot is released, so stale IDs don't match
+	uint32_t generation = 1;
+	bool cancelled      = false;
 };
 
 static struct {
-	PICEntry entries[PIC_QUEUESIZE];
-	PICEntry * free_entry;
-	PICEntry * next_entry;
+	std::vector<PICEntry> entries    = {};
+	std::vector<uint32_t> heap       = {};
+	std::vector<uint32_t> free_slots = {};
+	uint64_t next_sequence           = 0;
+	size_t num_cancelled             = 0;
 } pic_queue;
 
+static bool entry_is_earlier(const uint32_t a, const uint32_t b)
+{
+	const auto &entry_a = pic_queue.entries[a];
+	const auto &entry_b = pic_queue.entries[b];
+	if (entry_a.index != entry_b.index) {
+		return entry_a.index < entry_b.index;
+	}
+	return entry_a.sequence < entry_b.sequence;
+}
+
+// Comparator for the std heap algorithms, which build max-heaps
+static bool entry_is_later(const uint32_t a, const uint32_t b)
+{
+	return entry_is_earlier(b, a);
+}
+
+static void sift_up(size_t pos)
+{
+	auto &heap      = pic_queue.heap;
+	const auto slot = heap[pos];
+	while (pos > 0) {
+		const auto parent = (pos - 1) / 2;
+		if (!entry_is_earlier(slot, heap[parent])) {
+			break;
+		}
+		heap[pos] = heap[parent];
+		pos       = parent;
+	}
+	heap[pos] = slot;
+}
+
+static void sift_down(size_t pos)
+{
+	auto &heap      = pic_queue.heap;
+	const auto size = heap.size();
+	const auto slot = heap[pos];
+	for (;;) {
+		auto child = pos * 2 + 1;
+		if (child >= size) {
+			break;
+		}
+		if (child + 1 < size && entry_is_earlier(heap[child + 1], heap[child])) {
+			++child;
+		}
+		if (!entry_is_earlier(heap[child], slot)) {
+			break;
+		}
+		heap[pos] = heap[child];
+		pos       = child;
+	}
+	heap[pos] = slot;
+}
+
+static uint32_t acquire_slot()
+{
+	if (pic_queue.free_slots.empty()) {
+		pic_queue.entries.emplace_back();
+		return check_cast<uint32_t>(pic_queue.entries.size() - 1);
+	}
+	const auto slot = pic_queue.free_slots.back();
+	pic_queue.free_slots.pop_back();
+	return slot;
+}
+
+static void release_slot(const uint32_t slot)
+{
+	auto &entry = pic_queue.entries[slot];
+	if (entry.cancelled) {
+		assert(pic_queue.num_cancelled > 0);
+		--pic_queue.num_cancelled;
+	}
+	entry.pic_event = nullptr;
+	entry.cancelled = false;
+	++entry.generation;
+	pic_queue.free_slots.push_back(slot);
+}
+
+static void pop_top_entry()
+{
+	auto &heap = pic_queue.heap;
+	assert(!heap.empty());
+	const auto slot = heap.front();
+	heap.front()    = heap.back();
+	heap.pop_back();
+	if (!heap.empty()) {
+		sift_down(0);
+	}
+	release_slot(slot);
+}
+
+// Returns the earliest pending (non-cancelled) entry, or nullptr if none
+static PICEntry *peek_next_entry()
+{
+	auto &heap = pic_queue.heap;
+	while (!heap.empty() && pic_queue.entries[heap.front()].cancelled) {
+		pop_top_entry();
+	}
+	return heap.empty() ? nullptr : &pic_queue.entries[heap.front()];
+}
+
+// Drops all cancelled entries and restores the heap property in O(n)
+static void compact_queue()
+{
+	auto &heap = pic_queue.heap;
+	const auto is_cancelled = [](const uint32_t slot) {
+		if (!pic_queue.entries[slot].cancelled) {
+			return false;
+		}
+		release_slot(slot);
+		return true;
+	};
+	heap.erase(std::remove_if(heap.begin(), heap.end(), is_cancelled),
+	           heap.end());
+	std::make_heap(heap.begin(), heap.end(), entry_is_later);
+	assert(pic_queue.num_cancelled == 0);
+}
+
+static void cancel_entry(PICEntry &entry)
+{
+	if (entry.cancelled) {
+		return;
+	}
+	entry.cancelled = true;
+	++pic_queue.num_cancelled;
+}
+
+static void maybe_compact_queue()
+{
+	constexpr size_t MinHeapSizeToCompact = 64;
+	const auto heap_size = pic_queue.heap.size();
+	if (heap_size >= MinHeapSizeToCompact &&
+	    pic_queue.num_cancelled > heap_size / 2) {
+		compact_queue();
+	}
+}
+
+static PIC_EventId make_event_id(const uint32_t slot)
+{
+	const auto generation = pic_queue.entries[slot].generation;
+	return (static_cast<PIC_EventId>(generation) << 32) | slot;
+}
+
 static void write_command(io_port_t port, io_val_t value, io_width_t)
 {
 	const auto val = check_cast<uint8_t>(value);
@@ -422,34 +583,20 @@ void PIC_SetIRQMask(uint32_t irq, bool masked)
 	pic->set_imr(newmask);
 }
 
-static void AddEntry(PICEntry * entry) {
-	PICEntry * find_entry=pic_queue.next_entry;
-	if (find_entry == nullptr) {
-		entry->next=nullptr;
-		pic_queue.next_entry=entry;
-	} else if (find_entry->index > entry->index) {
-		pic_queue.next_entry=entry;
-		entry->next=find_entry;
-	} else {
-		while (find_entry) {
-			if (find_entry->next) {
-				/* See if the next index comes later than this
-				 * one */
-				if (find_entry->next->index > entry->index) {
-					entry->next      = find_entry->next;
-					find_entry->next = entry;
-					break;
-				} else {
-					find_entry = find_entry->next;
-				}
-			} else {
-				entry->next      = find_entry->next;
-				find_entry->next = entry;
-				break;
-			}
-		}
-	}
-	Bits cycles=PIC_MakeCycles(pic_queue.next_entry->index-PIC_TickIndex());
+bool PIC_IsIRQMasked(uint32_t irq)
+{
+	const uint32_t t = irq > 7 ? (irq - 8) : irq;
+	const PIC_Controller* pic = &pics[irq > 7 ? 1 : 0];
+	return pic->imr & (1 << t);
+}
+
+static void AddEntry(const uint32_t slot) {
+	pic_queue.heap.push_back(slot);
+	sift_up(pic_queue.heap.size() - 1);
+
+	const auto next_entry = peek_next_entry();
+	assert(next_entry);
+	Bits cycles=PIC_MakeCycles(next_entry->index-PIC_TickIndex());
 	if (cycles<CPU_Cycles) {
 		CPU_CycleLeft+=CPU_Cycles;
 		CPU_Cycles=0;
@@ -458,71 +605,60 @@ static void AddEntry(PICEntry * entry) {
 static bool InEventService = false;
 static double srv_lag = 0.0;
 
-void PIC_AddEvent(PIC_EventHandler handler, double delay, uint32_t val)
+PIC_EventId PIC_AddEvent(PIC_EventHandler handler, double delay, uint32_t val)
+{
+	const auto slot = acquire_slot();
+	PICEntry &entry = pic_queue.entries[slot];
+	if(InEventService) entry.index = delay + srv_lag;
+	else entry.index = delay + PIC_TickIndex();
+
+	entry.sequence  = pic_queue.next_sequence++;
+	entry.pic_event = handler;
+	entry.value     = val;
+	entry.cancelled = false;
+	AddEntry(slot);
+	return make_event_id(slot);
+}
+
+void PIC_RemoveEvent(const PIC_EventId id)
 {
-	if (!pic_queue.free_entry) {
-		LOG(LOG_PIC,LOG_ERROR)("Event queue full");
+	const auto slot       = static_cast<uint32_t>(id & 0xffffffff);
+	const auto generation = static_cast<uint32_t>(id >> 32);
+	if (slot >= pic_queue.entries.size()) {
 		return;
 	}
-	PICEntry * entry=pic_queue.free_entry;
-	if(InEventService) entry->index = delay + srv_lag;
-	else entry->index = delay + PIC_TickIndex();
-
-	entry->pic_event=handler;
-	entry->value=val;
-	pic_queue.free_entry=pic_queue.free_entry->next;
-	AddEntry(entry);
+	auto &entry = pic_queue.entries[slot];
+	// Ignore IDs of events that already fired or were removed
+	if (entry.generation != generation || !entry.pic_event) {
+		return;
+	}
+	cancel_entry(entry);
+	maybe_compact_queue();
 }
 
-void PIC_RemoveSpecificEvents(PIC_EventHandler handler, uint32_t val)
+template <typename Predicate>
+static void remove_events_if(Predicate matches)
 {
-	PICEntry *entry = pic_queue.next_entry;
-	PICEntry *prev_entry;
-	prev_entry = nullptr;
-	while (entry) {
-		if ((entry->pic_event == handler) && (entry->value == val)) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
+	for (const auto slot : pic_queue.heap) {
+		auto &entry = pic_queue.entries[slot];
+		if (matches(entry)) {
+			cancel_entry(entry);
 		}
-		prev_entry=entry;
-		entry=entry->next;
 	}
+	maybe_compact_queue();
+}
+
+void PIC_RemoveSpecificEvents(PIC_EventHandler handler, uint32_t val)
+{
+	remove_events_if([=](const PICEntry &entry) {
+		return entry.pic_event == handler && entry.value == val;
+	});
 }
 
 void PIC_RemoveEvents(PIC_EventHandler handler) {
-	PICEntry * entry=pic_queue.next_entry;
-	PICEntry * prev_entry;
-	prev_entry=nullptr;
-	while (entry) {
-		if (entry->pic_event == handler) {
-			if (prev_entry) {
-				prev_entry->next=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=prev_entry->next;
-				continue;
-			} else {
-				pic_queue.next_entry=entry->next;
-				entry->next=pic_queue.free_entry;
-				pic_queue.free_entry=entry;
-				entry=pic_queue.next_entry;
-				continue;
-			}
-		}
-		prev_entry=entry;
-		entry=entry->next;
-	}
+	remove_events_if([=](const PICEntry &entry) {
+		return entry.pic_event == handler;
+	});
 }
 
 
@@ -538,24 +674,25 @@ bool PIC_RunQueue(void) {
 
 	/* Check the queue for an entry */
 	InEventService = true;
-	while (pic_queue.next_entry &&
-	       (pic_queue.next_entry->index * static_cast<double>(CPU_CycleMax) <= index_nd_f)) {
-		PICEntry *entry = pic_queue.next_entry;
-		pic_queue.next_entry = entry->next;
-
-		srv_lag = entry->index;
-		(entry->pic_event)(entry->value); // call the event handler
-
-		/* Put the entry in the free list */
-		entry->next=pic_queue.free_entry;
-		pic_queue.free_entry=entry;
+	PICEntry *next_entry = nullptr;
+	while ((next_entry = peek_next_entry()) &&
+	       (next_entry->index * static_cast<double>(CPU_CycleMax) <= index_nd_f)) {
+		const auto pic_event = next_entry->pic_event;
+		const auto value     = next_entry->value;
+		srv_lag              = next_entry->index;
+
+		/* Release the entry before calling the handler, which may
+		 * schedule new events and grow the entry pool */
+		pop_top_entry();
+
+		pic_event(value); // call the event handler
 	}
 	InEventService = false;
 
 	/* Check when to set the new cycle end */
-	if (pic_queue.next_entry) {
+	if (next_entry) {
 		auto cycles = static_cast<int32_t>(
-		        pic_queue.next_entry->index * static_cast<double>(CPU_CycleMax) -
+		        next_entry->index * static_cast<double>(CPU_CycleMax) -
 		        index_nd_f);
 		if (!cycles) {
 			cycles = 1;
@@ -607,10 +744,9 @@ void TIMER_AddTick(void) {
 	CPU_Cycles = 0;
 	PIC_Ticks++;
 	/* Go through the list of scheduled events and lower their index with 1000 */
-	PICEntry * entry=pic_queue.next_entry;
-	while (entry) {
-		entry->index -= 1.0f;
-		entry=entry->next;
+	/* A uniform shift keeps the heap ordering intact */
+	for (const auto slot : pic_queue.heap) {
+		pic_queue.entries[slot].index -= 1.0;
 	}
 	/* Call our list of ticker handlers */
 	TickerBlock * ticker=firstticker;
@@ -674,12 +810,11 @@ public:
 		WriteHandler[2].Install(0xa0, write_command, io_width_t::byte);
 		WriteHandler[3].Install(0xa1, write_data, io_width_t::byte);
 		/* Initialize the pic queue */
-		for (i=0;i<PIC_QUEUESIZE-1;i++) {
-			pic_queue.entries[i].next=&pic_queue.entries[i+1];
-		}
-		pic_queue.entries[PIC_QUEUESIZE-1].next=nullptr;
-		pic_queue.free_entry=&pic_queue.entries[0];
-		pic_queue.next_entry=nullptr;
+		constexpr size_t InitialQueueCapacity = 512;
+		pic_queue = {};
+		pic_queue.entries.reserve(InitialQueueCapacity);
+		pic_queue.heap.reserve(InitialQueueCapacity);
+		pic_queue.free_slots.reserve(InitialQueueCapacity);
 	}
 
 	~PIC_8259A(){
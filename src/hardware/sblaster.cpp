@@ -23,6 +23,7 @@
 #include <iomanip>
 #include <map>
 #include <optional>
+#include <span>
 #include <string>
 #include <tuple>
 
@@ -936,36 +937,38 @@ static void play_dma_transfer(const uint32_t bytes_requested)
 
 	last_dma_callback = PIC_FullIndex();
 
-	// Temporary counter for ADPCM modes
-
+	// ADPCM modes are decoded straight from guest memory
 	auto decode_adpcm_dma =
 	        [&](auto decode_adpcm_fn) -> std::tuple<uint32_t, uint32_t, uint16_t> {
-		const uint32_t num_bytes = read_dma_8bit(bytes_to_read);
-		uint32_t num_samples     = 0;
-		uint16_t num_frames      = 0;
-
-		// Parse the reference ADPCM byte, if provided
-		uint32_t i = 0;
-		if (num_bytes > 0 && sb.adpcm.haveref) {
-			sb.adpcm.haveref   = false;
-			sb.adpcm.reference = sb.dma.buf.b8[0];
-			sb.adpcm.stepsize  = MinAdaptiveStepSize;
-			++i;
-		}
-		// Decode the remaining DMA buffer into samples using the
-		// provided function
-		while (i < num_bytes) {
-			const auto decoded = decode_adpcm_fn(sb.dma.buf.b8[i]);
-			constexpr auto NumDecoded = check_cast<uint8_t>(
-			        decoded.size());
-
-			enqueue_frames(std::make_unique<AudioVectorM8>(
-				NumDecoded, maybe_silence(NumDecoded, decoded.data())));
-			num_samples += NumDecoded;
-			i++;
-		}
+		uint32_t num_samples = 0;
+
+		auto decode_span = [&](const std::span<const uint8_t> span) {
+			auto data = span.begin();
+
+			// Parse the reference ADPCM byte, if provided
+			if (data != span.end() && sb.adpcm.haveref) {
+				sb.adpcm.haveref   = false;
+				sb.adpcm.reference = *data;
+				sb.adpcm.stepsize  = MinAdaptiveStepSize;
+				++data;
+			}
+			// Decode the remaining DMA data into samples using the
+			// provided function
+			for (; data != span.end(); ++data) {
+				const auto decoded = decode_adpcm_fn(*data);
+				constexpr auto NumDecoded = check_cast<uint8_t>(
+				        decoded.size());
+
+				enqueue_frames(std::make_unique<AudioVectorM8>(
+					NumDecoded, maybe_silence(NumDecoded, decoded.data())));
+				num_samples += NumDecoded;
+			}
+		};
+		const auto num_bytes = check_cast<uint32_t>(
+		        sb.dma.chan->ReadSpans(bytes_to_read, decode_span));
+
 		// ADPCM is mono
-		num_frames = check_cast<uint16_t>(num_samples);
+		const auto num_frames = check_cast<uint16_t>(num_samples);
 		return {num_bytes, num_samples, num_frames};
 	};
 
@@ -43,13 +43,15 @@
 
 #include <algorithm>
 #include <array>
-#include <queue>
+#include <span>
 #include <string_view>
+#include <vector>
 
 #include "bios.h"
 #include "checks.h"
 #include "channel_names.h"
 #include "dma.h"
+#include "frame_fifo.h"
 #include "hardware.h"
 #include "inout.h"
 #include "math_utils.h"
@@ -93,7 +95,8 @@ private:
 	MixerChannelPtr channel                     = nullptr;
 	IO_WriteHandleObject write_handlers[2]      = {};
 	std::unique_ptr<sn76496_base_device> device = {};
-	std::queue<float> fifo                      = {};
+	FrameFifo<float> fifo                       = {};
+	std::vector<float> render_buffer            = {};
 	std::mutex mutex                            = {};
 
 	// Static rate-related configuration
@@ -397,30 +400,29 @@ void TandyDAC::PicCallback(const int requested)
 	const bool should_read = ((regs.mode & 0x0c) == 0x0c) &&
 	                         !dma.is_done;
 
-	const auto buf       = dma.fifo.data();
-	const auto buf_size  = check_cast<int>(dma.fifo.size());
-	auto bytes_remaining = requested;
-
-	while (bytes_remaining > 0) {
-		const auto bytes_to_read = std::min(bytes_remaining, buf_size);
+	if (requested <= 0) {
+		return;
+	}
+	const auto num_requested = static_cast<size_t>(requested);
 
-		auto actual = should_read
-		                    ? check_cast<int>(
-		                              dma.channel->Read(bytes_to_read, buf))
-		                    : 0;
+	std::vector<uint8_t> samples = {};
+	samples.reserve(num_requested);
 
-		// If we came up short, move back one to terminate the tail in
-		// silence
-		if (actual && actual < bytes_to_read) {
-			actual--;
-		}
-		memset(buf + actual, 128, bytes_to_read - actual);
+	if (should_read) {
+		const auto append_span = [&](const std::span<const uint8_t> span) {
+			samples.insert(samples.end(), span.begin(), span.end());
+		};
+		dma.channel->ReadSpans(num_requested, append_span);
+	}
 
-		// Always write the requested quantity regardless of read status
-		std::vector<uint8_t> temp(dma.fifo.begin(), dma.fifo.begin() + bytes_to_read);
-		output_queue.NonblockingBulkEnqueue(temp, bytes_to_read);
-		bytes_remaining -= bytes_to_read;
+	// If we came up short, move back one to terminate the tail in silence
+	if (!samples.empty() && samples.size() < num_requested) {
+		samples.pop_back();
 	}
+	samples.resize(num_requested, 128);
+
+	// Always write the requested quantity regardless of read status
+	output_queue.NonblockingBulkEnqueue(samples, num_requested);
 }
 
 TandyPSG::TandyPSG(const ConfigProfile config_profile,
@@ -553,7 +555,7 @@ void TandyPSG::RenderUpToNow()
 	// Keep rendering until we're current
 	while (last_rendered_ms < now) {
 		last_rendered_ms += MsPerRender;
-		fifo.emplace(RenderSample());
+		fifo.Enqueue(RenderSample());
 	}
 }
 
@@ -573,24 +575,27 @@ void TandyPSG::AudioCallback(const int requested_frames)
 	std::lock_guard lock(mutex);
 
 #if 0
-	if (fifo.size()) {
-		LOG_MSG("TANDY: Queued %2lu cycle-accurate frames", fifo.size());
+	if (fifo.Size()) {
+		LOG_MSG("TANDY: Queued %2lu cycle-accurate frames", fifo.Size());
 	}
 #endif
 
-	auto frames_remaining = requested_frames;
+	auto frames_remaining = check_cast<size_t>(requested_frames);
 
 	// First, send any frames we've queued since the last callback
-	while (frames_remaining && fifo.size()) {
-		channel->AddSamples_mfloat(1, &fifo.front());
-		fifo.pop();
-		--frames_remaining;
+	while (frames_remaining && !fifo.IsEmpty()) {
+		const auto samples = fifo.Front(frames_remaining);
+		channel->AddSamples_mfloat(samples);
+		fifo.Discard(samples.size());
+		frames_remaining -= samples.size();
 	}
 	// If the queue's run dry, render the remainder and sync-up our time datum
-	while (frames_remaining) {
-		float sample = RenderSample();
-		channel->AddSamples_mfloat(1, &sample);
-		--frames_remaining;
+	if (frames_remaining) {
+		render_buffer.resize(frames_remaining);
+		for (auto& sample : render_buffer) {
+			sample = RenderSample();
+		}
+		channel->AddSamples_mfloat(render_buffer);
 	}
 	last_rendered_ms = PIC_FullIndex();
 }
@@ -42,9 +42,8 @@ public:
 	};
 
 	struct Dma {
-		std::array<uint8_t, 128> fifo = {};
-		DmaChannel* channel           = nullptr;
-		bool is_done                  = false;
+		DmaChannel* channel = nullptr;
+		bool is_done        = false;
 	};
 
 	struct Registers {
@@ -39,6 +39,12 @@
 #include "vga.h"
 #include "video.h"
 
+#include <SDL_cpuinfo.h> // for proper SSE defines for MSVC
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // #define DEBUG_VGA_DRAW
 
 typedef uint8_t* (*VGA_Line_Handler)(Bitu vidstart, Bitu line);
@@ -307,34 +313,6 @@ static uint8_t * VGA_Draw_4BPP_Line_Double(Bitu vidstart, Bitu line) {
 	return TempLine;
 }
 
-#ifdef VGA_KEEP_CHANGES
-static uint8_t * VGA_Draw_Changes_Line(Bitu vidstart, Bitu line) {
-	Bitu checkMask = vga.changes.checkMask;
-	uint8_t *map = vga.changes.map;
-	Bitu start = (vidstart >> VGA_CHANGE_SHIFT);
-	Bitu end = ((vidstart + vga.draw.line_length ) >> VGA_CHANGE_SHIFT);
-	for (; start <= end; ++start) {
-		if ( map[start] & checkMask ) {
-			Bitu offset = vidstart & vga.draw.linear_mask;
-			if (vga.draw.linear_mask-offset < vga.draw.line_length)
-				memcpy(vga.draw.linear_base+vga.draw.linear_mask+1, vga.draw.linear_base, vga.draw.line_length);
-			uint8_t *ret = &vga.draw.linear_base[ offset ];
-#if !defined(C_UNALIGNED_MEMORY)
-			if (((Bitu)ret) & (sizeof(Bitu) - 1)) {
-				memcpy( TempLine, ret, vga.draw.line_length );
-				return TempLine;
-			}
-#endif
-			return ret;
-		}
-	}
-//	memset( TempLine, 0x30, vga.changes.lineWidth );
-//	return TempLine;
-	return 0;
-}
-
-#endif
-
 static uint8_t * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
 	Bitu offset = vidstart & vga.draw.linear_mask;
 	uint8_t* ret = &vga.draw.linear_base[offset];
@@ -367,118 +345,84 @@ static uint8_t * VGA_Draw_Linear_Line(Bitu vidstart, Bitu /*line*/) {
 	return ret;
 }
 
-static uint8_t* draw_unwrapped_line_from_dac_palette(Bitu vidstart,
-                                                     [[maybe_unused]] const Bitu line = 0)
+// Looks up a run of 8-bit pixels in the DAC palette and writes them out as
+// 32-bit pixels. The run must not wrap around the end of video memory, so
+// the pixels can be read without masking their addresses.
+static inline void draw_pixels_from_dac_palette(const uint8_t* palette_indexes,
+                                                uint8_t* line_addr,
+                                                size_t num_pixels)
 {
-	// Quick references
-	static constexpr auto palette_map        = vga.dac.palette_map;
-	static constexpr uint8_t bytes_per_pixel = sizeof(palette_map[0]);
-	const auto linear_mask                   = vga.draw.linear_mask;
-	const auto linear_addr                   = vga.draw.linear_base;
-
-	// Video mode-specific line variables
-	const auto pixels_in_line = static_cast<uint16_t>(vga.draw.line_length /
-	                                                  bytes_per_pixel);
-	const auto video_end = vidstart + pixels_in_line;
+	const auto palette_map = vga.dac.palette_map;
 
-	// The line address is where the RGB888 palettized pixel is written.
-	// It's incremented forward per pixel.
-	auto line_addr = reinterpret_cast<uint32_t*>(TempLine);
+	// Draw in batches of eight independent lookups to let the host
+	// pipeline deeper
+	constexpr auto batch_size = 8;
+	while (num_pixels >= batch_size) {
+		for (auto i = 0; i < batch_size; ++i) {
+			write_unaligned_uint32_at(line_addr,
+			                          i,
+			                          palette_map[palette_indexes[i]]);
+		}
+		palette_indexes += batch_size;
+		line_addr += batch_size * sizeof(uint32_t);
+		num_pixels -= batch_size;
+	}
+	while (num_pixels--) {
+		write_unaligned_uint32(line_addr, palette_map[*palette_indexes++]);
+		line_addr += sizeof(uint32_t);
+	}
+}
 
-	auto linear_pos = vidstart;
+// Draws a line of 8-bit pixels through the DAC palette. Lines that run past
+// the end of video memory continue from its start.
+static void draw_masked_pixels_from_dac_palette(const Bitu vidstart,
+                                                const size_t num_pixels)
+{
+	const auto linear_mask = vga.draw.linear_mask;
+	const auto offset      = vidstart & linear_mask;
+
+	// The fast path for lines not wrapping around
+	const auto unwrapped_len = std::min<size_t>(num_pixels,
+	                                            linear_mask + 1 - offset);
+	draw_pixels_from_dac_palette(vga.draw.linear_base + offset,
+	                             TempLine,
+	                             unwrapped_len);
+
+	// Note: To exercise the wrapped scenarios, run:
+	// 1. Dangerous Dave: jump on the tree at the start.
+	// 2. Commander Keen 4: move to left of the first hill on stage 1.
+	if (unwrapped_len < num_pixels) {
+		draw_pixels_from_dac_palette(vga.draw.linear_base,
+		                             TempLine + unwrapped_len * sizeof(uint32_t),
+		                             num_pixels - unwrapped_len);
+	}
+}
 
-	// Draw in batches of four to let the host pipeline deeper.
-	constexpr auto num_repeats = 4;
-	assert(pixels_in_line % num_repeats == 0);
+static uint8_t* draw_unwrapped_line_from_dac_palette(Bitu vidstart,
+                                                     [[maybe_unused]] const Bitu line = 0)
+{
+	constexpr uint8_t bytes_per_pixel = sizeof(vga.dac.palette_map[0]);
 
 	// This function typically runs on 640+-wide lines and is a rendering
 	// bottleneck.
-	while (linear_pos < video_end) {
-		auto repeats = num_repeats;
-		while (repeats--) {
-			const auto masked_pos    = linear_pos++ & linear_mask;
-			const auto palette_index = *(linear_addr + masked_pos);
-			*line_addr++ = *(palette_map + palette_index);
-		}
-	}
-
+	draw_masked_pixels_from_dac_palette(vidstart,
+	                                    vga.draw.line_length / bytes_per_pixel);
 	return TempLine;
 }
 
 static uint8_t* draw_linear_line_from_dac_palette(Bitu vidstart, Bitu /*line*/)
 {
-	const auto offset                 = vidstart & vga.draw.linear_mask;
-	constexpr auto palette_map        = vga.dac.palette_map;
-	constexpr uint8_t bytes_per_pixel = sizeof(palette_map[0]);
-
-	// The line address is where the RGB888 palettized pixel is written.
-	// It's incremented forward per pixel.
-	auto line_addr = TempLine;
-
-	// The palette index iterator is used to lookup the DAC palette colour.
-	// It starts at the current VGA line's offset and is incremented per
-	// pixel.
-	auto palette_index_it = vga.draw.linear_base + offset;
-
-	// Pixels remaining starts as the total pixels in this current line and
-	// is decremented per pixel rendered. It acts as a lower-bound cutoff
-	// regardless of how long the wrapped and unwrapped regions are.
-	auto pixels_remaining = check_cast<uint16_t>(vga.draw.line_length /
-	                                             bytes_per_pixel);
+	constexpr uint8_t bytes_per_pixel = sizeof(vga.dac.palette_map[0]);
 
 	// If the screen is disabled, just paint black. This fixes screen
 	// fades in titles like Alien Carnage.
 	if (vga.seq.clocking_mode.is_screen_disabled) {
-		memset(line_addr, 0, vga.draw.line_length);
+		memset(TempLine, 0, vga.draw.line_length);
 		return TempLine;
 	}
 
-	// see VGA_Draw_Linear_Line
-	if ((vga.draw.line_length + offset) & ~vga.draw.linear_mask) {
-		// Note: To exercise these wrapped scenarios, run:
-		// 1. Dangerous Dave: jump on the tree at the start.
-		// 2. Commander Keen 4: move to left of the first hill on stage 1.
-
-		const auto end = (vga.draw.line_length + offset) &
-		                 vga.draw.linear_mask;
-
-		// assuming lines not longer than 4096 pixels
-		const auto wrapped_len   = static_cast<uint16_t>(end & 0xFFF);
-		const auto unwrapped_len = check_cast<uint16_t>(
-		        vga.draw.line_length - wrapped_len);
-
-		// unwrapped chunk: to top of memory block
-		auto palette_index_end = palette_index_it +
-		                         std::min(unwrapped_len, pixels_remaining);
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-			--pixels_remaining;
-		}
-
-		// wrapped chunk: from the base of the memory block
-		palette_index_it  = vga.draw.linear_base;
-		palette_index_end = palette_index_it +
-		                    std::min(wrapped_len, pixels_remaining);
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-			--pixels_remaining;
-		}
-
-	} else {
-		auto palette_index_end = palette_index_it + pixels_remaining;
-		while (palette_index_it != palette_index_end) {
-			memcpy(line_addr,
-			       palette_map + *palette_index_it++,
-			       bytes_per_pixel);
-			line_addr += bytes_per_pixel;
-		}
-	}
+	draw_masked_pixels_from_dac_palette(vidstart,
+	                                    vga.draw.line_length / bytes_per_pixel);
 	return TempLine;
 }
 
@@ -794,6 +738,35 @@ static uint8_t *VGA_TEXT_Herc_Draw_Line(Bitu vidstart, Bitu line)
 	}
 	return TempLine;
 }
+// Expands the eight pixels of a glyph row, most significant bit first, to
+// the foreground colour where the bit is set and to the background colour
+// where it's not.
+static inline void draw_glyph_row(uint8_t* line_addr, const uint8_t glyph_bits,
+                                  const uint32_t fg_colour, const uint32_t bg_colour)
+{
+#if defined(__SSE2__)
+	const auto bits = _mm_set1_epi32(glyph_bits);
+	const auto fg   = _mm_set1_epi32(static_cast<int>(fg_colour));
+	const auto bg   = _mm_set1_epi32(static_cast<int>(bg_colour));
+
+	auto draw_four = [&](uint8_t* dest, const __m128i bit_masks) {
+		const auto is_fg = _mm_cmpeq_epi32(_mm_and_si128(bits, bit_masks),
+		                                   bit_masks);
+		const auto pixels = _mm_or_si128(_mm_and_si128(is_fg, fg),
+		                                 _mm_andnot_si128(is_fg, bg));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), pixels);
+	};
+	draw_four(line_addr, _mm_setr_epi32(0x80, 0x40, 0x20, 0x10));
+	draw_four(line_addr + 4 * sizeof(uint32_t),
+	          _mm_setr_epi32(0x08, 0x04, 0x02, 0x01));
+#else
+	for (auto n = 0; n < 8; ++n) {
+		const auto color = (glyph_bits & (0x80 >> n)) ? fg_colour : bg_colour;
+		write_unaligned_uint32_at(line_addr, n, color);
+	}
+#endif
+}
+
 // combined 8/9-dot wide text mode line drawing function
 static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 {
@@ -842,27 +815,21 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 		const auto fg_colour = palette_map[fg_palette_idx];
 		const auto bg_colour = palette_map[bg_palette_idx];
 
-		if (vga.seq.clocking_mode.is_eight_dot_mode) {
-			for (auto n = 0; n < 8; ++n) {
-				const auto color = (font & 0x80) ? fg_colour
-				                                 : bg_colour;
-				write_unaligned_uint32_at(TempLine, draw_idx++, color);
-				font <<= 1;
-			}
-		} else {
-			font <<= 1; // 9 pixels
-			// Extend to the 9th pixel if needed
-			if ((font & 0x2) &&
-			    vga.attr.mode_control.is_line_graphics_enabled &&
-			    (chr >= 0xc0) && (chr <= 0xdf)) {
-				font |= 1;
-			}
-			for (auto n = 0; n < 9; ++n) {
-				const auto color = (font & 0x100) ? fg_colour
-				                                  : bg_colour;
-				write_unaligned_uint32_at(TempLine, draw_idx++, color);
-				font <<= 1;
-			}
+		draw_glyph_row(TempLine + draw_idx * sizeof(uint32_t),
+		               static_cast<uint8_t>(font),
+		               fg_colour,
+		               bg_colour);
+		draw_idx += 8;
+
+		if (!vga.seq.clocking_mode.is_eight_dot_mode) {
+			// The 9th pixel repeats the 8th for the line graphics
+			// characters, and is background otherwise
+			const auto is_extended = (font & 0x1) &&
+			                         vga.attr.mode_control.is_line_graphics_enabled &&
+			                         (chr >= 0xc0) && (chr <= 0xdf);
+			write_unaligned_uint32_at(TempLine,
+			                          draw_idx++,
+			                          is_extended ? fg_colour : bg_colour);
 		}
 	}
 	// draw the text mode cursor if needed
@@ -892,22 +859,34 @@ static uint8_t* draw_text_line_from_dac_palette(Bitu vidstart, Bitu line)
 	return TempLine + 32;
 }
 
-#ifdef VGA_KEEP_CHANGES
-static inline void VGA_ChangesEnd(void ) {
-	if ( vga.changes.active ) {
-//		vga.changes.active = false;
-		Bitu end = vga.draw.address >> VGA_CHANGE_SHIFT;
-		Bitu total = 4 + end - vga.changes.start;
-		uint32_t clearMask = vga.changes.clearMask;
-		total >>= 2;
-		uint32_t *clear = (uint32_t *)&vga.changes.map[  vga.changes.start & ~3 ];
-		while ( total-- ) {
-			clear[0] &= clearMask;
-			++clear;
+// Returns whether none of the video memory pages the line is drawn from have
+// been written to since the line was last passed to the renderer
+static bool is_line_unchanged(const Bitu vidstart)
+{
+	const auto& changes = vga.changes;
+
+	auto are_pages_unchanged = [&](const Bitu first, const Bitu last) {
+		for (auto page = first >> VGA_CHANGE_SHIFT;
+		     page <= (last >> VGA_CHANGE_SHIFT);
+		     ++page) {
+			if (changes.pages[page] >= changes.first_unseen_frame) {
+				return false;
+			}
 		}
+		return true;
+	};
+
+	const auto mask  = vga.draw.linear_mask;
+	const auto first = vidstart & mask;
+	const auto last  = first + changes.line_bytes - 1;
+
+	// Lines wrapping around the end of the memory continue from its start
+	if (last <= mask) {
+		return are_pages_unchanged(first, last);
 	}
+	return are_pages_unchanged(first, mask) &&
+	       are_pages_unchanged(0, last & mask);
 }
-#endif
 
 static void VGA_ProcessSplit()
 {
@@ -1054,7 +1033,13 @@ static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
 static void VGA_DrawPart(uint32_t lines)
 {
 	while (lines--) {
-		uint8_t * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
+		// Unchanged lines are passed to the renderer as a nullptr, so
+		// they're neither drawn, compared, nor copied
+		uint8_t* data = nullptr;
+		if (!vga.changes.skip_unchanged_lines ||
+		    !is_line_unchanged(vga.draw.address)) {
+			data = VGA_DrawLine(vga.draw.address, vga.draw.address_line);
+		}
 		ReelMagic_RENDER_DrawLine(data);
 		++vga.draw.address_line;
 		if (vga.draw.address_line>=vga.draw.address_line_total) {
@@ -1063,13 +1048,7 @@ static void VGA_DrawPart(uint32_t lines)
 		}
 		++vga.draw.lines_done;
 		if (vga.draw.split_line==vga.draw.lines_done) {
-#ifdef VGA_KEEP_CHANGES
-			VGA_ChangesEnd( );
-#endif
 			VGA_ProcessSplit();
-#ifdef VGA_KEEP_CHANGES
-			vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-#endif
 		}
 	}
 	if (--vga.draw.parts_left) {
@@ -1078,9 +1057,7 @@ static void VGA_DrawPart(uint32_t lines)
 		                     ? vga.draw.parts_lines
 		                     : (vga.draw.lines_total - vga.draw.lines_done));
 	} else {
-#ifdef VGA_KEEP_CHANGES
-		VGA_ChangesEnd();
-#endif
+		vga.changes.is_previous_frame_complete = true;
 		RENDER_EndUpdate(false);
 	}
 }
@@ -1104,28 +1081,41 @@ void VGA_SetBlinking(const uint8_t enabled)
 	}
 }
 
-#ifdef VGA_KEEP_CHANGES
-static void inline VGA_ChangesStart( void ) {
-	vga.changes.start = vga.draw.address >> VGA_CHANGE_SHIFT;
-	vga.changes.last = vga.changes.start;
-	if ( vga.changes.lastAddress != vga.draw.address ) {
-//		LOG_MSG("Address");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-		vga.changes.lastAddress = vga.draw.address;
-	} else if ( render.fullFrame ) {
-//		LOG_MSG("Full Frame");
-		VGA_DrawLine = VGA_Draw_Linear_Line;
-	} else {
-//		LOG_MSG("Changes");
-		VGA_DrawLine = VGA_Draw_Changes_Line;
-	}
-	vga.changes.active = true;
-	vga.changes.checkMask = vga.changes.writeMask;
-	vga.changes.clearMask = ~( 0x01010101 << (vga.changes.frame & 7));
-	++vga.changes.frame;
-	vga.changes.writeMask = 1 << (vga.changes.frame & 7);
+// Decides whether the frame about to be drawn can skip the lines drawn from
+// unchanged video memory pages
+static void VGA_ChangesStart()
+{
+	auto& changes = vga.changes;
+
+	const VgaChanges::DrawState draw_state = {
+	        vga.draw.address,
+	        vga.draw.address_add,
+	        vga.draw.split_line,
+	        vga.draw.linear_base,
+	        vga.draw.linear_mask,
+	        static_cast<bool>(vga.seq.clocking_mode.is_screen_disabled)};
+
+	const bool has_hw_cursor = (svga.hardware_cursor_active &&
+	                            svga.hardware_cursor_active());
+
+	// The renderer's cache only holds the previous picture if that frame
+	// was drawn in full and nothing but video memory writes changed since
+	changes.skip_unchanged_lines = changes.is_tracking &&
+	                               changes.is_previous_frame_complete &&
+	                               !changes.needs_full_frame &&
+	                               !render.fullFrame && !has_hw_cursor &&
+	                               !ReelMagic_IsVideoMixerEnabled() &&
+	                               draw_state == changes.last_draw_state;
+
+	changes.last_draw_state            = draw_state;
+	changes.needs_full_frame           = false;
+	changes.is_previous_frame_complete = false;
+
+	// Writes made since the previous frame started might have landed
+	// after their lines were drawn
+	changes.first_unseen_frame = changes.frame;
+	++changes.frame;
 }
-#endif
 
 static void VGA_VertInterrupt(uint32_t /*val*/)
 {
@@ -1218,9 +1208,9 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		++vga.draw.split_line; // EGA adds one buggy scanline
 	}
 //	if (machine==MCH_EGA) vga.draw.split_line = ((((vga.config.line_compare&0x5ff)+1)*2-1)/vga.draw.lines_scaled);
-#ifdef VGA_KEEP_CHANGES
-	bool startaddr_changed=false;
-#endif
+	// Only the modes drawn straight from video memory can skip the lines
+	// drawn from unchanged pages
+	bool is_drawn_from_memory = false;
 	switch (vga.mode) {
 	case M_EGA:
 		if (!(vga.crtc.mode_control.map_display_address_13)) {
@@ -1234,9 +1224,7 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		if (machine!=MCH_EGA) vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
+		is_drawn_from_memory = true;
 		break;
 	case M_VGA:
 		if (vga.config.compatible_chain4 && (vga.crtc.underline_location & 0x40)) {
@@ -1256,9 +1244,7 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		vga.draw.address += vga.draw.bytes_skip;
 		vga.draw.address *= vga.draw.byte_panning_shift;
 		vga.draw.address += vga.draw.panning;
-#ifdef VGA_KEEP_CHANGES
-		startaddr_changed=true;
-#endif
+		is_drawn_from_memory = true;
 		break;
 	case M_TEXT:
 		vga.draw.byte_panning_shift = 2;
@@ -1296,9 +1282,11 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 	if (vga.draw.split_line == 0) {
 		VGA_ProcessSplit();
 	}
-#ifdef VGA_KEEP_CHANGES
-	if (startaddr_changed) VGA_ChangesStart();
-#endif
+	if (is_drawn_from_memory) {
+		VGA_ChangesStart();
+	} else {
+		vga.changes.skip_unchanged_lines = false;
+	}
 
 	// check if some lines at the top off the screen are blanked
 	double draw_skip = 0.0;
@@ -2859,11 +2847,17 @@ ImageInfo setup_drawing()
 	vga.draw.line_length = render_width *
 	                       ((get_bits_per_pixel(pixel_format) + 1) / 8);
 
-#ifdef VGA_KEEP_CHANGES
-	vga.changes.active    = false;
-	vga.changes.frame     = 0;
-	vga.changes.writeMask = 1;
-#endif
+	// The number of video memory bytes a line is drawn from; the line
+	// length is larger for the modes drawn through the DAC palette
+	vga.changes.line_bytes = render_width;
+	switch (vga.mode) {
+	case M_LIN15:
+	case M_LIN16: vga.changes.line_bytes *= 2; break;
+	case M_LIN24: vga.changes.line_bytes *= 3; break;
+	case M_LIN32: vga.changes.line_bytes *= 4; break;
+	default: break;
+	}
+	vga.changes.needs_full_frame = true;
 
 #ifdef DEBUG_VGA_DRAW
 	LOG_DEBUG("VGA: horiz.total: %d, vert.total: %d",
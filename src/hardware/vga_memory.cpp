@@ -21,6 +21,8 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
+#include <array>
 #include <cstdlib>
 #include <cstring>
 #include <vector>
@@ -52,12 +54,17 @@
 #define CHECKED4(v) ((v)&((vga.vmemwrap>>2)-1))
 
 
-#ifdef VGA_KEEP_CHANGES
-#define MEM_CHANGED( _MEM ) vga.changes.map[ (_MEM) >> VGA_CHANGE_SHIFT ] |= vga.changes.writeMask;
-//#define MEM_CHANGED( _MEM ) vga.changes.map[ (_MEM) >> VGA_CHANGE_SHIFT ] = 1;
-#else
-#define MEM_CHANGED( _MEM ) 
-#endif
+// Marks the pages holding the written bytes as changed in the current frame
+static inline void mark_changed(const PhysPt first, const PhysPt num_bytes)
+{
+	auto& changes = vga.changes;
+
+	const auto last_page = (first + num_bytes - 1) >> VGA_CHANGE_SHIFT;
+	assert(last_page < changes.pages.size());
+	for (auto page = first >> VGA_CHANGE_SHIFT; page <= last_page; ++page) {
+		changes.pages[page] = changes.frame;
+	}
+}
 
 #define TANDY_VIDBASE(_X_)  &MemBase[ 0x80000 + (_X_)]
 
@@ -119,29 +126,63 @@ static struct {
 	Bitu base, mask;
 } vgapages;
 
-static void read_delay()
+// The block writes of the string instructions account for the delays of all
+// their accesses at once
+static void read_delay(const uint32_t num_accesses = 1)
 {
 	if (vga.vmem_delay_ns > 0) {
 		const int32_t delay_cycles = (CPU_CycleMax * vga.vmem_delay_ns) /
-		                             1000000;
+		                             1000000 *
+		                             static_cast<int32_t>(num_accesses);
 		CPU_Cycles -= delay_cycles;
 		CPU_IODelayRemoved += delay_cycles;
 	}
 }
 
-static void write_delay()
+static void write_delay(const uint32_t num_accesses = 1)
 {
 	if (vga.vmem_delay_ns > 0) {
 		const int32_t delay_cycles = (CPU_CycleMax * vga.vmem_delay_ns * 3) /
-		                             (1000000 * 4);
+		                             (1000000 * 4) *
+		                             static_cast<int32_t>(num_accesses);
 		CPU_Cycles -= delay_cycles;
 		CPU_IODelayRemoved += delay_cycles;
 	}
 }
 
+// Expands the four planes of an EGA byte into its eight pixels in 'fastmem'
+static inline void expand_ega_pixels(const PhysPt offset, const uint32_t planes)
+{
+	uint8_t* write_pixels = &vga.fastmem[offset << 3];
+
+	VgaLatch temp;
+	temp.d = (planes >> 4) & 0x0f0f0f0f;
+	const uint32_t colors0_3 = Expand16Table[0][temp.b[0]] |
+	                           Expand16Table[1][temp.b[1]] |
+	                           Expand16Table[2][temp.b[2]] |
+	                           Expand16Table[3][temp.b[3]];
+	*(uint32_t*)write_pixels = colors0_3;
+
+	temp.d = planes & 0x0f0f0f0f;
+	const uint32_t colors4_7 = Expand16Table[0][temp.b[0]] |
+	                           Expand16Table[1][temp.b[1]] |
+	                           Expand16Table[2][temp.b[2]] |
+	                           Expand16Table[3][temp.b[3]];
+	*(uint32_t*)(write_pixels + 4) = colors4_7;
+}
+
+// Returns whether a run of offsets stays within video memory instead of
+// wrapping around its end
+static inline bool is_contiguous(const PhysPt first, const PhysPt num_bytes,
+                                 const PhysPt wrap_mask)
+{
+	const auto last = first + num_bytes - 1;
+	return (first & wrap_mask) == first && (last & wrap_mask) == last;
+}
+
 class VGA_UnchainedRead_Handler : public PageHandler {
 public:
-	uint8_t readHandler(PhysPt start)
+	static uint8_t readHandler(PhysPt start)
 	{
 		vga.latch.d=((uint32_t*)vga.mem.linear)[start];
 		switch (vga.config.read_mode) {
@@ -186,6 +227,146 @@ public:
 		                             (readHandler(addr + 2) << 16) |
 		                             (readHandler(addr + 3) << 24));
 	}
+
+	// The block writes apply the write mode to whole runs of planar
+	// offsets, each holding one byte of all four planes
+	void FillBlock(PhysPt addr, const uint32_t val, const uint8_t width,
+	               const uint32_t count) override
+	{
+		const auto start     = WriteOffset(addr);
+		const auto num_bytes = width * count;
+		if (!is_contiguous(start, num_bytes, (vga.vmemwrap >> 2) - 1)) {
+			PageHandler::FillBlock(addr, val, width, count);
+			return;
+		}
+		write_delay(count);
+
+		const auto map_mask     = vga.config.full_map_mask;
+		const auto not_map_mask = vga.config.full_not_map_mask;
+
+		// The latches don't change while writing, so each byte of the
+		// value always results in the same data
+		std::array<uint32_t, 4> data = {};
+		for (uint8_t i = 0; i < width; ++i) {
+			const auto byte = static_cast<uint8_t>(val >> (i * 8));
+			data[i] = ModeOperation(byte) & map_mask;
+		}
+		const auto planes = ((uint32_t*)vga.mem.linear) + start;
+		if (width == 1) {
+			const auto fill = data[0];
+			for (uint32_t i = 0; i < num_bytes; ++i) {
+				planes[i] = (planes[i] & not_map_mask) | fill;
+			}
+		} else {
+			for (uint32_t i = 0; i < num_bytes; ++i) {
+				planes[i] = (planes[i] & not_map_mask) |
+				            data[i & (width - 1)];
+			}
+		}
+		PlanesWritten(start, num_bytes);
+	}
+
+	void WriteBlock(PhysPt addr, const uint8_t* data, const uint8_t width,
+	                const uint32_t count) override
+	{
+		const auto start     = WriteOffset(addr);
+		const auto num_bytes = width * count;
+		if (!is_contiguous(start, num_bytes, (vga.vmemwrap >> 2) - 1)) {
+			PageHandler::WriteBlock(addr, data, width, count);
+			return;
+		}
+		write_delay(count);
+
+		for (uint32_t i = 0; i < num_bytes; i += width) {
+			// The source can be video memory mapped elsewhere, so
+			// take each element before writing it
+			std::array<uint8_t, 4> vals = {};
+			memcpy(vals.data(), data + i, width);
+			for (uint8_t j = 0; j < width; ++j) {
+				WritePlanes(start + i + j, vals[j]);
+			}
+		}
+		PlanesWritten(start, num_bytes);
+	}
+
+	void CopyBlock(PhysPt dest, PhysPt src, const uint8_t width,
+	               const uint32_t count) override
+	{
+		const auto dest_start = WriteOffset(dest);
+		const auto src_start  = ReadOffset(src);
+		const auto num_bytes  = width * count;
+
+		const auto wrap_mask = (vga.vmemwrap >> 2) - 1;
+		if (!is_contiguous(dest_start, num_bytes, wrap_mask) ||
+		    !is_contiguous(src_start, num_bytes, wrap_mask)) {
+			PageHandler::CopyBlock(dest, src, width, count);
+			return;
+		}
+		read_delay(count);
+		write_delay(count);
+
+		const auto linear = (uint32_t*)vga.mem.linear;
+		if (vga.config.write_mode == 1 && width == 1) {
+			// Latch copies, such as the page flips of Mode X games,
+			// write the planes of each byte as they were read
+			const auto map_mask     = vga.config.full_map_mask;
+			const auto not_map_mask = vga.config.full_not_map_mask;
+
+			const auto from = linear + src_start;
+			const auto to   = linear + dest_start;
+			for (uint32_t i = 0; i < num_bytes; ++i) {
+				to[i] = (to[i] & not_map_mask) |
+				        (from[i] & map_mask);
+			}
+			vga.latch.d = from[num_bytes - 1];
+		} else {
+			for (uint32_t i = 0; i < num_bytes; i += width) {
+				// Words and dwords are read in full, leaving
+				// their last byte in the latches, before being
+				// written
+				const auto from = src_start + i;
+				const auto to   = dest_start + i;
+
+				std::array<uint8_t, 4> vals = {};
+				for (uint8_t j = 0; j < width; ++j) {
+					vals[j] = readHandler(from + j);
+				}
+				for (uint8_t j = 0; j < width; ++j) {
+					WritePlanes(to + j, vals[j]);
+				}
+			}
+		}
+		PlanesWritten(dest_start, num_bytes);
+	}
+
+protected:
+	// Applies the write mode to a byte and returns the resulting planes
+	static inline uint32_t WritePlanes(PhysPt offset, uint8_t val)
+	{
+		const uint32_t data = ModeOperation(val);
+
+		auto& planes = ((uint32_t*)vga.mem.linear)[offset];
+		planes = (planes & vga.config.full_not_map_mask) |
+		         (data & vga.config.full_map_mask);
+		return planes;
+	}
+
+	// The planar offsets of the linear addresses, before wrapping around
+	// the end of video memory
+	virtual PhysPt WriteOffset(const PhysPt addr)
+	{
+		return (PAGING_GetPhysicalAddress(addr) & vgapages.mask) +
+		       vga.svga.bank_write_full;
+	}
+
+	virtual PhysPt ReadOffset(const PhysPt addr)
+	{
+		return (PAGING_GetPhysicalAddress(addr) & vgapages.mask) +
+		       vga.svga.bank_read_full;
+	}
+
+	// Marks the planar offsets written by a block write as changed
+	virtual void PlanesWritten(PhysPt start, PhysPt num_bytes) = 0;
 };
 
 class VGA_ChainedEGA_Handler final : public PageHandler {
@@ -194,29 +375,18 @@ public:
 	void writeHandler(PhysPt start, uint8_t val) {
 		ModeOperation(val);
 		/* Update video memory and the pixel buffer */
-		VgaLatch pixels;
 		vga.mem.linear[start] = val;
 		start >>= 2;
-		pixels.d=((uint32_t*)vga.mem.linear)[start];
-
-		uint8_t * write_pixels=&vga.fastmem[start<<3];
-
-		uint32_t colors0_3, colors4_7;
-		VgaLatch temp;
-		temp.d=(pixels.d>>4) & 0x0f0f0f0f;
-		colors0_3 = 
-			Expand16Table[0][temp.b[0]] |
-			Expand16Table[1][temp.b[1]] |
-			Expand16Table[2][temp.b[2]] |
-			Expand16Table[3][temp.b[3]];
-		*(uint32_t *)write_pixels=colors0_3;
-		temp.d=pixels.d & 0x0f0f0f0f; //-V519
-		colors4_7 = 
-			Expand16Table[0][temp.b[0]] |
-			Expand16Table[1][temp.b[1]] |
-			Expand16Table[2][temp.b[2]] |
-			Expand16Table[3][temp.b[3]];
-		*(uint32_t *)(write_pixels+4)=colors4_7;
+		expand_ega_pixels(start, ((uint32_t*)vga.mem.linear)[start]);
+	}
+
+	// Each group of four linear bytes expands to eight pixels in the
+	// fast-memory buffer, so mark the pixels of the groups written to
+	static void MarkChanged(const PhysPt addr, const PhysPt num_bytes)
+	{
+		const auto first_group = addr >> 2;
+		const auto last_group  = (addr + num_bytes - 1) >> 2;
+		mark_changed(first_group << 3, (last_group - first_group + 1) << 3);
 	}
 public:	
 	VGA_ChainedEGA_Handler()  {
@@ -229,7 +399,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		MarkChanged(addr, 1);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 	}
 
@@ -239,7 +409,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		MarkChanged(addr, 2);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 	}
@@ -250,7 +420,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr << 3);
+		MarkChanged(addr, 4);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 		writeHandler(addr+2,(uint8_t)(val >> 16));
@@ -292,35 +462,12 @@ public:
 class VGA_UnchainedEGA_Handler : public VGA_UnchainedRead_Handler {
 public:
 	void writeHandler(PhysPt start, uint8_t val) {
-		uint32_t data=ModeOperation(val);
 		/* Update video memory and the pixel buffer */
-		VgaLatch pixels;
-		pixels.d=((uint32_t*)vga.mem.linear)[start];
-		pixels.d&=vga.config.full_not_map_mask;
-		pixels.d|=(data & vga.config.full_map_mask);
-		((uint32_t*)vga.mem.linear)[start]=pixels.d;
-		uint8_t * write_pixels=&vga.fastmem[start<<3];
-
-		uint32_t colors0_3, colors4_7;
-		VgaLatch temp;
-		temp.d=(pixels.d>>4) & 0x0f0f0f0f;
-			colors0_3 = 
-			Expand16Table[0][temp.b[0]] |
-			Expand16Table[1][temp.b[1]] |
-			Expand16Table[2][temp.b[2]] |
-			Expand16Table[3][temp.b[3]];
-		*(uint32_t *)write_pixels=colors0_3;
-		temp.d=pixels.d & 0x0f0f0f0f; //-V519
-		colors4_7 = 
-			Expand16Table[0][temp.b[0]] |
-			Expand16Table[1][temp.b[1]] |
-			Expand16Table[2][temp.b[2]] |
-			Expand16Table[3][temp.b[3]];
-		*(uint32_t *)(write_pixels+4)=colors4_7;
+		expand_ega_pixels(start, WritePlanes(start, val));
 	}
 public:	
 	VGA_UnchainedEGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKWRITE;
 	}
 
 	void writeb(PhysPt addr, uint8_t val) override
@@ -329,7 +476,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 3);
+		mark_changed(addr << 3, 8);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 	}
 
@@ -339,7 +486,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 3);
+		mark_changed(addr << 3, 2 * 8);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 	}
@@ -350,19 +497,30 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 3);
+		mark_changed(addr << 3, 4 * 8);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 		writeHandler(addr+2,(uint8_t)(val >> 16));
 		writeHandler(addr+3,(uint8_t)(val >> 24));
 	}
+
+protected:
+	void PlanesWritten(const PhysPt start, const PhysPt num_bytes) override
+	{
+		mark_changed(start << 3, num_bytes * 8);
+
+		const auto planes = (uint32_t*)vga.mem.linear;
+		for (auto i = start; i < start + num_bytes; ++i) {
+			expand_ega_pixels(i, planes[i]);
+		}
+	}
 };
 
 //Slighly unusual version, will directly write 8,16,32 bits values
 class VGA_ChainedVGA_Handler final : public PageHandler {
 public:
 	VGA_ChainedVGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKWRITE;
 	}
 	static inline uint8_t *ToLinear(PhysPt addr)
 	{
@@ -394,6 +552,18 @@ public:
 		}
 	}
 	
+	// Depending on the mode, the lines are drawn from either the linear
+	// memory or its 'fastmem' copy, so mark the written pages in both
+	static inline void MarkChanged(PhysPt addr, PhysPt num_bytes)
+	{
+		mark_changed(addr, num_bytes);
+
+		const auto first = static_cast<PhysPt>(ToLinear(addr) - vga.mem.linear);
+		const auto last = static_cast<PhysPt>(
+		        ToLinear(addr + num_bytes - 1) - vga.mem.linear);
+		mark_changed(first, last - first + 1);
+	}
+
 	static inline void writeCache_byte(PhysPt addr, uint8_t val)
 	{
 		WriteCache_template(host_writeb, addr, val);
@@ -409,6 +579,37 @@ public:
 		WriteCache_template(host_writed, addr, val);
 	}
 
+	// Block writes update the cache as they go, and replicate the part of
+	// the first line they wrote at the end
+	static inline void ReplicateFirstLine(PhysPt start, PhysPt num_bytes)
+	{
+		constexpr PhysPt LineBytes = 320;
+		if (start < LineBytes) {
+			num_bytes = std::min(num_bytes, LineBytes - start);
+			memcpy(&vga.fastmem[start + 64 * 1024],
+			       &vga.fastmem[start],
+			       num_bytes);
+		}
+	}
+
+	static inline void WriteBlockByte(PhysPt addr, uint8_t val)
+	{
+		writeHandler_byte(addr, val);
+		host_writeb(&vga.fastmem[addr], val);
+	}
+
+	static inline PhysPt WriteOffset(PhysPt addr)
+	{
+		return (PAGING_GetPhysicalAddress(addr) & vgapages.mask) +
+		       vga.svga.bank_write_full;
+	}
+
+	static inline PhysPt ReadOffset(PhysPt addr)
+	{
+		return (PAGING_GetPhysicalAddress(addr) & vgapages.mask) +
+		       vga.svga.bank_read_full;
+	}
+
 	// No need to check for compatible chains here, this one is only enabled
 	// if that bit is set
 	static inline void writeHandler_byte(PhysPt addr, uint8_t val)
@@ -474,7 +675,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
+		MarkChanged(addr, 1);
 		writeHandler_byte(addr, val);
 		writeCache_byte(addr, val);
 	}
@@ -485,8 +686,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
-//		MEM_CHANGED( addr + 1);
+		MarkChanged(addr, 2);
 		if (addr & 1) {
 			writeHandler_byte(addr + 0, val >> 0);
 			writeHandler_byte(addr + 1, val >> 8);
@@ -502,8 +702,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
-//		MEM_CHANGED( addr + 3);
+		MarkChanged(addr, 4);
 		if (addr & 3) {
 			writeHandler_byte(addr + 0, val >> 0);
 			writeHandler_byte(addr + 1, val >> 8);
@@ -514,23 +713,89 @@ public:
 		}
 		writeCache_dword(addr, val);
 	}
+
+	void FillBlock(PhysPt addr, const uint32_t val, const uint8_t width,
+	               const uint32_t count) override
+	{
+		const auto start     = WriteOffset(addr);
+		const auto num_bytes = width * count;
+		if (!is_contiguous(start, num_bytes, vga.vmemwrap - 1)) {
+			PageHandler::FillBlock(addr, val, width, count);
+			return;
+		}
+		write_delay(count);
+		MarkChanged(start, num_bytes);
+
+		for (uint32_t i = 0; i < num_bytes; ++i) {
+			const auto shift = (i & (width - 1)) * 8;
+			const auto byte  = static_cast<uint8_t>(val >> shift);
+			WriteBlockByte(start + i, byte);
+		}
+		ReplicateFirstLine(start, num_bytes);
+	}
+
+	void WriteBlock(PhysPt addr, const uint8_t* data, const uint8_t width,
+	                const uint32_t count) override
+	{
+		const auto start     = WriteOffset(addr);
+		const auto num_bytes = width * count;
+		if (!is_contiguous(start, num_bytes, vga.vmemwrap - 1)) {
+			PageHandler::WriteBlock(addr, data, width, count);
+			return;
+		}
+		write_delay(count);
+		MarkChanged(start, num_bytes);
+
+		for (uint32_t i = 0; i < num_bytes; i += width) {
+			// The source can be video memory mapped elsewhere, so
+			// take each element before writing it
+			std::array<uint8_t, 4> vals = {};
+			memcpy(vals.data(), data + i, width);
+			for (uint8_t j = 0; j < width; ++j) {
+				WriteBlockByte(start + i + j, vals[j]);
+			}
+		}
+		ReplicateFirstLine(start, num_bytes);
+	}
+
+	void CopyBlock(PhysPt dest, PhysPt src, const uint8_t width,
+	               const uint32_t count) override
+	{
+		const auto dest_start = WriteOffset(dest);
+		const auto src_start  = ReadOffset(src);
+		const auto num_bytes  = width * count;
+		if (!is_contiguous(dest_start, num_bytes, vga.vmemwrap - 1) ||
+		    !is_contiguous(src_start, num_bytes, vga.vmemwrap - 1)) {
+			PageHandler::CopyBlock(dest, src, width, count);
+			return;
+		}
+		read_delay(count);
+		write_delay(count);
+		MarkChanged(dest_start, num_bytes);
+
+		for (uint32_t i = 0; i < num_bytes; i += width) {
+			std::array<uint8_t, 4> vals = {};
+			for (uint8_t j = 0; j < width; ++j) {
+				vals[j] = readHandler_byte(src_start + i + j);
+			}
+			for (uint8_t j = 0; j < width; ++j) {
+				WriteBlockByte(dest_start + i + j, vals[j]);
+			}
+		}
+		ReplicateFirstLine(dest_start, num_bytes);
+	}
 };
 
 class VGA_UnchainedVGA_Handler final : public VGA_UnchainedRead_Handler {
 public:
 	void writeHandler( PhysPt addr, uint8_t val ) {
-		uint32_t data=ModeOperation(val);
-		VgaLatch pixels;
-		pixels.d=((uint32_t*)vga.mem.linear)[addr];
-		pixels.d&=vga.config.full_not_map_mask;
-		pixels.d|=(data & vga.config.full_map_mask);
-		((uint32_t*)vga.mem.linear)[addr]=pixels.d;
+		WritePlanes(addr, val);
 //		if(vga.config.compatible_chain4)
 //			((uint32_t*)vga.mem.linear)[CHECKED2(addr+64*1024)]=pixels.d; 
 	}
 public:
 	VGA_UnchainedVGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKWRITE;
 	}
 
 	void writeb(PhysPt addr, uint8_t val) override
@@ -539,7 +804,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 2 );
+		mark_changed(addr << 2, 4);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 	}
 
@@ -549,7 +814,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 2);
+		mark_changed(addr << 2, 2 * 4);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 	}
@@ -560,12 +825,18 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
-		MEM_CHANGED( addr << 2);
+		mark_changed(addr << 2, 4 * 4);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 		writeHandler(addr+2,(uint8_t)(val >> 16));
 		writeHandler(addr+3,(uint8_t)(val >> 24));
 	}
+
+protected:
+	void PlanesWritten(const PhysPt start, const PhysPt num_bytes) override
+	{
+		mark_changed(start << 2, num_bytes * 4);
+	}
 };
 
 class VGA_TEXT_PageHandler final : public PageHandler {
@@ -662,7 +933,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED( addr );
+		mark_changed(addr, 1);
 		host_writeb(&vga.mem.linear[addr], val);
 	}
 
@@ -672,7 +943,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED(addr);
+		mark_changed(addr, 2);
 		host_writew_at(vga.mem.linear, addr, val);
 	}
 
@@ -682,7 +953,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED(addr);
-		MEM_CHANGED(addr);
+		mark_changed(addr, 4);
 		host_writed_at(vga.mem.linear, addr, val);
 	}
 };
@@ -690,14 +961,14 @@ public:
 class VGA_LIN4_Handler final : public VGA_UnchainedEGA_Handler {
 public:
 	VGA_LIN4_Handler() {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_BLOCKWRITE;
 	}
 	void writeb(PhysPt addr, uint8_t val) override
 	{
 		write_delay();
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
-		MEM_CHANGED( addr << 3 );
+		mark_changed(addr << 3, 8);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 	}
 
@@ -706,7 +977,7 @@ public:
 		write_delay();
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
-		MEM_CHANGED( addr << 3 );
+		mark_changed(addr << 3, 2 * 8);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 	}
@@ -716,7 +987,7 @@ public:
 		write_delay();
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
-		MEM_CHANGED( addr << 3 );
+		mark_changed(addr << 3, 4 * 8);
 		writeHandler(addr+0,(uint8_t)(val >> 0));
 		writeHandler(addr+1,(uint8_t)(val >> 8));
 		writeHandler(addr+2,(uint8_t)(val >> 16));
@@ -750,9 +1021,41 @@ public:
 		                             (readHandler(addr + 2) << 16) |
 		                             (readHandler(addr + 3) << 24));
 	}
+
+protected:
+	PhysPt WriteOffset(const PhysPt addr) override
+	{
+		return vga.svga.bank_write_full +
+		       (PAGING_GetPhysicalAddress(addr) & 0xffff);
+	}
+
+	PhysPt ReadOffset(const PhysPt addr) override
+	{
+		return vga.svga.bank_read_full +
+		       (PAGING_GetPhysicalAddress(addr) & 0xffff);
+	}
 };
 
 
+// The LFB writes straight into the linear video memory, but the drawers of
+// the planar and chain-4 modes read it through other addresses. Mark the
+// pages of each of them, as it's cheaper than telling the modes apart.
+static inline void mark_lfb_changed(const PhysPt addr, const PhysPt num_bytes)
+{
+	const auto last = addr + num_bytes - 1;
+	mark_changed(addr, num_bytes);
+
+	// Planar modes: each group of four bytes expands to eight pixels
+	const auto first_group = addr >> 2;
+	const auto last_group  = last >> 2;
+	mark_changed(first_group << 3, (last_group - first_group + 1) << 3);
+
+	// Chain-4: four bytes of a plane group hold four consecutive addresses
+	const auto first_chained = (addr >> 4) << 2;
+	const auto last_chained  = ((last >> 4) << 2) + 3;
+	mark_changed(first_chained, last_chained - first_chained + 1);
+}
+
 class VGA_LFBChanges_Handler final : public PageHandler {
 public:
 	VGA_LFBChanges_Handler() {
@@ -789,7 +1092,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) - vga.lfb.addr;
 		addr = CHECKED(addr);
 		host_writeb(&vga.mem.linear[addr], val);
-		MEM_CHANGED( addr );
+		mark_lfb_changed(addr, 1);
 	}
 
 	void writew(PhysPt addr, uint16_t val) override
@@ -798,7 +1101,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) - vga.lfb.addr;
 		addr = CHECKED(addr);
 		host_writew_at(vga.mem.linear, addr, val);
-		MEM_CHANGED( addr );
+		mark_lfb_changed(addr, 2);
 	}
 
 	void writed(PhysPt addr, uint32_t val) override
@@ -807,7 +1110,7 @@ public:
 		addr = PAGING_GetPhysicalAddress(addr) - vga.lfb.addr;
 		addr = CHECKED(addr);
 		host_writed_at(vga.mem.linear, addr, val);
-		MEM_CHANGED( addr );
+		mark_lfb_changed(addr, 4);
 	}
 };
 
@@ -975,11 +1278,38 @@ void VGA_ChangedBank(void) {
 	VGA_SetupHandlers();
 }
 
+// The mapped LFB lets the CPU write straight to video memory, so the slower
+// handler that marks the changed pages is used while they're being tracked
+static PageHandler* get_lfb_handler()
+{
+#ifdef VGA_LFB_MAPPED
+	if (!vga.changes.is_tracking) {
+		return &vgaph.lfb;
+	}
+#endif
+	return &vgaph.lfbchanges;
+}
+
+static void update_lfb_handler()
+{
+	// Not set up until the linear window is positioned
+	if (!vga.lfb.handler) {
+		return;
+	}
+	const auto handler = get_lfb_handler();
+	if (vga.lfb.handler != handler) {
+		vga.lfb.handler = handler;
+		MEM_SetLFB(vga.lfb.page, vga.vmemsize / 4096, handler, &vgaph.mmio);
+	}
+}
+
 void VGA_SetupHandlers(void) {
 	vga.svga.bank_read_full = vga.svga.bank_read*vga.svga.bank_size;
 	vga.svga.bank_write_full = vga.svga.bank_write*vga.svga.bank_size;
 
 	PageHandler *newHandler;
+	const auto was_tracking = vga.changes.is_tracking;
+	vga.changes.is_tracking = false;
 	switch (machine) {
 	case MCH_CGA:
 	case MCH_PCJR:
@@ -1078,6 +1408,10 @@ void VGA_SetupHandlers(void) {
 		newHandler = &vgaph.map;
 		break;
 	}
+	// The mapped handler lets the CPU write straight to video memory, so
+	// only the others can keep track of the changed pages
+	vga.changes.is_tracking = (newHandler != &vgaph.map);
+
 	switch ((vga.gfx.miscellaneous >> 2) & 3) {
 	case 0:
 		vgapages.base = VGA_PAGE_A0;
@@ -1114,29 +1448,28 @@ void VGA_SetupHandlers(void) {
 		MEM_SetPageHandler( VGA_PAGE_B0, 8, &vgaph.empty );
 		break;
 	}
-	if(svgaCard == SVGA_S3Trio && (vga.s3.ext_mem_ctrl & 0x10))
+	if(svgaCard == SVGA_S3Trio && (vga.s3.ext_mem_ctrl & 0x10)) {
 		MEM_SetPageHandler(VGA_PAGE_A0, 16, &vgaph.mmio);
+		vga.changes.is_tracking = false;
+	}
 range_done:
+	// Writes made while not tracking left no marks on the pages
+	if (vga.changes.is_tracking && !was_tracking) {
+		vga.changes.needs_full_frame = true;
+	}
+	update_lfb_handler();
 	PAGING_ClearTLB();
 }
 
 void VGA_StartUpdateLFB(void) {
 	vga.lfb.page = vga.s3.la_window << 4;
 	vga.lfb.addr = vga.s3.la_window << 16;
-#ifdef VGA_LFB_MAPPED
-	vga.lfb.handler = &vgaph.lfb;
-#else
-	vga.lfb.handler = &vgaph.lfbchanges;
-#endif
+	vga.lfb.handler = get_lfb_handler();
 	MEM_SetLFB(vga.lfb.page, vga.vmemsize / 4096, vga.lfb.handler, &vgaph.mmio);
 }
 
 static void VGA_Memory_ShutDown(Section * /*sec*/) {
-#ifdef VGA_KEEP_CHANGES
-	delete[] vga.changes.map;
-	vga.mem.linear = {};
-	vga.fastmem    = {};
-#endif
+	vga.changes.pages.clear();
 }
 
 static uint32_t determine_vmem_delay_ns()
@@ -1223,12 +1556,9 @@ void VGA_SetupMemory(Section* sec)
 	// vmemwrap <= vmemsize, fastmem implicitly has mem wrap twice as big
 	vga.vmemwrap = vga.vmemsize;
 
-#ifdef VGA_KEEP_CHANGES
-	memset( &vga.changes, 0, sizeof( vga.changes ));
-	int changesMapSize = (vga.vmemsize >> VGA_CHANGE_SHIFT) + 32;
-	vga.changes.map = new uint8_t[changesMapSize];
-	memset(vga.changes.map, 0, changesMapSize);
-#endif
+	// The pages cover the fast-memory buffer, the larger of the two
+	vga.changes = {};
+	vga.changes.pages.resize((num_fastmem_bytes >> VGA_CHANGE_SHIFT) + 1);
 	vga.svga.bank_read = vga.svga.bank_write = 0;
 	vga.svga.bank_read_full = vga.svga.bank_write_full = 0;
 	vga.svga.bank_size = 0x10000; /* most common bank size is 64K */
@@ -21,6 +21,7 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdio>
@@ -286,6 +287,297 @@ static Bitu GetMixResult(uint32_t mixmode, Bitu srcval, Bitu dstdata)
 	return destval;
 }
 
+// Row-wise fast paths
+// -------------------
+// The drawing commands below go through XGA_GetPoint(), GetMixResult() and
+// XGA_DrawPoint() for every pixel. When a command's rectangles lie entirely
+// within the scissors and video memory, the common mixes (solid fills,
+// copies, XOR and NOT) are applied a row at a time instead. Other mixes,
+// colour compares and clipped rectangles keep the per-pixel path.
+
+struct XGARect {
+	Bits x      = 0; // first pixel, the others follow in the dx/dy direction
+	Bits y      = 0;
+	Bits dx     = 1;
+	Bits dy     = 1;
+	Bitu width  = 0;
+	Bitu height = 0;
+
+	Bits Left() const
+	{
+		return dx > 0 ? x : x - static_cast<Bits>(width) + 1;
+	}
+	Bits Right() const
+	{
+		return Left() + static_cast<Bits>(width) - 1;
+	}
+	Bits Top() const
+	{
+		return dy > 0 ? y : y - static_cast<Bits>(height) + 1;
+	}
+	Bits Bottom() const
+	{
+		return Top() + static_cast<Bits>(height) - 1;
+	}
+
+	bool Intersects(const XGARect& other) const
+	{
+		return Left() <= other.Right() && other.Left() <= Right() &&
+		       Top() <= other.Bottom() && other.Top() <= Bottom();
+	}
+};
+
+// Rows that wrap past the screen width are left to the per-pixel path, so
+// rectangles only share memory where they overlap on screen
+static bool is_in_vmem(const XGARect& rect)
+{
+	size_t pixel_size = 0;
+	switch (XGA_COLOR_MODE) {
+	case M_LIN8: pixel_size = 1; break;
+	case M_LIN15:
+	case M_LIN16: pixel_size = 2; break;
+	case M_LIN32: pixel_size = 4; break;
+	default: return false;
+	}
+	if (rect.Left() < 0 || rect.Top() < 0 || rect.Right() >= XGA_SCREEN_WIDTH) {
+		return false;
+	}
+	const auto last = static_cast<size_t>(rect.Bottom()) * XGA_SCREEN_WIDTH +
+	                  static_cast<size_t>(rect.Right());
+	return (last + 1) * pixel_size <= vga.vmemsize;
+}
+
+static bool is_drawable(const XGARect& rect)
+{
+	// XGA_DrawPoint() ignores commands without these bits
+	if ((xga.curcommand & 0x11) != 0x11) {
+		return false;
+	}
+	return rect.Left() >= xga.scissors.x1 && rect.Right() <= xga.scissors.x2 &&
+	       rect.Top() >= xga.scissors.y1 && rect.Bottom() <= xga.scissors.y2 &&
+	       is_in_vmem(rect);
+}
+
+static bool is_fast_mix(const uint32_t mixmode)
+{
+	switch (mixmode & 0xf) {
+	case 0x00: // not DST
+	case 0x01: // 0 (false)
+	case 0x02: // 1 (true)
+	case 0x03: // DST
+	case 0x04: // not SRC
+	case 0x05: // SRC xor DST
+	case 0x07: // SRC
+		return true;
+	default: return false;
+	}
+}
+
+// Whether a mix reads its source at all
+static bool mix_uses_source(const uint32_t mixmode)
+{
+	return (mixmode & 0xf) >= 0x04;
+}
+
+// Mask applied to the stored pixels, as XGA_DrawPoint() does
+static uint32_t get_store_mask()
+{
+	return XGA_COLOR_MODE == M_LIN15 ? 0x7fff : get_point_mask();
+}
+
+template <typename T>
+static T* get_pixel(const Bits x, const Bits y)
+{
+	return reinterpret_cast<T*>(vga.mem.linear) +
+	       static_cast<size_t>(y) * XGA_SCREEN_WIDTH + static_cast<size_t>(x);
+}
+
+// Mixes a single colour into every pixel of the rectangle; the pixels don't
+// depend on each other, so the walking direction doesn't matter
+template <typename T>
+static void mix_rect_with_color(const XGARect& rect, const uint32_t mixmode,
+                                const Bitu srcval)
+{
+	const auto mask = get_store_mask();
+	const auto fill = static_cast<T>(GetMixResult(mixmode, srcval, 0) & mask);
+
+	for (auto y = rect.Top(); y <= rect.Bottom(); ++y) {
+		T* row = get_pixel<T>(rect.Left(), y);
+		switch (mixmode & 0xf) {
+		case 0x00:
+			for (Bitu i = 0; i < rect.width; ++i) {
+				row[i] = static_cast<T>(~static_cast<uint32_t>(row[i]) & mask);
+			}
+			break;
+		case 0x03:
+			// Only drops the unused bit in 15-bit modes
+			if (mask != get_point_mask()) {
+				for (Bitu i = 0; i < rect.width; ++i) {
+					row[i] = static_cast<T>(row[i] & mask);
+				}
+			}
+			break;
+		case 0x05:
+			for (Bitu i = 0; i < rect.width; ++i) {
+				row[i] = static_cast<T>((srcval ^ row[i]) & mask);
+			}
+			break;
+		default: std::fill_n(row, rect.width, fill); break;
+		}
+	}
+}
+
+// Mixes the source rectangle into the destination. Pixels are visited in the
+// same order as the per-pixel path, so overlapping copies come out the same.
+template <typename T>
+static void mix_rect_with_source(const XGARect& src, const XGARect& dst,
+                                 const uint32_t mixmode)
+{
+	const auto mask      = get_store_mask();
+	const auto full_mask = mask == static_cast<T>(~T{0});
+	const auto width     = static_cast<Bits>(dst.width);
+
+	for (Bitu row = 0; row < dst.height; ++row) {
+		const auto offset = static_cast<Bits>(row) * dst.dy;
+		const T* s        = get_pixel<T>(src.x, src.y + offset);
+		T* d              = get_pixel<T>(dst.x, dst.y + offset);
+
+		switch (mixmode & 0xf) {
+		case 0x04:
+			for (Bits i = 0; i < width; ++i, s += dst.dx, d += dst.dx) {
+				*d = static_cast<T>(~static_cast<uint32_t>(*s) & mask);
+			}
+			break;
+		case 0x05:
+			for (Bits i = 0; i < width; ++i, s += dst.dx, d += dst.dx) {
+				*d = static_cast<T>((*s ^ *d) & mask);
+			}
+			break;
+		case 0x07: {
+			// A copy walking away from its own source behaves as memmove
+			const T* s_left = get_pixel<T>(src.Left(), src.y + offset);
+			T* d_left       = get_pixel<T>(dst.Left(), dst.y + offset);
+			const auto away = (dst.dx > 0) ? d_left <= s_left
+			                               : d_left >= s_left;
+			const auto overlaps = d_left < s_left + width &&
+			                      s_left < d_left + width;
+			if (full_mask && (away || !overlaps)) {
+				std::memmove(d_left, s_left, dst.width * sizeof(T));
+				break;
+			}
+			for (Bits i = 0; i < width; ++i, s += dst.dx, d += dst.dx) {
+				*d = static_cast<T>(*s & mask);
+			}
+			break;
+		}
+		default: assert(false); break;
+		}
+	}
+}
+
+// Mixes an 8x8 pattern into the destination; each row of the pattern is
+// read once, so it mustn't overlap the destination
+template <typename T>
+static void mix_rect_with_pattern(const XGARect& pattern, const XGARect& dst,
+                                  const uint32_t mixmode)
+{
+	const auto mask = get_store_mask();
+
+	for (Bitu row = 0; row < dst.height; ++row) {
+		const auto y = dst.y + static_cast<Bits>(row) * dst.dy;
+
+		T pattern_row[8] = {};
+		for (Bits i = 0; i < 8; ++i) {
+			pattern_row[i] = *get_pixel<T>(pattern.x + i, pattern.y + (y & 0x7));
+		}
+
+		T* d   = get_pixel<T>(dst.x, y);
+		Bits x = dst.x;
+		for (Bitu i = 0; i < dst.width; ++i, x += dst.dx, d += dst.dx) {
+			const uint32_t s = pattern_row[x & 0x7];
+			switch (mixmode & 0xf) {
+			case 0x04: *d = static_cast<T>(~s & mask); break;
+			case 0x05: *d = static_cast<T>((s ^ *d) & mask); break;
+			case 0x07: *d = static_cast<T>(s & mask); break;
+			default: assert(false); break;
+			}
+		}
+	}
+}
+
+// Returns the constant source colour a mix selects, if it selects one
+static bool get_mix_color(const uint32_t mixmode, Bitu& srcval)
+{
+	switch ((mixmode >> 5) & 0x03) {
+	case 0x00: srcval = xga.backcolor; return true;
+	case 0x01: srcval = xga.forecolor; return true;
+	default: return false;
+	}
+}
+
+static bool is_bitmap_source(const uint32_t mixmode)
+{
+	return ((mixmode >> 5) & 0x03) == 0x03;
+}
+
+static bool fast_fill_rect(const XGARect& dst, const uint32_t mixmode)
+{
+	// A bitmap source can be ignored if the mix doesn't read it
+	Bitu srcval = 0;
+	const auto has_source = get_mix_color(mixmode, srcval) ||
+	                        (is_bitmap_source(mixmode) && !mix_uses_source(mixmode));
+	if (!is_fast_mix(mixmode) || !has_source || !is_drawable(dst)) {
+		return false;
+	}
+	switch (XGA_COLOR_MODE) {
+	case M_LIN8: mix_rect_with_color<uint8_t>(dst, mixmode, srcval); break;
+	case M_LIN15:
+	case M_LIN16: mix_rect_with_color<uint16_t>(dst, mixmode, srcval); break;
+	case M_LIN32: mix_rect_with_color<uint32_t>(dst, mixmode, srcval); break;
+	default: return false;
+	}
+	return true;
+}
+
+static bool fast_blit_rect(const XGARect& src, const XGARect& dst,
+                           const uint32_t mixmode)
+{
+	if (!is_bitmap_source(mixmode) || !mix_uses_source(mixmode)) {
+		return fast_fill_rect(dst, mixmode);
+	}
+	if (!is_fast_mix(mixmode) || !is_drawable(dst) || !is_in_vmem(src)) {
+		return false;
+	}
+	switch (XGA_COLOR_MODE) {
+	case M_LIN8: mix_rect_with_source<uint8_t>(src, dst, mixmode); break;
+	case M_LIN15:
+	case M_LIN16: mix_rect_with_source<uint16_t>(src, dst, mixmode); break;
+	case M_LIN32: mix_rect_with_source<uint32_t>(src, dst, mixmode); break;
+	default: return false;
+	}
+	return true;
+}
+
+static bool fast_pattern_rect(const XGARect& pattern, const XGARect& dst,
+                              const uint32_t mixmode)
+{
+	if (!is_bitmap_source(mixmode) || !mix_uses_source(mixmode)) {
+		return fast_fill_rect(dst, mixmode);
+	}
+	if (!is_fast_mix(mixmode) || !is_drawable(dst) || !is_in_vmem(pattern) ||
+	    pattern.Intersects(dst)) {
+		return false;
+	}
+	switch (XGA_COLOR_MODE) {
+	case M_LIN8: mix_rect_with_pattern<uint8_t>(pattern, dst, mixmode); break;
+	case M_LIN15:
+	case M_LIN16: mix_rect_with_pattern<uint16_t>(pattern, dst, mixmode); break;
+	case M_LIN32: mix_rect_with_pattern<uint32_t>(pattern, dst, mixmode); break;
+	default: return false;
+	}
+	return true;
+}
+
 static void XGA_DrawLineVector(const uint32_t val, const bool skip_last_pixel)
 {
 	// No work to do with a zero-length line
@@ -548,6 +840,20 @@ static void XGA_DrawRectangle(const uint32_t val, const bool skip_last_pixel)
 	// one pixel too wide (but don't underflow below zero).
 	const auto xrun = xga.MAPcount - (xga.MAPcount && skip_last_pixel);
 
+	XGARect rect = {};
+	rect.x       = xga.curx;
+	rect.y       = xga.cury;
+	rect.dx      = dx;
+	rect.dy      = dy;
+	rect.width   = static_cast<Bitu>(xrun) + 1;
+	rect.height  = static_cast<Bitu>(xga.MIPcount) + 1;
+
+	if (((xga.pix_cntl >> 6) & 0x3) == 0x00 && fast_fill_rect(rect, xga.foremix)) {
+		xga.curx = static_cast<uint16_t>(rect.x + dx * static_cast<Bits>(rect.width));
+		xga.cury = static_cast<uint16_t>(rect.y + dy * static_cast<Bits>(rect.height));
+		return;
+	}
+
 	for (auto yat = 0; yat <= xga.MIPcount; ++yat) {
 		srcx = xga.curx;
 		for (auto xat = 0; xat <= xrun; ++xat) {
@@ -860,6 +1166,26 @@ void XGA_BlitRect(Bitu val) {
 			break;
 	}
 
+	using namespace bit::literals;
+
+	if (mixselect != 0x3 && bit::cleared(xga.control1, b8)) {
+		XGARect src = {};
+		src.x       = xga.curx;
+		src.y       = xga.cury;
+		src.dx      = dx;
+		src.dy      = dy;
+		src.width   = static_cast<Bitu>(xga.MAPcount) + 1;
+		src.height  = static_cast<Bitu>(xga.MIPcount) + 1;
+
+		XGARect dst = src;
+		dst.x       = xga.destx;
+		dst.y       = xga.desty;
+
+		if (fast_blit_rect(src, dst, mixmode)) {
+			return;
+		}
+	}
+
 	/* Copy source to video ram */
 	srcy = xga.cury;
 	tary = xga.desty;
@@ -920,8 +1246,6 @@ void XGA_BlitRect(Bitu val) {
 			// set with a matching colour or vice-versa (SRC_NE not
 			// set with non-matching colour).
 
-			using namespace bit::literals;
-
 			if (bit::cleared(xga.control1, b8) ||
 			    bit::is(xga.control1, b7) == (srcval == colorcmpdata)) {
 
@@ -974,6 +1298,26 @@ void XGA_DrawPattern(Bitu val) {
 			break;
 	}
 
+	if (mixselect != 0x3) {
+		XGARect pattern = {};
+		pattern.x       = srcx;
+		pattern.y       = srcy;
+		pattern.width   = 8;
+		pattern.height  = 8;
+
+		XGARect dst = {};
+		dst.x       = xga.destx;
+		dst.y       = xga.desty;
+		dst.dx      = dx;
+		dst.dy      = dy;
+		dst.width   = static_cast<Bitu>(xga.MAPcount) + 1;
+		dst.height  = static_cast<Bitu>(xga.MIPcount) + 1;
+
+		if (fast_pattern_rect(pattern, dst, mixmode)) {
+			return;
+		}
+	}
+
 	for(yat=0;yat<=xga.MIPcount;yat++) {
 		tarx = xga.destx;
 		for(xat=0;xat<=xga.MAPcount;xat++) {
@@ -79,11 +79,16 @@
 #include <array>
 #include <atomic>
 #include <cassert>
+#include <cinttypes>
 #include <cmath>
 #include <condition_variable>
 #include <cstdlib>
 #include <cstring>
+#include <map>
 #include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <SDL.h>
 #include <SDL_cpuinfo.h> // for proper SSE defines for MSVC
@@ -103,7 +108,6 @@
 #include "pci_bus.h"
 #include "pic.h"
 #include "render.h"
-#include "semaphore_internal.h"
 #include "setup.h"
 #include "support.h"
 #include "vga.h"
@@ -229,6 +233,72 @@ inline rgb_t rgba_bilinear_filter(rgb_t rgb00, rgb_t rgb01, rgb_t rgb10,
 #endif
 }
 
+/* Expands the four texels of a bilinear sample in one of the direct 16-bit
+   formats (10 = RGB 5-6-5, 11 = ARGB 1-5-5-5, 12 = ARGB 4-4-4-4). With SSE2
+   they are converted together instead of through the 256 KB format tables,
+   which bilinear filtering otherwise scatters four reads a pixel over. */
+inline void lookup_texels16(const rgb_t* lookup, const uint32_t format,
+                            uint32_t& texel0, uint32_t& texel1,
+                            uint32_t& texel2, uint32_t& texel3)
+{
+#if defined(__SSE2__)
+	const __m128i v = _mm_set_epi32(static_cast<int>(texel3),
+	                                static_cast<int>(texel2),
+	                                static_cast<int>(texel1),
+	                                static_cast<int>(texel0));
+	const auto bits = [](const __m128i value, const uint32_t mask) {
+		return _mm_and_si128(value, _mm_set1_epi32(static_cast<int>(mask)));
+	};
+
+	__m128i argb;
+	switch (format) {
+	case 10:
+		argb = _mm_or_si128(
+		        _mm_or_si128(_mm_or_si128(bits(_mm_slli_epi32(v, 8), 0xf80000),
+		                                  bits(_mm_slli_epi32(v, 3), 0x070000)),
+		                     _mm_or_si128(bits(_mm_slli_epi32(v, 5), 0xfc00),
+		                                  bits(_mm_srli_epi32(v, 1), 0x0300))),
+		        _mm_or_si128(_mm_or_si128(bits(_mm_slli_epi32(v, 3), 0xf8),
+		                                  bits(_mm_srli_epi32(v, 2), 0x07)),
+		                     _mm_set1_epi32(static_cast<int>(0xff000000))));
+		break;
+	case 11:
+		argb = _mm_or_si128(
+		        _mm_or_si128(_mm_or_si128(bits(_mm_slli_epi32(v, 9), 0xf80000),
+		                                  bits(_mm_slli_epi32(v, 4), 0x070000)),
+		                     _mm_or_si128(bits(_mm_slli_epi32(v, 6), 0xf800),
+		                                  bits(_mm_slli_epi32(v, 1), 0x0700))),
+		        _mm_or_si128(_mm_or_si128(bits(_mm_slli_epi32(v, 3), 0xf8),
+		                                  bits(_mm_srli_epi32(v, 2), 0x07)),
+		                     bits(_mm_srai_epi32(_mm_slli_epi32(v, 16), 31),
+		                          0xff000000)));
+		break;
+	default:
+		argb = _mm_or_si128(
+		        _mm_or_si128(_mm_or_si128(bits(_mm_slli_epi32(v, 16), 0xf0000000),
+		                                  bits(_mm_slli_epi32(v, 12), 0x0f000000)),
+		                     _mm_or_si128(bits(_mm_slli_epi32(v, 12), 0xf00000),
+		                                  bits(_mm_slli_epi32(v, 8), 0x0f0000))),
+		        _mm_or_si128(_mm_or_si128(bits(_mm_slli_epi32(v, 8), 0xf000),
+		                                  bits(_mm_slli_epi32(v, 4), 0x0f00)),
+		                     _mm_or_si128(bits(_mm_slli_epi32(v, 4), 0xf0),
+		                                  bits(v, 0x0f))));
+		break;
+	}
+	(void)lookup;
+	texel0 = static_cast<uint32_t>(_mm_cvtsi128_si32(argb));
+	texel1 = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(argb, 4)));
+	texel2 = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(argb, 8)));
+	texel3 = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(argb, 12)));
+#else
+	(void)format;
+	texel0 = lookup[texel0];
+	texel1 = lookup[texel1];
+	texel2 = lookup[texel2];
+	texel3 = lookup[texel3];
+#endif
+}
+
 struct poly_vertex
 {
 	float		x;							/* X coordinate */
@@ -255,7 +325,9 @@ enum VoodooModel
 	VOODOO_2,
 };
 
-enum { TRIANGLE_THREADS = 3, TRIANGLE_WORKERS = TRIANGLE_THREADS + 1 };
+/* maximum number of rasterizer threads, and the height of the screen bands */
+/* they take turns on */
+enum { MAX_RASTER_THREADS = 16, RASTER_BAND_HEIGHT = 8 };
 
 /* maximum number of TMUs */
 #define MAX_TMU					2
@@ -889,17 +961,94 @@ struct draw_state {
 	bool screen_update_pending   = false;
 };
 
-struct triangle_worker
+/* iterated values of a triangle, latched when the command is queued */
+struct triangle_setup
 {
-	std::atomic_bool threads_active;
-	bool use_threads, disable_bilinear_filter;
-	uint16_t *drawbuf;
-	poly_vertex v1, v2, v3;
-	int32_t v1y, v3y, totalpix;
-	std::array<std::thread, TRIANGLE_THREADS> threads;
-	std::array<Semaphore, TRIANGLE_THREADS> sembegin;
-	Semaphore semdone;
-	int done_count;
+	int16_t				ax, ay;					/* vertex A x,y (12.4) */
+	int32_t				startr, startg, startb, starta; /* starting R,G,B,A (12.12) */
+	int32_t				startz;					/* starting Z (20.12) */
+	int64_t				startw;					/* starting W (16.32) */
+	int32_t				drdx, dgdx, dbdx, dadx;	/* delta R,G,B,A per X */
+	int32_t				dzdx;					/* delta Z per X */
+	int64_t				dwdx;					/* delta W per X */
+	int32_t				drdy, dgdy, dbdy, dady;	/* delta R,G,B,A per Y */
+	int32_t				dzdy;					/* delta Z per Y */
+	int64_t				dwdy;					/* delta W per Y */
+
+	struct {
+		int64_t			starts, startt;			/* starting S,T (14.18) */
+		int64_t			startw;					/* starting W (2.30) */
+		int64_t			dsdx, dtdx;				/* delta S,T per X */
+		int64_t			dwdx;					/* delta W per X */
+		int64_t			dsdy, dtdy;				/* delta S,T per Y */
+		int64_t			dwdy;					/* delta W per Y */
+		int32_t			lodbase;				/* base LOD of the triangle */
+	} tmu[MAX_TMU];
+};
+
+/* register values that select a rasterizer; when used as a key, they are
+   normalized so bits the span loop doesn't read are ignored */
+struct raster_modes
+{
+	uint32_t			tmus;					/* number of TMUs involved */
+	uint32_t			color_path;				/* fbzColorPath */
+	uint32_t			alpha_mode;				/* alphaMode */
+	uint32_t			fog_mode;				/* fogMode */
+	uint32_t			fbz_mode;				/* fbzMode */
+	uint32_t			tex_mode0, tex_mode1;	/* effective textureMode values */
+
+	auto operator<=>(const raster_modes&) const = default;
+};
+
+struct voodoo_state;
+struct raster_command;
+
+/* draws one scanline of a triangle */
+using rasterizer_func = void (*)(const voodoo_state* vs, const raster_command& cmd,
+                                 int32_t y, const poly_extent* extent,
+                                 stats_block& stats);
+
+enum class raster_command_type { Triangle, FastFill };
+
+/* a triangle or fastfill waiting to be drawn */
+struct raster_command
+{
+	raster_command_type	type;
+	uint16_t *			drawbuf;				/* target RGB buffer */
+
+	/* triangle */
+	poly_vertex			v1, v2, v3;				/* vertices, sorted by Y */
+	int32_t				v1y, v3y;				/* first and last+1 scanline */
+	uint32_t			tmus;					/* number of TMUs involved */
+	uint32_t			texmode0, texmode1;		/* effective textureMode values */
+	rasterizer_func		rasterizer;				/* scanline function for the modes */
+	triangle_setup		setup;
+
+	/* fastfill */
+	int32_t				sx, ex, sy, ey;			/* fill rectangle */
+	uint16_t			dither[16];				/* dithered fill colour */
+};
+
+/* Commands are queued by the emulation thread and drawn in batches by the */
+/* rasterizer threads, each of which owns every Nth band of scanlines, so */
+/* commands touching the same pixels are always drawn in order. The */
+/* rasterizers read the rest of the chip state directly, so the emulation */
+/* thread waits for them with raster_pipeline_sync() before changing it. */
+struct raster_pipeline
+{
+	bool				use_threads, disable_bilinear_filter;
+	bool				threads_active;
+	bool				in_flight;				/* has a batch been handed out since the last sync? */
+	int					num_threads;
+	std::vector<std::thread> threads;
+	std::vector<raster_command> queued;			/* commands being collected */
+	std::vector<raster_command> drawing;		/* commands being drawn */
+	std::mutex			mutex;
+	std::condition_variable work_available;
+	std::condition_variable work_done;
+	uint32_t			generation;				/* bumped for every batch */
+	std::atomic<int>	threads_busy;
+	bool				quit;
 };
 
 struct voodoo_state
@@ -925,8 +1074,13 @@ struct voodoo_state
 	                                                    rasterizers */
 #endif
 
-	stats_block thread_stats[TRIANGLE_WORKERS] = {}; /* per-thread
-	                                                    statistics */
+	stats_block thread_stats[MAX_RASTER_THREADS] = {}; /* per-thread
+	                                                      statistics */
+
+	raster_modes last_raster_modes  = {}; /* modes of the last rasterizer lookup */
+	rasterizer_func last_rasterizer = {}; /* result of the last rasterizer lookup */
+	std::map<raster_modes, uint64_t> raster_profile = {}; /* triangles per
+	                                                         mode combination */
 
 	bool send_config   = {};
 	bool clock_enabled = {};
@@ -942,7 +1096,7 @@ struct voodoo_state
 #endif
 
 	draw_state draw         = {};
-	triangle_worker tworker = {};
+	raster_pipeline pipeline = {};
 };
 
 #ifdef C_ENABLE_VOODOO_OPENGL
@@ -1172,7 +1326,6 @@ inline int64_t float_to_int64(uint32_t data, int fixedbits)
 
 
 
-#ifdef C_ENABLE_VOODOO_OPENGL
 /*************************************
  *
  *  Rasterizer inlines
@@ -1236,6 +1389,7 @@ inline uint32_t normalize_tex_mode(uint32_t eff_tex_mode)
 	return eff_tex_mode;
 }
 
+#ifdef C_ENABLE_VOODOO_OPENGL
 inline uint32_t compute_raster_hash(const raster_info* info)
 {
 	uint32_t hash;
@@ -2061,10 +2215,9 @@ do																				\
 			texel3 = *(uint16_t *)&(TT)->ram[(texbase + 2*(t1 + s1)) & (TT)->mask];\
 			if (TEXMODE_FORMAT(TEXMODE) >= 10 && TEXMODE_FORMAT(TEXMODE) <= 12)	\
 			{																	\
-				texel0 = (LOOKUP)[texel0];										\
-				texel1 = (LOOKUP)[texel1];										\
-				texel2 = (LOOKUP)[texel2];										\
-				texel3 = (LOOKUP)[texel3];										\
+				lookup_texels16((LOOKUP),										\
+				                TEXMODE_FORMAT((TT)->reg[textureMode].u),		\
+				                texel0, texel1, texel2, texel3);				\
 			}																	\
 			else																\
 			{																	\
@@ -3023,6 +3176,7 @@ enum {
  *************************************/
 
 /* drawing */
+static void raster_pipeline_sync(voodoo_state *vs);
 static void Voodoo_UpdateScreenStart();
 static bool Voodoo_GetRetrace();
 static double Voodoo_GetVRetracePosition();
@@ -3035,10 +3189,66 @@ static double Voodoo_GetHRetracePosition();
 static dither_lut_t dither2_lookup = {};
 static dither_lut_t dither4_lookup = {};
 
-static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_t TEXMODE0,
-                                  uint32_t TEXMODE1, void* destbase, int32_t y,
-                                  const poly_extent* extent, stats_block& stats)
+/* The most frequently seen mode combinations, each of which gets its own
+   instantiation of raster_span() with the modes as compile-time constants,
+   so the per-pixel mode decoding folds away. Values are normalized, see
+   select_rasterizer(). Set LOG_RASTERIZERS to log the combinations a game
+   draws with in this format. */
+static constexpr raster_modes specialized_rasterizers[] = {
+        // Gouraud shaded, depth buffered
+        {0, 0x00824100, 0x00000000, 0x00000000, 0x00000739, 0xffffffff, 0xffffffff},
+        // Gouraud shaded, 2D
+        {0, 0x00824100, 0x00000000, 0x00000000, 0x00000301, 0xffffffff, 0xffffffff},
+        // 16-bit texture modulated by iterated colour, depth buffered
+        {1, 0x00482405, 0x00000000, 0x00000000, 0x00000739, 0x08241a01, 0xffffffff},
+        // As above, bilinear filtered
+        {1, 0x00482405, 0x00000000, 0x00000000, 0x00000739, 0x08241a07, 0xffffffff},
+        // As above, 8-bit texture
+        {1, 0x00482405, 0x00000000, 0x00000000, 0x00000739, 0x08241001, 0xffffffff},
+        // As above, alpha blended
+        {1, 0x00482405, 0x00005110, 0x00000000, 0x00000739, 0x08241a01, 0xffffffff},
+        // 16-bit decal texture, depth buffered
+        {1, 0x00000005, 0x00000000, 0x00000000, 0x00000739, 0x08241a01, 0xffffffff},
+        // 16-bit decal texture, 2D
+        {1, 0x00000005, 0x00000000, 0x00000000, 0x00000301, 0x08241a00, 0xffffffff},
+};
+
+/* the live register values, for combinations without a specialized rasterizer */
+struct generic_raster_modes : raster_modes
+{
+	generic_raster_modes(const voodoo_state* vs, const raster_command& cmd)
+	        : raster_modes{cmd.tmus,
+	                       vs->reg[fbzColorPath].u,
+	                       vs->reg[alphaMode].u,
+	                       vs->reg[fogMode].u,
+	                       vs->reg[fbzMode].u,
+	                       cmd.texmode0,
+	                       cmd.texmode1}
+	{}
+};
+
+template <size_t Index>
+struct specialized_raster_modes
 {
+	static constexpr raster_modes modes = specialized_rasterizers[Index];
+
+	static constexpr uint32_t tmus       = modes.tmus;
+	static constexpr uint32_t color_path = modes.color_path;
+	static constexpr uint32_t alpha_mode = modes.alpha_mode;
+	static constexpr uint32_t fog_mode   = modes.fog_mode;
+	static constexpr uint32_t fbz_mode   = modes.fbz_mode;
+	static constexpr uint32_t tex_mode0  = modes.tex_mode0;
+	static constexpr uint32_t tex_mode1  = modes.tex_mode1;
+
+	constexpr specialized_raster_modes(const voodoo_state*, const raster_command&) {}
+};
+
+template <typename Modes>
+static void raster_span(const voodoo_state* vs, const raster_command& cmd,
+                        int32_t y, const poly_extent* extent, stats_block& stats)
+{
+	const Modes modes(vs, cmd);
+
 	const uint8_t* dither_lookup = nullptr;
 	const uint8_t* dither4       = nullptr;
 	const uint8_t* dither        = nullptr;
@@ -3048,15 +3258,20 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 	int32_t stopx = extent->stopx;
 
 	// Quick references
-	const auto regs  = vs->reg;
-	const auto& fbi  = vs->fbi;
-	const auto& tmu0 = vs->tmu[0];
-	const auto& tmu1 = vs->tmu[1];
-
-	const uint32_t r_fbzColorPath = regs[fbzColorPath].u;
-	const uint32_t r_fbzMode      = regs[fbzMode].u;
-	const uint32_t r_alphaMode    = regs[alphaMode].u;
-	const uint32_t r_fogMode      = regs[fogMode].u;
+	const auto regs   = vs->reg;
+	const auto& fbi   = vs->fbi;
+	const auto& tmu0  = vs->tmu[0];
+	const auto& tmu1  = vs->tmu[1];
+	const auto& setup = cmd.setup;
+
+	const uint32_t TMUS     = modes.tmus;
+	const uint32_t TEXMODE0 = modes.tex_mode0;
+	const uint32_t TEXMODE1 = modes.tex_mode1;
+
+	const uint32_t r_fbzColorPath = modes.color_path;
+	const uint32_t r_fbzMode      = modes.fbz_mode;
+	const uint32_t r_alphaMode    = modes.alpha_mode;
+	const uint32_t r_fogMode      = modes.fog_mode;
 	const uint32_t r_zaColor      = regs[zaColor].u;
 
 	uint32_t r_stipple = regs[stipple].u;
@@ -3109,39 +3324,41 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 	}
 
 	/* get pointers to the target buffer and depth buffer */
-	uint16_t* dest  = (uint16_t*)destbase + scry * fbi.rowpixels;
+	uint16_t* dest  = cmd.drawbuf + scry * fbi.rowpixels;
 	uint16_t* depth = (fbi.auxoffs != (uint32_t)(~0))
 	                        ? ((uint16_t*)(fbi.ram + fbi.auxoffs) +
 	                           scry * fbi.rowpixels)
 	                        : nullptr;
 
 	/* compute the starting parameters */
-	const int32_t dx = startx - (fbi.ax >> 4);
-	const int32_t dy = y - (fbi.ay >> 4);
-
-	int32_t iterr = fbi.startr + dy * fbi.drdy + dx * fbi.drdx;
-	int32_t iterg = fbi.startg + dy * fbi.dgdy + dx * fbi.dgdx;
-	int32_t iterb = fbi.startb + dy * fbi.dbdy + dx * fbi.dbdx;
-	int32_t itera = fbi.starta + dy * fbi.dady + dx * fbi.dadx;
-	int32_t iterz = fbi.startz + dy * fbi.dzdy + dx * fbi.dzdx;
-	int64_t iterw = fbi.startw + dy * fbi.dwdy + dx * fbi.dwdx;
+	const int32_t dx = startx - (setup.ax >> 4);
+	const int32_t dy = y - (setup.ay >> 4);
+
+	int32_t iterr = setup.startr + dy * setup.drdy + dx * setup.drdx;
+	int32_t iterg = setup.startg + dy * setup.dgdy + dx * setup.dgdx;
+	int32_t iterb = setup.startb + dy * setup.dbdy + dx * setup.dbdx;
+	int32_t itera = setup.starta + dy * setup.dady + dx * setup.dadx;
+	int32_t iterz = setup.startz + dy * setup.dzdy + dx * setup.dzdx;
+	int64_t iterw = setup.startw + dy * setup.dwdy + dx * setup.dwdx;
 	int64_t iterw0 = 0;
 	int64_t iterw1 = 0;
 	int64_t iters0 = 0;
 	int64_t iters1 = 0;
 	int64_t itert0 = 0;
 	int64_t itert1 = 0;
+	const auto& setup0 = setup.tmu[0];
+	const auto& setup1 = setup.tmu[1];
 	if (TMUS >= 1)
 	{
-		iterw0 = tmu0.startw + dy * tmu0.dwdy + dx * tmu0.dwdx;
-		iters0 = tmu0.starts + dy * tmu0.dsdy + dx * tmu0.dsdx;
-		itert0 = tmu0.startt + dy * tmu0.dtdy + dx * tmu0.dtdx;
+		iterw0 = setup0.startw + dy * setup0.dwdy + dx * setup0.dwdx;
+		iters0 = setup0.starts + dy * setup0.dsdy + dx * setup0.dsdx;
+		itert0 = setup0.startt + dy * setup0.dtdy + dx * setup0.dtdx;
 	}
 	if (TMUS >= 2)
 	{
-		iterw1 = tmu1.startw + dy * tmu1.dwdy + dx * tmu1.dwdx;
-		iters1 = tmu1.starts + dy * tmu1.dsdy + dx * tmu1.dsdx;
-		itert1 = tmu1.startt + dy * tmu1.dtdy + dx * tmu1.dtdx;
+		iterw1 = setup1.startw + dy * setup1.dwdy + dx * setup1.dwdx;
+		iters1 = setup1.starts + dy * setup1.dsdy + dx * setup1.dsdx;
+		itert1 = setup1.startt + dy * setup1.dtdy + dx * setup1.dtdx;
 	}
 
 	/* loop in X */
@@ -3160,7 +3377,7 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 			const tmu_state* const tmus = &vs->tmu[1];
 			const rgb_t* const lookup = tmus->lookup;
 			TEXTURE_PIPELINE(tmus, x, dither4, TEXMODE1, texel,
-								lookup, tmus->lodbasetemp,
+								lookup, setup1.lodbase,
 								iters1, itert1, iterw1, texel);
 		}
 
@@ -3172,7 +3389,7 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 				const tmu_state* const tmus = &tmu0;
 				const rgb_t* const lookup = tmus->lookup;
 				TEXTURE_PIPELINE(tmus, x, dither4, TEXMODE0, texel,
-								lookup, tmus->lodbasetemp,
+								lookup, setup0.lodbase,
 								iters0, itert0, iterw0, texel);
 			} else {	/* send config data to the frame buffer */
 				texel.u=vs->tmu_config;
@@ -3445,6 +3662,92 @@ static inline void raster_generic(const voodoo_state* vs, uint32_t TMUS, uint32_
 	}
 }
 
+template <size_t... Indices>
+static constexpr auto make_specialized_rasterizers(std::index_sequence<Indices...>)
+{
+	return std::array<rasterizer_func, sizeof...(Indices)>{
+	        raster_span<specialized_raster_modes<Indices>>...};
+}
+
+static constexpr auto specialized_rasterizer_funcs = make_specialized_rasterizers(
+        std::make_index_sequence<std::size(specialized_rasterizers)>());
+
+/*-------------------------------------------------
+    select_rasterizer - pick the scanline
+    function for a triangle's modes
+-------------------------------------------------*/
+static rasterizer_func select_rasterizer(voodoo_state *vs, const raster_command& cmd)
+{
+	const auto regs = vs->reg;
+
+	const raster_modes key = {
+	        cmd.tmus,
+	        normalize_color_path(regs[fbzColorPath].u),
+	        normalize_alpha_mode(regs[alphaMode].u),
+	        normalize_fog_mode(regs[fogMode].u),
+	        normalize_fbz_mode(regs[fbzMode].u),
+	        (cmd.tmus >= 1) ? normalize_tex_mode(cmd.texmode0) : 0xffffffff,
+	        (cmd.tmus >= 2) ? normalize_tex_mode(cmd.texmode1) : 0xffffffff};
+
+	if (LOG_RASTERIZERS) {
+		++vs->raster_profile[key];
+	}
+
+	/* the modes rarely change between triangles */
+	if (vs->last_rasterizer && key == vs->last_raster_modes) {
+		return vs->last_rasterizer;
+	}
+
+	rasterizer_func rasterizer = raster_span<generic_raster_modes>;
+	for (size_t i = 0; i < std::size(specialized_rasterizers); ++i) {
+		if (specialized_rasterizers[i] == key) {
+			rasterizer = specialized_rasterizer_funcs[i];
+			break;
+		}
+	}
+
+	vs->last_raster_modes = key;
+	vs->last_rasterizer   = rasterizer;
+	return rasterizer;
+}
+
+/*-------------------------------------------------
+    log_raster_profile - log the most drawn mode
+    combinations as specialized_rasterizers[]
+    entries
+-------------------------------------------------*/
+static void log_raster_profile(const voodoo_state *vs)
+{
+	constexpr size_t MaxLoggedModes = 32;
+
+	std::vector<std::pair<raster_modes, uint64_t>> profile(vs->raster_profile.begin(),
+	                                                      vs->raster_profile.end());
+	std::sort(profile.begin(), profile.end(), [](const auto& a, const auto& b) {
+		return a.second > b.second;
+	});
+	if (profile.size() > MaxLoggedModes) {
+		profile.resize(MaxLoggedModes);
+	}
+
+	for (const auto& [modes, triangles] : profile) {
+		const auto is_specialized = std::find(std::begin(specialized_rasterizers),
+		                                      std::end(specialized_rasterizers),
+		                                      modes) !=
+		                            std::end(specialized_rasterizers);
+
+		LOG_MSG("VOODOO: {%u, 0x%08x, 0x%08x, 0x%08x, 0x%08x, 0x%08x, 0x%08x}, // %" PRIu64 " triangles%s",
+		        modes.tmus,
+		        modes.color_path,
+		        modes.alpha_mode,
+		        modes.fog_mode,
+		        modes.fbz_mode,
+		        modes.tex_mode0,
+		        modes.tex_mode1,
+		        triangles,
+		        is_specialized ? ", specialized" : "");
+	}
+}
+
 #ifdef C_ENABLE_VOODOO_OPENGL
 /*-------------------------------------------------
     add_rasterizer - add a rasterizer to our
@@ -4281,6 +4584,8 @@ static void accumulate_statistics(voodoo_state *vs, const stats_block *stats)
 
 static void update_statistics(voodoo_state *vs, bool accumulate)
 {
+	raster_pipeline_sync(vs);
+
 	/* accumulate/reset statistics from all units */
 	for (auto& thread_stat : vs->thread_stats) {
 		if (accumulate) {
@@ -4302,32 +4607,19 @@ static void update_statistics(voodoo_state *vs, bool accumulate)
     COMMAND HANDLERS
 ***************************************************************************/
 
-static void triangle_worker_work(triangle_worker& tworker, int32_t worktstart, int32_t worktend)
+static inline bool raster_band_owned(const int32_t y, const int thread_index, const int num_threads)
 {
-	/* determine the number of TMUs involved */
-	uint32_t tmus     = 0;
-	uint32_t texmode0 = 0;
-	uint32_t texmode1 = 0;
-	if (!FBIINIT3_DISABLE_TMUS(v->reg[fbiInit3].u) && FBZCP_TEXTURE_ENABLE(v->reg[fbzColorPath].u))
-	{
-		tmus = 1;
-		texmode0 = v->tmu[0].reg[textureMode].u;
-		if ((v->chipmask & 0x04) != 0)
-		{
-			tmus = 2;
-			texmode1 = v->tmu[1].reg[textureMode].u;
-		}
-		if (tworker.disable_bilinear_filter) //force disable bilinear filter
-		{
-			texmode0 &= ~6;
-			texmode1 &= ~6;
-		}
-	}
+	return (y / RASTER_BAND_HEIGHT) % num_threads == thread_index;
+}
 
+static void raster_triangle(const voodoo_state *vs, const raster_command& cmd,
+                            const int thread_index, const int num_threads,
+                            stats_block& stats)
+{
 	/* compute the slopes for each portion of the triangle */
-	const poly_vertex v1 = tworker.v1;
-	const poly_vertex v2 = tworker.v2;
-	const poly_vertex v3 = tworker.v3;
+	const poly_vertex& v1 = cmd.v1;
+	const poly_vertex& v2 = cmd.v2;
+	const poly_vertex& v3 = cmd.v3;
 
 	const float dxdy_v1v2 = (v2.y == v1.y) ? 0.0f
 	                                       : (v2.x - v1.x) / (v2.y - v1.y);
@@ -4336,14 +4628,10 @@ static void triangle_worker_work(triangle_worker& tworker, int32_t worktstart, i
 	const float dxdy_v2v3 = (v3.y == v2.y) ? 0.0f
 	                                       : (v3.x - v2.x) / (v3.y - v2.y);
 
-	stats_block my_stats = {};
-
-	const int32_t from = tworker.totalpix * worktstart / TRIANGLE_WORKERS;
-	const int32_t to   = tworker.totalpix * worktend / TRIANGLE_WORKERS;
-
-	for (int32_t curscan = tworker.v1y, scanend = tworker.v3y, sumpix = 0, lastsum = 0;
-	     curscan != scanend && lastsum < to;
-	     lastsum = sumpix, curscan++) {
+	for (int32_t curscan = cmd.v1y; curscan != cmd.v3y; curscan++) {
+		if (!raster_band_owned(curscan, thread_index, num_threads)) {
+			continue;
+		}
 
 		const float fully = (float)(curscan) + 0.5f;
 
@@ -4368,125 +4656,176 @@ static void triangle_worker_work(triangle_worker& tworker, int32_t worktstart, i
 			std::swap(extent.startx, extent.stopx);
 		}
 
-		sumpix += (extent.stopx - extent.startx);
+		cmd.rasterizer(vs, cmd, curscan, &extent, stats);
+	}
+}
 
-		if (sumpix <= from) {
-			continue;
-		}
-		if (lastsum < from) {
-			extent.startx += (from - lastsum);
-		}
-		if (sumpix > to) {
-			extent.stopx -= (sumpix - to);
+static void raster_command_fastfill(const raster_command& cmd, const int thread_index,
+                                    const int num_threads)
+{
+	poly_extent extent = {};
+	extent.startx = std::min(cmd.sx, cmd.ex);
+	extent.stopx  = std::max(cmd.sx, cmd.ex);
+
+	for (int32_t curscan = cmd.sy; curscan < cmd.ey; curscan++) {
+		if (raster_band_owned(curscan, thread_index, num_threads)) {
+			raster_fastfill(cmd.drawbuf, curscan, &extent, cmd.dither);
 		}
+	}
+}
 
-		raster_generic(v, tmus, texmode0, texmode1, tworker.drawbuf, curscan, &extent, my_stats);
+static void raster_command_run(const voodoo_state *vs, const raster_command& cmd,
+                               const int thread_index, const int num_threads,
+                               stats_block& stats)
+{
+	switch (cmd.type) {
+	case raster_command_type::Triangle:
+		raster_triangle(vs, cmd, thread_index, num_threads, stats);
+		break;
+	case raster_command_type::FastFill:
+		raster_command_fastfill(cmd, thread_index, num_threads);
+		break;
 	}
-	sum_statistics(&v->thread_stats[worktstart], &my_stats);
 }
 
-static int triangle_worker_thread_func(int32_t p)
+static void raster_thread_func(voodoo_state *vs, const int thread_index)
 {
-	triangle_worker& tworker = v->tworker;
-	for (const int32_t tnum = p; tworker.threads_active;) {
-		tworker.sembegin[tnum].wait();
-		if (tworker.threads_active) {
-			triangle_worker_work(tworker, tnum, tnum + 1);
+	auto& pipeline = vs->pipeline;
+
+	uint32_t generation = 0;
+	for (;;) {
+		{
+			std::unique_lock lock(pipeline.mutex);
+			pipeline.work_available.wait(lock, [&] {
+				return pipeline.quit || pipeline.generation != generation;
+			});
+			if (pipeline.quit) {
+				return;
+			}
+			generation = pipeline.generation;
+		}
+
+		stats_block stats = {};
+		for (const auto& cmd : pipeline.drawing) {
+			raster_command_run(vs, cmd, thread_index, pipeline.num_threads, stats);
+		}
+		sum_statistics(&vs->thread_stats[thread_index], &stats);
+
+		std::lock_guard lock(pipeline.mutex);
+		if (--pipeline.threads_busy == 0) {
+			pipeline.work_done.notify_one();
 		}
-		tworker.semdone.notify();
 	}
-	return 0;
 }
 
-static void triangle_worker_shutdown(triangle_worker& tworker)
+static void raster_pipeline_start(voodoo_state *vs)
 {
-	if (!tworker.threads_active) {
-		return;
-	}
-	tworker.threads_active = false;
-	for (size_t i = 0; i != TRIANGLE_THREADS; i++) {
-		tworker.sembegin[i].notify();
-	}
+	auto& pipeline = vs->pipeline;
 
-	for (size_t i = 0; i != TRIANGLE_THREADS; i++) {
-		tworker.semdone.wait();
+	// Leave one core to the emulation thread
+	const auto num_cpus = static_cast<int>(std::thread::hardware_concurrency());
+	if (!pipeline.use_threads || num_cpus < 2) {
+		pipeline.use_threads = false;
+		return;
 	}
+	pipeline.num_threads = std::clamp(num_cpus - 1, 1, static_cast<int>(MAX_RASTER_THREADS));
 
-	for (auto& thread : tworker.threads) {
-		if (thread.joinable()) {
-			thread.join();
-		}
+	pipeline.quit         = false;
+	pipeline.generation   = 0;
+	pipeline.threads_busy = 0;
+	for (int i = 0; i < pipeline.num_threads; ++i) {
+		pipeline.threads.emplace_back(raster_thread_func, vs, i);
+		set_thread_name(pipeline.threads.back(), "dosbox:voodoo");
 	}
+	pipeline.threads_active = true;
 }
 
-static void triangle_worker_run(triangle_worker& tworker)
+/* hand the queued commands to the rasterizer threads; with wait_for_idle */
+/* false, this only happens if they're done with the previous batch */
+static void raster_pipeline_submit(voodoo_state *vs, const bool wait_for_idle)
 {
-	if (!tworker.use_threads)
-	{
-		// do not use threaded calculation
-		tworker.totalpix = 0xFFFFFFF;
-		triangle_worker_work(tworker, 0, TRIANGLE_WORKERS);
+	auto& pipeline = vs->pipeline;
+	if (pipeline.queued.empty()) {
+		return;
+	}
+	if (!wait_for_idle && pipeline.threads_busy > 0) {
 		return;
 	}
 
-	/* compute the slopes for each portion of the triangle */
-	const poly_vertex v1 = tworker.v1;
-	const poly_vertex v2 = tworker.v2;
-	const poly_vertex v3 = tworker.v3;
+	std::unique_lock lock(pipeline.mutex);
+	pipeline.work_done.wait(lock, [&] { return pipeline.threads_busy == 0; });
 
-	const float dxdy_v1v2 = (v2.y == v1.y) ? 0.0f
-	                                       : (v2.x - v1.x) / (v2.y - v1.y);
-	const float dxdy_v1v3 = (v3.y == v1.y) ? 0.0f
-	                                       : (v3.x - v1.x) / (v3.y - v1.y);
-	const float dxdy_v2v3 = (v3.y == v2.y) ? 0.0f
-	                                       : (v3.x - v2.x) / (v3.y - v2.y);
+	std::swap(pipeline.queued, pipeline.drawing);
+	pipeline.queued.clear();
+	pipeline.threads_busy = pipeline.num_threads;
+	++pipeline.generation;
+	pipeline.in_flight = true;
 
-	int32_t pixsum = 0;
-	for (int32_t curscan = tworker.v1y, scanend = tworker.v3y; curscan != scanend; curscan++)
-	{
-		const float fully  = (float)(curscan) + 0.5f;
-		const float startx = v1.x + (fully - v1.y) * dxdy_v1v3;
+	lock.unlock();
+	pipeline.work_available.notify_all();
+}
 
-		/* compute the ending X based on which part of the triangle we're in */
-		const float stopx = (fully < v2.y
-		                             ? (v1.x + (fully - v1.y) * dxdy_v1v2)
-		                             : (v2.x + (fully - v2.y) * dxdy_v2v3));
+/* wait until all queued commands have been drawn */
+static void raster_pipeline_sync(voodoo_state *vs)
+{
+	auto& pipeline = vs->pipeline;
+	if (!pipeline.in_flight && pipeline.queued.empty()) {
+		return;
+	}
+	raster_pipeline_submit(vs, true);
 
-		/* clamp to full pixels */
-		const int32_t istartx = round_coordinate(startx);
-		const int32_t istopx  = round_coordinate(stopx);
+	std::unique_lock lock(pipeline.mutex);
+	pipeline.work_done.wait(lock, [&] { return pipeline.threads_busy == 0; });
+	pipeline.in_flight = false;
+}
 
-		/* force start < stop */
-		pixsum += (istartx > istopx ? istartx - istopx : istopx - istartx);
+static void raster_pipeline_queue(voodoo_state *vs, const raster_command& cmd)
+{
+	auto& pipeline = vs->pipeline;
+	if (!pipeline.threads_active && pipeline.use_threads) {
+		raster_pipeline_start(vs);
 	}
-	tworker.totalpix = pixsum;
-
-	// Don't wake up threads for just a few pixels
-	if (tworker.totalpix <= 200)
-	{
-		triangle_worker_work(tworker, 0, TRIANGLE_WORKERS);
+	if (!pipeline.threads_active) {
+		// draw right away
+		stats_block stats = {};
+		raster_command_run(vs, cmd, 0, 1, stats);
+		sum_statistics(&vs->thread_stats[0], &stats);
 		return;
 	}
 
-	if (!tworker.threads_active)
-	{
-		tworker.threads_active = true;
+	// Large batches keep the threads busy; smaller ones are only handed
+	// out while the threads are idle so they don't wait for work
+	constexpr size_t MinBatchSize = 16;
+	constexpr size_t MaxBatchSize = 1024;
 
-		int worker_id = 0;
-		for (auto& triangle_worker : tworker.threads) {
-			triangle_worker = std::thread([worker_id] {
-				triangle_worker_thread_func(worker_id);
-			});
-			++worker_id;
-		}
+	pipeline.queued.push_back(cmd);
+	if (pipeline.queued.size() >= MaxBatchSize) {
+		raster_pipeline_submit(vs, true);
+	} else if (pipeline.queued.size() >= MinBatchSize) {
+		raster_pipeline_submit(vs, false);
+	}
+}
+
+static void raster_pipeline_shutdown(voodoo_state *vs)
+{
+	auto& pipeline = vs->pipeline;
+	if (!pipeline.threads_active) {
+		return;
 	}
-	for (auto& begin_semaphore : tworker.sembegin) {
-		begin_semaphore.notify();
+	raster_pipeline_sync(vs);
+	{
+		std::lock_guard lock(pipeline.mutex);
+		pipeline.quit = true;
 	}
-	triangle_worker_work(tworker, TRIANGLE_THREADS, TRIANGLE_WORKERS);
-	for (size_t i = 0; i != TRIANGLE_THREADS; i++) {
-		tworker.semdone.wait();
+	pipeline.work_available.notify_all();
+
+	for (auto& thread : pipeline.threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
 	}
+	pipeline.threads.clear();
+	pipeline.threads_active = false;
 }
 
 /*-------------------------------------------------
@@ -4691,12 +5030,67 @@ static void triangle(voodoo_state *vs)
 		}
 	}
 
-	triangle_worker& tworker = vs->tworker;
-	tworker.v1 = *v1, tworker.v2 = *v2, tworker.v3 = *v3;
-	tworker.drawbuf = drawbuf;
-	tworker.v1y = v1y;
-	tworker.v3y = v3y;
-	triangle_worker_run(tworker);
+	raster_command cmd = {};
+	cmd.type    = raster_command_type::Triangle;
+	cmd.drawbuf = drawbuf;
+	cmd.v1      = *v1;
+	cmd.v2      = *v2;
+	cmd.v3      = *v3;
+	cmd.v1y     = v1y;
+	cmd.v3y     = v3y;
+
+	cmd.tmus = static_cast<uint32_t>(texcount);
+	if (texcount >= 1) {
+		cmd.texmode0 = tmu0.reg[textureMode].u;
+		if (texcount >= 2) {
+			cmd.texmode1 = tmu1.reg[textureMode].u;
+		}
+		if (vs->pipeline.disable_bilinear_filter) {
+			// force disable bilinear filter
+			cmd.texmode0 &= ~6;
+			cmd.texmode1 &= ~6;
+		}
+	}
+	cmd.rasterizer = select_rasterizer(vs, cmd);
+
+	auto& setup  = cmd.setup;
+	setup.ax     = fbi.ax;
+	setup.ay     = fbi.ay;
+	setup.startr = fbi.startr;
+	setup.startg = fbi.startg;
+	setup.startb = fbi.startb;
+	setup.starta = fbi.starta;
+	setup.startz = fbi.startz;
+	setup.startw = fbi.startw;
+	setup.drdx   = fbi.drdx;
+	setup.dgdx   = fbi.dgdx;
+	setup.dbdx   = fbi.dbdx;
+	setup.dadx   = fbi.dadx;
+	setup.dzdx   = fbi.dzdx;
+	setup.dwdx   = fbi.dwdx;
+	setup.drdy   = fbi.drdy;
+	setup.dgdy   = fbi.dgdy;
+	setup.dbdy   = fbi.dbdy;
+	setup.dady   = fbi.dady;
+	setup.dzdy   = fbi.dzdy;
+	setup.dwdy   = fbi.dwdy;
+
+	for (int i = 0; i < texcount; ++i) {
+		const auto& tmu = vs->tmu[i];
+		auto& tmu_setup = setup.tmu[i];
+
+		tmu_setup.starts  = tmu.starts;
+		tmu_setup.startt  = tmu.startt;
+		tmu_setup.startw  = tmu.startw;
+		tmu_setup.dsdx    = tmu.dsdx;
+		tmu_setup.dtdx    = tmu.dtdx;
+		tmu_setup.dwdx    = tmu.dwdx;
+		tmu_setup.dsdy    = tmu.dsdy;
+		tmu_setup.dtdy    = tmu.dtdy;
+		tmu_setup.dwdy    = tmu.dwdy;
+		tmu_setup.lodbase = tmu.lodbasetemp;
+	}
+	raster_pipeline_queue(vs, cmd);
 
 	/* update stats */
 	regs[fbiTrianglesOut].u++;
@@ -4965,10 +5359,8 @@ static void fastfill(voodoo_state *vs)
 	const int sy = (regs[clipLowYHighY].u >> 16) & 0x3ff;
 	const int ey = (regs[clipLowYHighY].u >> 0) & 0x3ff;
 
-	poly_extent extents[64] = {};
-
-	// Align to 64-bit because that's the maximum type written
-	alignas(sizeof(uint64_t)) static uint16_t dithermatrix[16] = {};
+	raster_command cmd = {};
+	cmd.type = raster_command_type::FastFill;
 
 	uint16_t* drawbuf = nullptr;
 	int x;
@@ -5014,21 +5406,11 @@ static void fastfill(voodoo_state *vs)
 				int b = regs[color1].rgb.b;
 
 				APPLY_DITHER(regs[fbzMode].u, x, dither_lookup, r, g, b);
-				dithermatrix[y*4 + x] = (uint16_t)((r << 11) | (g << 5) | b);
+				cmd.dither[y*4 + x] = (uint16_t)((r << 11) | (g << 5) | b);
 			}
 		}
 	}
 
-	/* fill in a block of extents */
-	extents[0].startx = sx;
-	extents[0].stopx = ex;
-
-	constexpr auto num_extents = static_cast<int>(ARRAY_LEN(extents));
-
-	for (auto extnum = 1; extnum < num_extents; ++extnum) {
-		extents[extnum] = extents[0];
-	}
-
 #ifdef C_ENABLE_VOODOO_OPENGL
 	if (vs->ogl && vs->active) {
 		voodoo_ogl_fastfill();
@@ -5036,34 +5418,16 @@ static void fastfill(voodoo_state *vs)
 	}
 #endif
 
-	/* iterate over blocks of extents */
-	for (y = sy; y < ey; y += num_extents) {
-		const auto count = std::min<int>(ey - y, num_extents);
-		void *dest = drawbuf;
-
-		const int startscanline = y;
-		const int numscanlines  = count;
-
-		const int32_t v1yclip = startscanline;
-		const int32_t v3yclip = startscanline + numscanlines;
-
-		if (v3yclip - v1yclip <= 0) {
-			return;
-		}
-
-		for (int32_t curscan = v1yclip; curscan < v3yclip; curscan++)
-		{
-			auto extent = &extents[curscan - startscanline];
-
-			/* force start < stop */
-			if (extent->startx > extent->stopx) {
-				std::swap(extent->startx, extent->stopx);
-			}
-
-			/* set the extent and update the total pixel count */
-			raster_fastfill(dest,curscan,extent,dithermatrix);
-		}
+	if (ey <= sy) {
+		return;
 	}
+
+	cmd.drawbuf = drawbuf;
+	cmd.sx      = sx;
+	cmd.ex      = ex;
+	cmd.sy      = sy;
+	cmd.ey      = ey;
+	raster_pipeline_queue(vs, cmd);
 }
 
 /*-------------------------------------------------
@@ -5072,6 +5436,8 @@ static void fastfill(voodoo_state *vs)
 -------------------------------------------------*/
 static void swapbuffer(voodoo_state *vs, uint32_t data)
 {
+	raster_pipeline_sync(vs);
+
 	/* set the don't swap value for Voodoo 2 */
 	vs->fbi.vblank_dont_swap = ((data >> 9) & 1)>0;
 
@@ -5109,6 +5475,35 @@ static void soft_reset(voodoo_state *vs)
  *  Voodoo register writes
  *
  *************************************/
+/* Writes that only feed triangle setup, or that leave the drawing state */
+/* unchanged, don't need to wait for the queued commands to be drawn */
+static bool is_raster_setup_write(const uint8_t regnum, const uint32_t data)
+{
+	if ((regnum >= vertexAx && regnum <= ftriangleCMD) ||
+	    (regnum >= sSetupMode && regnum <= sBeginTriCMD) ||
+	    regnum == fastfillCMD) {
+		return true;
+	}
+	switch (regnum) {
+	case fbzColorPath:
+	case fogMode:
+	case alphaMode:
+	case fbzMode:
+	case stipple:
+	case color0:
+	case color1:
+	case zaColor:
+	case chromaKey:
+	case chromaRange:
+	case fogColor:
+	case clipLeftRight:
+	case clipLowYHighY:
+		return v->reg[regnum].u == data;
+	default:
+		return false;
+	}
+}
+
 static void register_w(uint32_t offset, uint32_t data)
 {
 	auto chips = check_cast<uint8_t>((offset >> 8) & 0xf);
@@ -5139,6 +5534,11 @@ static void register_w(uint32_t offset, uint32_t data)
 		return;
 	}
 
+	/* only triangle setup can go ahead of the queued commands */
+	if (!is_raster_setup_write(regnum, data)) {
+		raster_pipeline_sync(v);
+	}
+
 	/* switch off the register */
 	switch (regnum)
 	{
@@ -6956,16 +7356,21 @@ static void voodoo_w(const uint32_t addr, const uint32_t data, const uint32_t ma
 	if ((offset & offset_base) == 0) {
 		register_w(offset, data);
 	} else if ((offset & lfb_base) == 0) {
+		raster_pipeline_sync(v);
 		lfb_w(offset, data, mask);
 	} else {
+		raster_pipeline_sync(v);
 		texture_w(offset, data);
 	}
 }
 
-static constexpr uint32_t voodoo_r(const uint32_t addr)
+static uint32_t voodoo_r(const uint32_t addr)
 {
 	const auto offset = (addr >> 2) & offset_mask;
 
+	// Status polls and LFB reads see everything drawn so far
+	raster_pipeline_sync(v);
+
 	if ((offset & offset_base) == 0) {
 		return register_r(offset);
 	}
@@ -7219,6 +7624,7 @@ static void Voodoo_VerticalTimer(uint32_t /*val*/)
 		if (!RENDER_StartUpdate()) {
 			return; // frameskip
 		}
+		raster_pipeline_sync(v);
 
 #ifdef C_ENABLE_VOODOO_DEBUG
 		rectangle r;
@@ -7723,7 +8129,11 @@ static void voodoo_shutdown()
 #endif
 
 	v->active = false;
-	triangle_worker_shutdown(v->tworker);
+	raster_pipeline_shutdown(v);
+
+	if (LOG_RASTERIZERS) {
+		log_raster_profile(v);
+	}
 
 	delete v;
 	v = nullptr;
@@ -7741,8 +8151,8 @@ static void Voodoo_Startup() {
 
 	v->draw = {};
 
-	v->tworker.use_threads = voodoo_multithreading;
-	v->tworker.disable_bilinear_filter = (voodoo_bilinear_filtering == false);
+	v->pipeline.use_threads = voodoo_multithreading;
+	v->pipeline.disable_bilinear_filter = (voodoo_bilinear_filtering == false);
 
 	// Switch the pagehandler now that v has been allocated and is in use
 	voodoo_pagehandler = &voodoo_real_pagehandler;
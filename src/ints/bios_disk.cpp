@@ -20,7 +20,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <limits>
 #include <utility>
+#include <vector>
+
+#if defined(HAVE_MMAP)
+#include <sys/mman.h>
+#endif
 
 #include "callback.h"
 #include "regs.h"
@@ -156,17 +162,82 @@ void swapInNextDisk(bool pressed) {
 }
 
 
-uint8_t imageDisk::Read_Sector(uint32_t head,uint32_t cylinder,uint32_t sector,void * data) {
-	uint32_t sectnum;
+// The FAT drives mounted from the given image
+static std::vector<std::shared_ptr<fatDrive>> get_fat_drives(const std::shared_ptr<imageDisk>& disk)
+{
+	std::vector<std::shared_ptr<fatDrive>> fat_drives = {};
+	for (const auto& drive : Drives) {
+		auto fat_drive = std::dynamic_pointer_cast<fatDrive>(drive);
+		if (fat_drive && fat_drive->loadedDisk == disk) {
+			fat_drives.push_back(std::move(fat_drive));
+		}
+	}
+	return fat_drives;
+}
 
-	sectnum = ( (cylinder * heads + head) * sectors ) + sector - 1L;
+uint8_t BIOS_ReadDiskSectors(const std::shared_ptr<imageDisk>& disk,
+                             const uint32_t head, const uint32_t cylinder,
+                             const uint32_t sector, const uint32_t num_sectors,
+                             void* data)
+{
+	for (const auto& fat_drive : get_fat_drives(disk)) {
+		fat_drive->flushFat();
+	}
+	return disk->Read_Sectors(head, cylinder, sector, num_sectors, data);
+}
 
-	return Read_AbsoluteSector(sectnum, data);
+uint8_t BIOS_WriteDiskSectors(const std::shared_ptr<imageDisk>& disk,
+                              const uint32_t head, const uint32_t cylinder,
+                              const uint32_t sector, const uint32_t num_sectors,
+                              const void* data)
+{
+	// Pending FAT changes would otherwise overwrite the new sectors later
+	const auto fat_drives = get_fat_drives(disk);
+	for (const auto& fat_drive : fat_drives) {
+		fat_drive->flushFat();
+	}
+	const auto status = disk->Write_Sectors(head, cylinder, sector, num_sectors, data);
+
+	const uint32_t first = ((cylinder * disk->heads + head) * disk->sectors) +
+	                       sector - 1;
+	for (const auto& fat_drive : fat_drives) {
+		for (auto sectnum = first; sectnum < first + num_sectors; ++sectnum) {
+			if (fat_drive->isFatSector(sectnum)) {
+				fat_drive->reloadFat();
+				break;
+			}
+		}
+	}
+	return status;
+}
+
+uint8_t imageDisk::Read_Sector(uint32_t head,uint32_t cylinder,uint32_t sector,void * data) {
+	return Read_Sectors(head, cylinder, sector, 1, data);
+}
+
+uint8_t imageDisk::Read_Sectors(const uint32_t head, const uint32_t cylinder,
+                                const uint32_t sector,
+                                const uint32_t num_sectors, void* data)
+{
+	const uint32_t sectnum = ((cylinder * heads + head) * sectors) + sector - 1L;
+	return Read_AbsoluteSectors(sectnum, num_sectors, data);
 }
 
 uint8_t imageDisk::Read_AbsoluteSector(uint32_t sectnum, void *data)
 {
-	const auto bytenum = check_cast<cross_off_t>(sectnum) * sector_size;
+	return Read_AbsoluteSectors(sectnum, 1, data);
+}
+
+uint8_t imageDisk::Read_AbsoluteSectors(const uint32_t sectnum,
+                                        const uint32_t num_sectors, void* data)
+{
+	const auto bytenum   = check_cast<cross_off_t>(sectnum) * sector_size;
+	const auto num_bytes = static_cast<size_t>(num_sectors) * sector_size;
+
+	if (mapped_image && static_cast<size_t>(bytenum) + num_bytes <= mapped_size) {
+		memcpy(data, mapped_image + bytenum, num_bytes);
+		return 0x00;
+	}
 
 	if (last_action == WRITE || bytenum != current_fpos) {
 		if (cross_fseeko(diskimg, bytenum, SEEK_SET) != 0) {
@@ -175,7 +246,7 @@ uint8_t imageDisk::Read_AbsoluteSector(uint32_t sectnum, void *data)
 			return 0xff;
 		}
 	}
-	size_t ret = fread(data, 1, sector_size, diskimg);
+	size_t ret = fread(data, 1, num_bytes, diskimg);
 	current_fpos=bytenum+ret;
 	last_action=READ;
 
@@ -183,19 +254,37 @@ uint8_t imageDisk::Read_AbsoluteSector(uint32_t sectnum, void *data)
 }
 
 uint8_t imageDisk::Write_Sector(uint32_t head,uint32_t cylinder,uint32_t sector,void * data) {
-	uint32_t sectnum;
-
-	sectnum = ( (cylinder * heads + head) * sectors ) + sector - 1L;
-
-	return Write_AbsoluteSector(sectnum, data);
+	return Write_Sectors(head, cylinder, sector, 1, data);
 }
 
+uint8_t imageDisk::Write_Sectors(const uint32_t head, const uint32_t cylinder,
+                                 const uint32_t sector,
+                                 const uint32_t num_sectors, const void* data)
+{
+	const uint32_t sectnum = ((cylinder * heads + head) * sectors) + sector - 1L;
+	return Write_AbsoluteSectors(sectnum, num_sectors, data);
+}
 
 uint8_t imageDisk::Write_AbsoluteSector(uint32_t sectnum, void *data) {
-	const auto bytenum = check_cast<cross_off_t>(sectnum) * sector_size;
+	return Write_AbsoluteSectors(sectnum, 1, data);
+}
+
+uint8_t imageDisk::Write_AbsoluteSectors(const uint32_t sectnum,
+                                         const uint32_t num_sectors,
+                                         const void* data)
+{
+	const auto bytenum   = check_cast<cross_off_t>(sectnum) * sector_size;
+	const auto num_bytes = static_cast<size_t>(num_sectors) * sector_size;
 
 	//LOG_MSG("Writing sectors to %ld at bytenum %d", sectnum, bytenum);
 
+	if (is_mapped_writable &&
+	    static_cast<size_t>(bytenum) + num_bytes <= mapped_size) {
+		memcpy(mapped_image + bytenum, data, num_bytes);
+		has_mapped_writes = true;
+		return 0x00;
+	}
+
 	if (last_action == READ || bytenum != current_fpos) {
 		if (cross_fseeko(diskimg, bytenum, SEEK_SET) != 0) {
 			LOG_ERR("BIOSDISK: Could not seek to byte %lld in file '%s': %s",
@@ -205,7 +294,7 @@ uint8_t imageDisk::Write_AbsoluteSector(uint32_t sectnum, void *data) {
 			return 0xff;
 		}
 	}
-	size_t ret = fwrite(data, 1, sector_size, diskimg);
+	size_t ret = fwrite(data, 1, num_bytes, diskimg);
 	current_fpos=bytenum+ret;
 	last_action=WRITE;
 
@@ -213,6 +302,64 @@ uint8_t imageDisk::Write_AbsoluteSector(uint32_t sectnum, void *data) {
 
 }
 
+void imageDisk::MapImage()
+{
+#if defined(HAVE_MMAP)
+	if (cross_fseeko(diskimg, 0, SEEK_END) != 0) {
+		return;
+	}
+	const auto file_size = cross_ftello(diskimg);
+	cross_fseeko(diskimg, 0, SEEK_SET);
+	if (file_size <= 0 ||
+	    static_cast<uint64_t>(file_size) > std::numeric_limits<size_t>::max()) {
+		return;
+	}
+	const auto size = static_cast<size_t>(file_size);
+	const auto fd   = fileno(diskimg);
+
+	// Images opened read-only can only be mapped read-only
+	auto mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	is_mapped_writable = (mapping != MAP_FAILED);
+	if (!is_mapped_writable) {
+		mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	if (mapping == MAP_FAILED) {
+		LOG_DEBUG("BIOSDISK: Could not map '%s', using file access: %s",
+		          diskname,
+		          strerror(errno));
+		return;
+	}
+	mapped_image = static_cast<uint8_t*>(mapping);
+	mapped_size  = size;
+#endif
+}
+
+void imageDisk::Flush()
+{
+#if defined(HAVE_MMAP)
+	if (has_mapped_writes) {
+		msync(mapped_image, mapped_size, MS_ASYNC);
+		has_mapped_writes = false;
+	}
+#endif
+	if (last_action == WRITE) {
+		fflush(diskimg);
+	}
+}
+
+void imageDisk::UnmapImage()
+{
+#if defined(HAVE_MMAP)
+	if (mapped_image) {
+		munmap(mapped_image, mapped_size);
+	}
+#endif
+	mapped_image       = nullptr;
+	mapped_size        = 0;
+	is_mapped_writable = false;
+	has_mapped_writes  = false;
+}
+
 imageDisk::imageDisk(FILE *img_file, const char *img_name, uint32_t img_size_k, bool is_hdd)
         : hardDrive(is_hdd),
           active(false),
@@ -225,9 +372,10 @@ imageDisk::imageDisk(FILE *img_file, const char *img_name, uint32_t img_size_k,
           current_fpos(0),
           last_action(NONE)
 {
-	fseek(diskimg,0,SEEK_SET);
 	memset(diskname,0,512);
 	safe_strcpy(diskname, img_name);
+	MapImage();
+	fseek(diskimg,0,SEEK_SET);
 	if (!is_hdd) {
 		uint8_t i=0;
 		bool founddisk = false;
@@ -254,6 +402,14 @@ imageDisk::imageDisk(FILE *img_file, const char *img_name, uint32_t img_size_k,
 	}
 }
 
+imageDisk::~imageDisk()
+{
+	// Unmapping writes back any modified sectors
+	UnmapImage();
+	if (diskimg != nullptr)
+		fclose(diskimg);
+}
+
 void imageDisk::Set_Geometry(uint32_t setHeads, uint32_t setCyl, uint32_t setSect, uint32_t setSectSize) {
 	heads = setHeads;
 	cylinders = setCyl;
@@ -326,11 +482,35 @@ static bool has_image(const std::array<T, N> &arr) {
 	return std::any_of(std::begin(arr), std::end(arr), to_bool);
 }
 
+// The sector transfers address the buffer through a segment and offset, so
+// they wrap around to the start of the segment instead of crossing into the
+// next one
+static void write_sectors_to_segment(const uint16_t seg, uint16_t off,
+                                     const uint8_t* data, size_t num_bytes)
+{
+	while (num_bytes) {
+		const auto chunk = std::min<size_t>(num_bytes, 0x10000 - off);
+		MEM_BlockWrite(PhysicalMake(seg, off), data, chunk);
+		data += chunk;
+		num_bytes -= chunk;
+		off = 0;
+	}
+}
+
+static void read_sectors_from_segment(const uint16_t seg, uint16_t off,
+                                      uint8_t* data, size_t num_bytes)
+{
+	while (num_bytes) {
+		const auto chunk = std::min<size_t>(num_bytes, 0x10000 - off);
+		MEM_BlockRead(PhysicalMake(seg, off), data, chunk);
+		data += chunk;
+		num_bytes -= chunk;
+		off = 0;
+	}
+}
+
 static Bitu INT13_DiskHandler(void) {
-	uint16_t segat, bufptr;
-	uint8_t sectbuf[512];
 	uint8_t  drivenum;
-	Bitu t;
 	last_drive = reg_dl;
 	drivenum = GetDosDriveNumber(reg_dl);
 	const bool any_images = has_image(imageDiskList);
@@ -362,6 +542,10 @@ static Bitu INT13_DiskHandler(void) {
 				return CBRET_NONE;
 			}
 			if (machine!=MCH_PCJR && reg_dl<0x80) reg_ip++;
+			// A reset is the closest thing to a flush the BIOS has
+			if (drivenum < MAX_DISK_IMAGES && imageDiskList[drivenum]) {
+				imageDiskList[drivenum]->Flush();
+			}
 			last_status = 0x00;
 			CALLBACK_SCF(false);
 		}
@@ -410,21 +594,30 @@ static Bitu INT13_DiskHandler(void) {
 			return CBRET_NONE;
 		}
 
-		segat = SegValue(es);
-		bufptr = reg_bx;
-		for (Bitu i = 0; i < reg_al; i++) {
-			last_status = imageDiskList[drivenum]->Read_Sector((uint32_t)reg_dh, (uint32_t)(reg_ch | ((reg_cl & 0xc0)<< 2)), (uint32_t)((reg_cl & 63)+i), sectbuf);
-			if((last_status != 0x00) || (killRead)) {
+		{
+			// All sectors are read from the image in one go
+			const auto disk      = imageDiskList[drivenum];
+			const auto num_bytes = reg_al * disk->getSectSize();
+			static std::vector<uint8_t> sectors_buffer = {};
+			sectors_buffer.resize(num_bytes);
+
+			last_status = BIOS_ReadDiskSectors(disk,
+			                                   reg_dh,
+			                                   reg_ch | ((reg_cl & 0xc0) << 2),
+			                                   reg_cl & 63,
+			                                   reg_al,
+			                                   sectors_buffer.data());
+			if ((last_status != 0x00) || (killRead)) {
 				LOG_MSG("Error in disk read");
 				killRead = false;
 				reg_ah = 0x04;
 				CALLBACK_SCF(true);
 				return CBRET_NONE;
 			}
-			for(t=0;t<512;t++) {
-				real_writeb(segat,bufptr,sectbuf[t]);
-				bufptr++;
-			}
+			write_sectors_to_segment(SegValue(es),
+			                         reg_bx,
+			                         sectors_buffer.data(),
+			                         num_bytes);
 		}
 		reg_ah = 0x00;
 		CALLBACK_SCF(false);
@@ -435,14 +628,24 @@ static Bitu INT13_DiskHandler(void) {
 			CALLBACK_SCF(true);
 			return CBRET_NONE;
 		}
-		bufptr = reg_bx;
-		for (Bitu i = 0; i < reg_al; i++) {
-			for(t=0;t<imageDiskList[drivenum]->getSectSize();t++) {
-				sectbuf[t] = real_readb(SegValue(es),bufptr);
-				bufptr++;
-			}
-			last_status = imageDiskList[drivenum]->Write_Sector((uint32_t)reg_dh, (uint32_t)(reg_ch | ((reg_cl & 0xc0) << 2)), (uint32_t)((reg_cl & 63) + i), &sectbuf[0]);
-			if(last_status != 0x00) {
+		{
+			// All sectors are written to the image in one go
+			const auto disk      = imageDiskList[drivenum];
+			const auto num_bytes = reg_al * disk->getSectSize();
+			static std::vector<uint8_t> sectors_buffer = {};
+			sectors_buffer.resize(num_bytes);
+
+			read_sectors_from_segment(SegValue(es),
+			                          reg_bx,
+			                          sectors_buffer.data(),
+			                          num_bytes);
+			last_status = BIOS_WriteDiskSectors(disk,
+			                                    reg_dh,
+			                                    reg_ch | ((reg_cl & 0xc0) << 2),
+			                                    reg_cl & 63,
+			                                    reg_al,
+			                                    sectors_buffer.data());
+			if (last_status != 0x00) {
 				CALLBACK_SCF(true);
 				return CBRET_NONE;
 			}
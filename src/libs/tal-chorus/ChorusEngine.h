@@ -98,6 +98,19 @@ public:
         *sampleL= *sampleL+resultL*1.4f;
         *sampleR= *sampleR+resultR*1.4f;
     }
+
+    // Processes a block of non-interleaved samples in-place
+    void process(float *samplesL, float *samplesR, int numFrames)
+    {
+        if (!isChorus1Enabled && !isChorus2Enabled)
+        {
+            return;
+        }
+        for (int i = 0; i < numFrames; ++i)
+        {
+            process(&samplesL[i], &samplesR[i]);
+        }
+    }
 };
 
 #endif
@@ -18,11 +18,15 @@
 
 #include "zmbv.h"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <thread>
 
 #include "math_utils.h"
 #include "mem_unaligned.h"
@@ -31,6 +35,11 @@
 
 CHECK_NARROWING();
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZMBV_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 constexpr uint8_t DBZV_VERSION_HIGH = 0;
 constexpr uint8_t DBZV_VERSION_LOW  = 1;
 
@@ -117,6 +126,8 @@ bool VideoCodec::SetupBuffers(const ZMBV_FORMAT _format, const int blockwidth, c
 
 	const auto blocks_needed = check_cast<uint32_t>(xblocks * yblocks);
 	blocks.resize(blocks_needed);
+	blockVectors.resize(blocks_needed);
+	changedBlocks.reserve(blocks_needed);
 
 	size_t i = 0;
 	for (auto y = 0; y < yblocks; ++y) {
@@ -160,17 +171,95 @@ void VideoCodec::CreateVectorTable()
 	}
 }
 
+// Pixels are compared on their low 24 bits only; the fourth byte of 32-bit
+// pixels is unused padding. The mask has no effect on narrower pixels.
+constexpr uint32_t PixelCompareMask = 0x00ffffff;
+
+template <class P>
+static bool pixels_differ(const P a, const P b)
+{
+	return ((a ^ b) & PixelCompareMask) != 0;
+}
+
+#if defined(ZMBV_USE_SSE2)
+// Returns a 16-bit mask with bit n set if pixel n of the two 16-pixel runs
+// differs.
+static uint32_t diff_mask_16(const uint8_t *a, const uint8_t *b)
+{
+	const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+	const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+	const auto eq = _mm_cmpeq_epi8(va, vb);
+	return ~static_cast<uint32_t>(_mm_movemask_epi8(eq)) & 0xffff;
+}
+
+static uint32_t diff_mask_16(const uint16_t *a, const uint16_t *b)
+{
+	auto eq_half = [&](const int offset) {
+		const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + offset));
+		const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + offset));
+		return _mm_cmpeq_epi16(va, vb);
+	};
+	// Narrow the 16-bit lane results to one byte per pixel
+	const auto eq = _mm_packs_epi16(eq_half(0), eq_half(8));
+	return ~static_cast<uint32_t>(_mm_movemask_epi8(eq)) & 0xffff;
+}
+
+static uint32_t diff_mask_16(const uint32_t *a, const uint32_t *b)
+{
+	const auto mask = _mm_set1_epi32(static_cast<int>(PixelCompareMask));
+
+	auto eq_quarter = [&](const int offset) {
+		const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + offset));
+		const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + offset));
+		return _mm_cmpeq_epi32(_mm_and_si128(va, mask), _mm_and_si128(vb, mask));
+	};
+	// Narrow the 32-bit lane results to one byte per pixel
+	const auto eq_lo = _mm_packs_epi32(eq_quarter(0), eq_quarter(4));
+	const auto eq_hi = _mm_packs_epi32(eq_quarter(8), eq_quarter(12));
+	const auto eq    = _mm_packs_epi16(eq_lo, eq_hi);
+	return ~static_cast<uint32_t>(_mm_movemask_epi8(eq)) & 0xffff;
+}
+
+static void xor_bytes(const uint8_t *a, const uint8_t *b, uint8_t *out, const size_t num_bytes)
+{
+	size_t i = 0;
+	for (; i + 16 <= num_bytes; i += 16) {
+		const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_xor_si128(va, vb));
+	}
+	for (; i < num_bytes; ++i) {
+		out[i] = a[i] ^ b[i];
+	}
+}
+#endif
+
+// Pixels in a full-width block row; narrower blocks at the right edge of the
+// frame use the scalar paths
+constexpr int SimdBlockWidth = 16;
+
 template <class P>
 int VideoCodec::PossibleBlock(const int vx, const int vy, const FrameBlock & block)
 {
 	int ret = 0;
-	P *pold = reinterpret_cast<P *>(oldframe) + block.start + (vy * pitch) + vx;
-	P *pnew = reinterpret_cast<P *>(newframe) + block.start;
-	;
+	const P *pold = reinterpret_cast<const P *>(oldframe) + block.start + (vy * pitch) + vx;
+	const P *pnew = reinterpret_cast<const P *>(newframe) + block.start;
+
+#if defined(ZMBV_USE_SSE2)
+	if (block.dx == SimdBlockWidth) {
+		// Only every fourth pixel of every fourth row is sampled
+		constexpr uint32_t sampled_pixels = 0x1111;
+		for (auto y = 0; y < block.dy; y += 4) {
+			ret += std::popcount(diff_mask_16(pold, pnew) & sampled_pixels);
+			pold += pitch * 4;
+			pnew += pitch * 4;
+		}
+		return ret;
+	}
+#endif
 	for (auto y = 0; y < block.dy; y += 4) {
 		for (auto x = 0; x < block.dx; x += 4) {
-			const auto test = 0 - ((pold[x] - pnew[x]) & 0x00ffffff);
-			ret -= check_cast<int>(test >> 31);
+			ret += pixels_differ(pold[x], pnew[x]);
 		}
 		pold += pitch * 4;
 		pnew += pitch * 4;
@@ -182,13 +271,22 @@ template <class P>
 int VideoCodec::CompareBlock(const int vx, const int vy, const FrameBlock & block)
 {
 	int ret = 0;
-	P *pold = reinterpret_cast<P *>(oldframe) + block.start + (vy * pitch) + vx;
-	P *pnew = reinterpret_cast<P *>(newframe) + block.start;
-	;
+	const P *pold = reinterpret_cast<const P *>(oldframe) + block.start + (vy * pitch) + vx;
+	const P *pnew = reinterpret_cast<const P *>(newframe) + block.start;
+
+#if defined(ZMBV_USE_SSE2)
+	if (block.dx == SimdBlockWidth) {
+		for (auto y = 0; y < block.dy; y++) {
+			ret += std::popcount(diff_mask_16(pold, pnew));
+			pold += pitch;
+			pnew += pitch;
+		}
+		return ret;
+	}
+#endif
 	for (auto y = 0; y < block.dy; y++) {
 		for (auto x = 0; x < block.dx; x++) {
-			const auto test = 0 - ((pold[x] - pnew[x]) & 0x00ffffff);
-			ret -= check_cast<int>(test >> 31);
+			ret += pixels_differ(pold[x], pnew[x]);
 		}
 		pold += pitch;
 		pnew += pitch;
@@ -196,11 +294,41 @@ int VideoCodec::CompareBlock(const int vx, const int vy, const FrameBlock & bloc
 	return ret;
 }
 
+template <class P>
+bool VideoCodec::BlockUnchanged(const FrameBlock & block)
+{
+	const P *pold = reinterpret_cast<const P *>(oldframe) + block.start;
+	const P *pnew = reinterpret_cast<const P *>(newframe) + block.start;
+
+	const auto row_bytes = static_cast<size_t>(block.dx) * sizeof(P);
+	for (auto y = 0; y < block.dy; ++y) {
+		if (memcmp(pold, pnew, row_bytes) != 0) {
+			return false;
+		}
+		pold += pitch;
+		pnew += pitch;
+	}
+	return true;
+}
+
 template <class P>
 void VideoCodec::AddXorBlock(const int vx, const int vy, const FrameBlock & block)
 {
-	P *pold = reinterpret_cast<P *>(oldframe) + block.start + (vy * pitch) + vx;
-	P *pnew = reinterpret_cast<P *>(newframe) + block.start;
+	const P *pold = reinterpret_cast<const P *>(oldframe) + block.start + (vy * pitch) + vx;
+	const P *pnew = reinterpret_cast<const P *>(newframe) + block.start;
+
+#if defined(ZMBV_USE_SSE2)
+	const auto row_bytes = static_cast<size_t>(block.dx) * sizeof(P);
+	for (auto y = 0; y < block.dy; ++y) {
+		xor_bytes(reinterpret_cast<const uint8_t *>(pnew),
+		          reinterpret_cast<const uint8_t *>(pold),
+		          &work[workUsed],
+		          row_bytes);
+		workUsed += row_bytes;
+		pold += pitch;
+		pnew += pitch;
+	}
+#else
 	for (auto y = 0; y < block.dy; ++y) {
 		for (auto x = 0; x < block.dx; ++x) {
 			*reinterpret_cast<P *>(&work[workUsed]) = pnew[x] ^ pold[x];
@@ -209,6 +337,7 @@ void VideoCodec::AddXorBlock(const int vx, const int vy, const FrameBlock & bloc
 		pold += pitch;
 		pnew += pitch;
 	}
+#endif
 }
 
 // align offset to the next 4-byte boundary
@@ -216,49 +345,167 @@ void VideoCodec::AlignWork(size_t & offset) {
 	offset = (offset + blocks.size() * 2u + 3u) & ~3u;
 }
 
+template <class P>
+VideoCodec::BlockVector VideoCodec::SearchBlock(const FrameBlock & block)
+{
+	int8_t bestvx   = 0;
+	int8_t bestvy   = 0;
+	auto bestchange = CompareBlock<P>(0, 0, block);
+	auto possibles  = 64;
+
+	for (auto v = 0; v < VectorCount && possibles; v++) {
+		if (bestchange < 4)
+			break;
+		auto vx = VectorTable[v].x;
+		auto vy = VectorTable[v].y;
+		if (PossibleBlock<P>(vx, vy, block) < 4) {
+			possibles--;
+			// if (!possibles) Msg("Ran out of possibles, at
+			// %d of %d best%d\n",v,VectorCount,bestchange);
+			auto testchange = CompareBlock<P>(vx, vy, block);
+			if (testchange < bestchange) {
+				bestchange = testchange;
+				bestvx     = check_cast<int8_t>(vx);
+				bestvy     = check_cast<int8_t>(vy);
+			}
+		}
+	}
+	return {bestvx, bestvy, bestchange != 0};
+}
+
+// Blocks identical to the previous frame are flagged up-front with a cheap
+// row comparison, so a mostly static screen skips the vector search (and the
+// search threads) altogether.
+//
+// The search for each remaining block only reads the old and new frames, so
+// they can be handed out to several threads; the results don't depend on
+// which thread searched which block.
+template <class P>
+void VideoCodec::SearchBlocks()
+{
+	changedBlocks.clear();
+	for (size_t b = 0; b < blocks.size(); ++b) {
+		const bool unchanged = BlockUnchanged<P>(blocks[b]);
+		if (unchanged) {
+			blockVectors[b] = {};
+		} else {
+			changedBlocks.push_back(b);
+		}
+	}
+	nextSearchBlock = 0;
+
+	// Small frames aren't worth waking up the helpers
+	constexpr size_t min_blocks_per_thread = 64;
+	const auto num_helpers = std::min(searchThreads.size(),
+	                                  changedBlocks.size() / min_blocks_per_thread);
+	if (num_helpers == 0) {
+		SearchChangedBlocks<P>();
+		return;
+	}
+
+	{
+		std::lock_guard lock(searchMutex);
+		searchChangedBlocks = &VideoCodec::SearchChangedBlocks<P>;
+		searchHelpersWanted = num_helpers;
+		searchHelpersBusy   = num_helpers;
+		++searchGeneration;
+	}
+	searchStart.notify_all();
+
+	SearchChangedBlocks<P>();
+
+	std::unique_lock lock(searchMutex);
+	searchDone.wait(lock, [this] { return searchHelpersBusy == 0; });
+}
+
+template <class P>
+void VideoCodec::SearchChangedBlocks()
+{
+	for (auto i = nextSearchBlock++; i < changedBlocks.size(); i = nextSearchBlock++) {
+		const auto b    = changedBlocks[i];
+		blockVectors[b] = SearchBlock<P>(blocks[b]);
+	}
+}
+
+void VideoCodec::SearchThreadLoop()
+{
+	uint32_t generation = 0;
+
+	std::unique_lock lock(searchMutex);
+	while (true) {
+		searchStart.wait(lock, [&] {
+			return stopSearchThreads || generation != searchGeneration;
+		});
+		if (stopSearchThreads) {
+			return;
+		}
+		generation = searchGeneration;
+
+		// Frames with few changed blocks only need some of the helpers
+		if (searchHelpersWanted == 0) {
+			continue;
+		}
+		--searchHelpersWanted;
+
+		lock.unlock();
+		(this->*searchChangedBlocks)();
+		lock.lock();
+
+		if (--searchHelpersBusy == 0) {
+			searchDone.notify_one();
+		}
+	}
+}
+
+void VideoCodec::StartSearchThreads(const int num_threads)
+{
+	assert(num_threads >= 0);
+	StopSearchThreads();
+
+	stopSearchThreads = false;
+	for (auto i = 0; i < num_threads; ++i) {
+		searchThreads.emplace_back(&VideoCodec::SearchThreadLoop, this);
+	}
+}
+
+void VideoCodec::StopSearchThreads()
+{
+	{
+		std::lock_guard lock(searchMutex);
+		stopSearchThreads = true;
+	}
+	searchStart.notify_all();
+
+	for (auto &thread : searchThreads) {
+		thread.join();
+	}
+	searchThreads.clear();
+}
+
 template <class P>
 void VideoCodec::AddXorFrame()
 {
+	SearchBlocks<P>();
+
 	auto vectors = &work[workUsed];
 
 	AlignWork(workUsed);
 
 	size_t b = 0;
 	for (const auto & block : blocks) {
-
-		int8_t bestvx   = 0;
-		int8_t bestvy   = 0;
-		auto bestchange = CompareBlock<P>(0, 0, block);
-		auto possibles  = 64;
-
-		for (auto v = 0; v < VectorCount && possibles; v++) {
-			if (bestchange < 4)
-				break;
-			auto vx = VectorTable[v].x;
-			auto vy = VectorTable[v].y;
-			if (PossibleBlock<P>(vx, vy, block) < 4) {
-				possibles--;
-				// if (!possibles) Msg("Ran out of possibles, at
-				// %d of %d best%d\n",v,VectorCount,bestchange);
-				auto testchange = CompareBlock<P>(vx, vy, block);
-				if (testchange < bestchange) {
-					bestchange = testchange;
-					bestvx     = check_cast<int8_t>(vx);
-					bestvy     = check_cast<int8_t>(vy);
-				}
-			}
-		}
-		vectors[b * 2 + 0] = static_cast<uint8_t>(left_shift_signed(bestvx, 1));
-		vectors[b * 2 + 1] = static_cast<uint8_t>(left_shift_signed(bestvy, 1));
-		if (bestchange) {
+		const auto &best = blockVectors[b];
+		vectors[b * 2 + 0] = static_cast<uint8_t>(left_shift_signed(best.x, 1));
+		vectors[b * 2 + 1] = static_cast<uint8_t>(left_shift_signed(best.y, 1));
+		if (best.changed) {
 			vectors[b * 2 + 0] |= 1;
-			AddXorBlock<P>(bestvx, bestvy, block);
+			AddXorBlock<P>(best.x, best.y, block);
 		}
 		++b;
 	}
 }
 
-bool VideoCodec::SetupCompress(const int _width, const int _height)
+bool VideoCodec::SetupCompress(const int _width, const int _height,
+                               const int num_search_threads)
 {
 	width  = _width;
 	height = _height;
@@ -267,6 +514,7 @@ bool VideoCodec::SetupCompress(const int _width, const int _height)
 	if (deflateInit2(&zstream, ZLIB_COMPRESSION_LEVEL, ZLIB_COMPRESSION_METHOD, ZLIB_MEM_LEVEL, ZLIB_MEM_LEVEL, ZLIB_STRATEGY) !=
 	    Z_OK)
 		return false;
+	StartSearchThreads(num_search_threads);
 	return true;
 }
 
@@ -608,3 +856,8 @@ VideoCodec::VideoCodec()
 	CreateVectorTable();
 	memset(&zstream, 0, sizeof(zstream));
 }
+
+VideoCodec::~VideoCodec()
+{
+	StopSearchThreads();
+}
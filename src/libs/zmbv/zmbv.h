@@ -19,7 +19,11 @@
 #ifndef DOSBOX_ZMBV_H
 #define DOSBOX_ZMBV_H
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "config.h"
@@ -66,6 +70,11 @@ private:
 		int y = 0;
 		int slot = 0;
 	};
+	struct BlockVector {
+		int8_t x = 0;
+		int8_t y = 0;
+		bool changed = false;
+	};
 	struct KeyframeHeader {
 		uint8_t high_version = 0;
 		uint8_t low_version = 0;
@@ -96,6 +105,21 @@ private:
 	uint32_t bufsize = 0;
 
 	std::vector<FrameBlock> blocks = {};
+	std::vector<BlockVector> blockVectors = {};
+	std::vector<size_t> changedBlocks = {};
+
+	// Helper threads for the motion vector search, started once per video.
+	// Each frame bumps the generation to hand them its changed blocks.
+	std::vector<std::thread> searchThreads = {};
+	std::mutex searchMutex                 = {};
+	std::condition_variable searchStart    = {};
+	std::condition_variable searchDone     = {};
+	void (VideoCodec::*searchChangedBlocks)() = nullptr;
+	std::atomic<size_t> nextSearchBlock    = 0;
+	uint32_t searchGeneration              = 0;
+	size_t searchHelpersWanted             = 0;
+	size_t searchHelpersBusy               = 0;
+	bool stopSearchThreads                 = false;
 	size_t workUsed = 0;
 	size_t workPos = 0;
 
@@ -117,12 +141,23 @@ private:
 	template <class P>
 	void AddXorFrame();
 	template <class P>
+	void SearchBlocks();
+	template <class P>
+	void SearchChangedBlocks();
+	void SearchThreadLoop();
+	void StartSearchThreads(int num_threads);
+	void StopSearchThreads();
+	template <class P>
+	BlockVector SearchBlock(const FrameBlock & block);
+	template <class P>
 	void UnXorFrame();
 	template <class P>
 	int PossibleBlock(int vx, int vy, const FrameBlock & block);
 	template <class P>
 	int CompareBlock(int vx, int vy, const FrameBlock & block);
 	template <class P>
+	bool BlockUnchanged(const FrameBlock & block);
+	template <class P>
 	void AddXorBlock(int vx, int vy, const FrameBlock & block);
 	template <class P>
 	void UnXorBlock(int vx, int vy, const FrameBlock & block);
@@ -133,11 +168,16 @@ private:
 
 public:
 	VideoCodec();
+	~VideoCodec();
 
 	VideoCodec(const VideoCodec &) = delete;            // prevent copy
 	VideoCodec &operator=(const VideoCodec &) = delete; // prevent assignment
 
-	bool SetupCompress(int _width, int _height);
+	// num_search_threads is the number of extra threads to spread each
+	// delta frame's motion vector search across; 0 searches on the
+	// calling thread only
+	bool SetupCompress(int _width, int _height, int num_search_threads = 0);
+
 	bool SetupDecompress(int _width, int _height);
 	ZMBV_FORMAT BPPFormat(int bpp);
 	int NeededSize(int _width, int _height, ZMBV_FORMAT _format);
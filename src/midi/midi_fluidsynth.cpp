@@ -762,13 +762,11 @@ void MidiHandlerFluidsynth::MixerCallBack(const int requested_audio_frames)
 
 	static std::vector<AudioFrame> audio_frames = {};
 
-	const auto has_dequeued = audio_frame_fifo.BulkDequeue(audio_frames,
-	                                                       requested_audio_frames);
+	audio_frames.resize(check_cast<size_t>(requested_audio_frames));
+	const auto num_dequeued = audio_frame_fifo.BulkDequeue(audio_frames);
 
-	if (has_dequeued) {
-		assert(check_cast<int>(audio_frames.size()) == requested_audio_frames);
-		mixer_channel->AddSamples_sfloat(requested_audio_frames,
-		                                 &audio_frames[0][0]);
+	if (num_dequeued == audio_frames.size()) {
+		mixer_channel->AddSamples_sfloat(audio_frames);
 		last_rendered_ms = PIC_FullIndex();
 	} else {
 		assert(!audio_frame_fifo.IsRunning());
@@ -794,7 +792,8 @@ void MidiHandlerFluidsynth::RenderAudioFramesToFifo(const int num_audio_frames)
 	                        1,
 	                        2);
 
-	audio_frame_fifo.BulkEnqueue(audio_frames, num_audio_frames);
+	audio_frame_fifo.BulkEnqueue(
+	        std::span(audio_frames).first(check_cast<size_t>(num_audio_frames)));
 }
 
 void MidiHandlerFluidsynth::ProcessWorkFromFifo()
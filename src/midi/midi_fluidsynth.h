@@ -33,6 +33,7 @@
 
 #include "mixer.h"
 #include "rwqueue.h"
+#include "spsc_queue.h"
 
 class MidiHandlerFluidsynth final : public MidiHandler {
 public:
@@ -74,7 +75,7 @@ private:
 	FluidSynthPtr synth{nullptr, &delete_fluid_synth};
 
 	MixerChannelPtr mixer_channel = nullptr;
-	RWQueue<AudioFrame> audio_frame_fifo{1};
+	SPSCQueue<AudioFrame> audio_frame_fifo{1};
 	RWQueue<MidiWork> work_fifo{1};
 	std::thread renderer = {};
 
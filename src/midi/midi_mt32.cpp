@@ -1023,13 +1023,11 @@ void MidiHandler_mt32::MixerCallBack(const int requested_audio_frames)
 
 	static std::vector<AudioFrame> audio_frames = {};
 
-	const auto has_dequeued = audio_frame_fifo.BulkDequeue(audio_frames,
-	                                                       requested_audio_frames);
+	audio_frames.resize(check_cast<size_t>(requested_audio_frames));
+	const auto num_dequeued = audio_frame_fifo.BulkDequeue(audio_frames);
 
-	if (has_dequeued) {
-		assert(check_cast<int>(audio_frames.size()) == requested_audio_frames);
-		channel->AddSamples_sfloat(requested_audio_frames,
-		                           &audio_frames[0][0]);
+	if (num_dequeued == audio_frames.size()) {
+		channel->AddSamples_sfloat(audio_frames);
 
 		last_rendered_ms = PIC_FullIndex();
 	} else {
@@ -1051,7 +1049,8 @@ void MidiHandler_mt32::RenderAudioFramesToFifo(const int num_frames)
 	service->renderFloat(&audio_frames[0][0], num_frames);
 	lock.unlock();
 
-	audio_frame_fifo.BulkEnqueue(audio_frames, num_frames);
+	audio_frame_fifo.BulkEnqueue(
+	        std::span(audio_frames).first(check_cast<size_t>(num_frames)));
 }
 
 // The next MIDI work task is processed, which includes rendering audio frames
@@ -39,6 +39,7 @@
 
 #include "mixer.h"
 #include "rwqueue.h"
+#include "spsc_queue.h"
 #include "std_filesystem.h"
 
 // forward declaration
@@ -85,7 +86,7 @@ private:
 
 	// Managed objects
 	MixerChannelPtr channel = nullptr;
-	RWQueue<AudioFrame> audio_frame_fifo{1};
+	SPSCQueue<AudioFrame> audio_frame_fifo{1};
 	RWQueue<MidiWork> work_fifo{1};
 
 	std::mutex service_mutex = {};
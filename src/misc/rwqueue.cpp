@@ -309,6 +309,9 @@ template class RWQueue<MidiWork>;
 #include "render.h"
 template class RWQueue<SaveImageTask>;
 
+#include "../capture/capture_video.h"
+template class RWQueue<VideoCaptureTask>;
+
 //PC Speaker
 template class RWQueue<float>;
 
@@ -0,0 +1,254 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "spsc_queue.h"
+
+#include <algorithm>
+#include <cassert>
+
+// The producer owns write_index and the consumer owns read_index. Each side
+// reads the other's index with acquire semantics and publishes its own with
+// release semantics, so item data written before a CommitWrite() is visible
+// to the consumer that observes the new write_index, and vice versa for room.
+//
+// Blocking waits use a separate event counter per direction rather than the
+// indices themselves, so Stop() can wake the waiters without changing the
+// contents of the queue. Waiters load the event counter before re-checking
+// their condition to avoid missing a notification.
+
+template <typename T>
+SPSCQueue<T>::SPSCQueue(size_t queue_capacity)
+{
+	Resize(queue_capacity);
+}
+
+template <typename T>
+void SPSCQueue<T>::Resize(size_t queue_capacity)
+{
+	assert(queue_capacity > 0);
+	capacity = queue_capacity;
+	buffer.resize(capacity);
+	write_index = 0;
+	read_index  = 0;
+}
+
+template <typename T>
+void SPSCQueue<T>::Clear()
+{
+	read_index.store(write_index.load(std::memory_order_acquire),
+	                 std::memory_order_release);
+	room_event.fetch_add(1, std::memory_order_release);
+	room_event.notify_one();
+}
+
+template <typename T>
+size_t SPSCQueue<T>::Size() const
+{
+	// Load the read index first, so the difference can't go negative
+	const auto read  = read_index.load(std::memory_order_acquire);
+	const auto write = write_index.load(std::memory_order_acquire);
+	return static_cast<size_t>(write - read);
+}
+
+template <typename T>
+bool SPSCQueue<T>::IsEmpty() const
+{
+	return Size() == 0;
+}
+
+template <typename T>
+bool SPSCQueue<T>::IsRunning() const
+{
+	return is_running;
+}
+
+template <typename T>
+size_t SPSCQueue<T>::MaxCapacity() const
+{
+	return capacity;
+}
+
+template <typename T>
+float SPSCQueue<T>::GetPercentFull() const
+{
+	const auto cur_level = static_cast<float>(Size());
+	const auto max_level = static_cast<float>(capacity);
+	return (100.0f * cur_level) / max_level;
+}
+
+template <typename T>
+void SPSCQueue<T>::Start()
+{
+	is_running = true;
+}
+
+template <typename T>
+void SPSCQueue<T>::Stop()
+{
+	if (!is_running.exchange(false)) {
+		return;
+	}
+	items_event.fetch_add(1, std::memory_order_release);
+	room_event.fetch_add(1, std::memory_order_release);
+	items_event.notify_all();
+	room_event.notify_all();
+}
+
+template <typename T>
+typename SPSCQueue<T>::Spans SPSCQueue<T>::MakeSpans(const uint64_t start_index,
+                                                     const size_t num_items)
+{
+	const auto start = static_cast<size_t>(start_index % capacity);
+	const auto first_size = std::min(num_items, capacity - start);
+
+	Spans spans = {};
+	spans.first = {buffer.data() + start, first_size};
+	spans.second = {buffer.data(), num_items - first_size};
+	return spans;
+}
+
+template <typename T>
+typename SPSCQueue<T>::Spans SPSCQueue<T>::GetWriteSpans()
+{
+	const auto write = write_index.load(std::memory_order_relaxed);
+	const auto read  = read_index.load(std::memory_order_acquire);
+	const auto free_capacity = capacity - static_cast<size_t>(write - read);
+	return MakeSpans(write, free_capacity);
+}
+
+template <typename T>
+void SPSCQueue<T>::CommitWrite(const size_t num_items)
+{
+	if (num_items == 0) {
+		return;
+	}
+	write_index.fetch_add(num_items, std::memory_order_release);
+	items_event.fetch_add(1, std::memory_order_release);
+	items_event.notify_one();
+}
+
+template <typename T>
+typename SPSCQueue<T>::Spans SPSCQueue<T>::GetReadSpans()
+{
+	const auto read  = read_index.load(std::memory_order_relaxed);
+	const auto write = write_index.load(std::memory_order_acquire);
+	return MakeSpans(read, static_cast<size_t>(write - read));
+}
+
+template <typename T>
+void SPSCQueue<T>::CommitRead(const size_t num_items)
+{
+	if (num_items == 0) {
+		return;
+	}
+	read_index.fetch_add(num_items, std::memory_order_release);
+	room_event.fetch_add(1, std::memory_order_release);
+	room_event.notify_one();
+}
+
+template <typename T>
+size_t SPSCQueue<T>::NonblockingBulkEnqueue(std::span<const T> from_source)
+{
+	if (!is_running) {
+		return 0;
+	}
+	const auto spans     = GetWriteSpans();
+	const auto num_items = std::min(from_source.size(), spans.size());
+
+	const auto first_size = std::min(num_items, spans.first.size());
+	std::copy_n(from_source.begin(), first_size, spans.first.begin());
+	std::copy_n(from_source.begin() + first_size,
+	            num_items - first_size,
+	            spans.second.begin());
+
+	CommitWrite(num_items);
+	return num_items;
+}
+
+template <typename T>
+bool SPSCQueue<T>::BulkEnqueue(std::span<const T> from_source)
+{
+	while (!from_source.empty()) {
+		// wait until we're stopped or the queue has room
+		auto event = room_event.load(std::memory_order_acquire);
+		while (is_running && Size() == capacity) {
+			room_event.wait(event, std::memory_order_acquire);
+			event = room_event.load(std::memory_order_acquire);
+		}
+		if (!is_running) {
+			return false;
+		}
+		const auto num_items = NonblockingBulkEnqueue(from_source);
+		from_source          = from_source.subspan(num_items);
+	}
+	return is_running;
+}
+
+template <typename T>
+size_t SPSCQueue<T>::NonblockingBulkDequeue(std::span<T> into_target)
+{
+	const auto spans     = GetReadSpans();
+	const auto num_items = std::min(into_target.size(), spans.size());
+
+	const auto first_size = std::min(num_items, spans.first.size());
+	std::copy_n(spans.first.begin(), first_size, into_target.begin());
+	std::copy_n(spans.second.begin(),
+	            num_items - first_size,
+	            into_target.begin() + first_size);
+
+	CommitRead(num_items);
+	return num_items;
+}
+
+template <typename T>
+size_t SPSCQueue<T>::BulkDequeue(std::span<T> into_target)
+{
+	size_t num_dequeued = 0;
+	while (num_dequeued < into_target.size()) {
+		// wait until we're stopped or the queue has items
+		auto event = items_event.load(std::memory_order_acquire);
+		while (is_running && IsEmpty()) {
+			items_event.wait(event, std::memory_order_acquire);
+			event = items_event.load(std::memory_order_acquire);
+		}
+		// Even if the queue has stopped, we need to drain the
+		// (previously) queued items before we're done.
+		const auto num_items = NonblockingBulkDequeue(
+		        into_target.subspan(num_dequeued));
+		if (num_items == 0 && !is_running) {
+			break;
+		}
+		num_dequeued += num_items;
+	}
+	return num_dequeued;
+}
+
+// Explicit template instantiations
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Unit tests
+template class SPSCQueue<int>;
+
+// Mixer output, FluidSynth, MT-32
+#include "audio_frame.h"
+template class SPSCQueue<AudioFrame>;
+
+// CD-DA decoding
+#include "../dos/cdrom.h"
+template class SPSCQueue<CDROM_Interface_Image::AudioDecoder::Chunk>;
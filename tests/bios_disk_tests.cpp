@@ -0,0 +1,97 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "bios_disk.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "std_filesystem.h"
+
+#include "temp_test_dir.h"
+
+namespace {
+
+constexpr uint32_t SectorSize = 512;
+constexpr uint32_t NumSectors = 2 * 16 * 63;
+
+class ImageDiskTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		contents.resize(NumSectors * SectorSize);
+		for (size_t i = 0; i < contents.size(); ++i) {
+			contents[i] = static_cast<uint8_t>(i / SectorSize + i);
+		}
+		write_host_file(path, contents);
+	}
+
+	std::shared_ptr<imageDisk> Load()
+	{
+		FILE* file = fopen(path.string().c_str(), "rb+");
+		EXPECT_TRUE(file);
+		const auto size_kb = NumSectors * SectorSize / 1024;
+		auto disk = std::make_shared<imageDisk>(file, "test.img", size_kb, true);
+		disk->Set_Geometry(16, 2, 63, SectorSize);
+		return disk;
+	}
+
+	TempTestDir dir{"dosbox_bios_disk_tests"};
+	const std_fs::path path       = dir / "test.img";
+	std::vector<uint8_t> contents = {};
+};
+
+TEST_F(ImageDiskTest, ReadsRunOfSectors)
+{
+	auto disk = Load();
+
+	std::vector<uint8_t> data(10 * SectorSize);
+	EXPECT_EQ(disk->Read_AbsoluteSectors(100, 10, data.data()), 0);
+	EXPECT_TRUE(std::equal(data.begin(),
+	                       data.end(),
+	                       contents.begin() + 100 * SectorSize));
+
+	// Sector numbers in CHS addressing start at 1
+	EXPECT_EQ(disk->Read_Sectors(1, 0, 1, 2, data.data()), 0);
+	EXPECT_TRUE(std::equal(data.begin(),
+	                       data.begin() + 2 * SectorSize,
+	                       contents.begin() + 63 * SectorSize));
+}
+
+TEST_F(ImageDiskTest, WritesReachImageFile)
+{
+	std::vector<uint8_t> data(3 * SectorSize, 0xab);
+	{
+		auto disk = Load();
+		EXPECT_EQ(disk->Write_AbsoluteSectors(7, 3, data.data()), 0);
+
+		std::vector<uint8_t> read_back(data.size());
+		EXPECT_EQ(disk->Read_AbsoluteSectors(7, 3, read_back.data()), 0);
+		EXPECT_EQ(read_back, data);
+	}
+	std::copy(data.begin(), data.end(), contents.begin() + 7 * SectorSize);
+	EXPECT_EQ(read_host_file(path), contents);
+}
+
+} // namespace
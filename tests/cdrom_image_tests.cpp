@@ -0,0 +1,107 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/dos/cdrom.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Tags a frame with its sector so lookups can be checked
+void fill(CdSectorCache& cache, const uint32_t sector)
+{
+	auto frame = cache.Insert(sector);
+	ASSERT_TRUE(frame);
+	frame[0]                            = static_cast<uint8_t>(sector);
+	frame[CdSectorCache::FrameSize - 1] = static_cast<uint8_t>(sector);
+}
+
+bool holds(CdSectorCache& cache, const uint32_t sector)
+{
+	const auto frame = cache.Find(sector);
+	return frame && frame[0] == static_cast<uint8_t>(sector) &&
+	       frame[CdSectorCache::FrameSize - 1] == static_cast<uint8_t>(sector);
+}
+
+TEST(CdSectorCache, FindsInsertedFrames)
+{
+	CdSectorCache cache = {};
+	cache.Resize(4);
+
+	for (const uint32_t sector : {16, 17, 300}) {
+		fill(cache, sector);
+	}
+	EXPECT_EQ(cache.Size(), 3);
+	EXPECT_TRUE(holds(cache, 16));
+	EXPECT_TRUE(holds(cache, 17));
+	EXPECT_TRUE(holds(cache, 300));
+	EXPECT_FALSE(cache.Find(18));
+}
+
+TEST(CdSectorCache, EvictsLeastRecentlyUsed)
+{
+	CdSectorCache cache = {};
+	cache.Resize(3);
+
+	fill(cache, 1);
+	fill(cache, 2);
+	fill(cache, 3);
+
+	// Using sector 1 makes sector 2 the oldest
+	EXPECT_TRUE(holds(cache, 1));
+	fill(cache, 4);
+
+	EXPECT_EQ(cache.Size(), 3);
+	EXPECT_FALSE(cache.Find(2));
+	EXPECT_TRUE(holds(cache, 1));
+	EXPECT_TRUE(holds(cache, 3));
+	EXPECT_TRUE(holds(cache, 4));
+}
+
+TEST(CdSectorCache, ReinsertingKeepsOneFrame)
+{
+	CdSectorCache cache = {};
+	cache.Resize(2);
+
+	fill(cache, 7);
+	fill(cache, 8);
+	fill(cache, 7);
+	EXPECT_EQ(cache.Size(), 2);
+
+	// Sector 7 was refreshed, so sector 8 goes first
+	fill(cache, 9);
+	EXPECT_FALSE(cache.Find(8));
+	EXPECT_TRUE(holds(cache, 7));
+	EXPECT_TRUE(holds(cache, 9));
+}
+
+TEST(CdSectorCache, ResizeDropsFrames)
+{
+	CdSectorCache cache = {};
+	cache.Resize(2);
+	fill(cache, 5);
+
+	cache.Resize(8);
+	EXPECT_EQ(cache.Capacity(), 8);
+	EXPECT_EQ(cache.Size(), 0);
+	EXPECT_FALSE(cache.Find(5));
+}
+
+} // namespace
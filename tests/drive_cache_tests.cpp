@@ -0,0 +1,125 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dos_system.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "std_filesystem.h"
+#include "string_utils.h"
+
+#include "temp_test_dir.h"
+
+namespace {
+
+constexpr int NumNumberedFiles = 2000;
+
+class DriveCacheTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		for (const auto name : {"LongFileName1.txt", "LongFileName2.txt", "short.txt"}) {
+			Touch(name);
+		}
+		for (int i = 0; i < NumNumberedFiles; ++i) {
+			char name[16] = {};
+			safe_sprintf(name, "file%04d.dat", i);
+			Touch(name);
+		}
+		base_dir = dir.Path().string() + CROSS_FILESPLIT;
+	}
+
+	void TearDown() override
+	{
+		DOS_Drive_Cache::SetHostWatchEnabled(false);
+	}
+
+	void Touch(const std::string& name) const
+	{
+		std::ofstream(dir / name) << name;
+	}
+
+	// The host path for a DOS name, or the DOS name if it's not cached
+	std::string Expand(DOS_Drive_Cache& cache, const std::string& name) const
+	{
+		return cache.GetExpandNameAndNormaliseCase((base_dir + name).c_str());
+	}
+
+	TempTestDir dir{"dosbox_drive_cache_tests"};
+	std::string base_dir = {};
+};
+
+TEST_F(DriveCacheTest, ShortNamesRoundTrip)
+{
+	DOS_Drive_Cache cache(base_dir.c_str());
+
+	for (const std::string name : {"LongFileName1.txt", "LongFileName2.txt"}) {
+		char short_name[DOS_NAMELENGTH_ASCII] = {};
+		ASSERT_TRUE(cache.GetShortName((base_dir + name).c_str(), short_name));
+		EXPECT_EQ(std::string(short_name).substr(0, 7), "LONGFI~");
+		EXPECT_EQ(Expand(cache, short_name), base_dir + name);
+	}
+
+	// Names that fit 8.3 have no generated short name
+	char short_name[DOS_NAMELENGTH_ASCII] = {};
+	EXPECT_FALSE(cache.GetShortName((base_dir + "short.txt").c_str(), short_name));
+	EXPECT_EQ(Expand(cache, "SHORT.TXT"), base_dir + "short.txt");
+}
+
+TEST_F(DriveCacheTest, FindsNamesInLargeDirectory)
+{
+	DOS_Drive_Cache cache(base_dir.c_str());
+
+	EXPECT_EQ(Expand(cache, "FILE0000.DAT"), base_dir + "file0000.dat");
+	EXPECT_EQ(Expand(cache, "FILE1234.DAT"), base_dir + "file1234.dat");
+	EXPECT_EQ(Expand(cache, "FILE1999.DAT"), base_dir + "file1999.dat");
+	EXPECT_EQ(Expand(cache, "FILE2000.DAT"), base_dir + "FILE2000.DAT");
+}
+
+TEST_F(DriveCacheTest, AddedEntriesAreFound)
+{
+	DOS_Drive_Cache cache(base_dir.c_str());
+
+	Touch("NewFile.txt");
+	cache.AddEntry((base_dir + "NewFile.txt").c_str(), true);
+	EXPECT_EQ(Expand(cache, "NEWFILE.TXT"), base_dir + "NewFile.txt");
+}
+
+#if defined(LINUX)
+TEST_F(DriveCacheTest, WatchPicksUpHostChanges)
+{
+	DOS_Drive_Cache::SetHostWatchEnabled(true);
+	DOS_Drive_Cache cache(base_dir.c_str());
+
+	EXPECT_EQ(Expand(cache, "SHORT.TXT"), base_dir + "short.txt");
+
+	Touch("added.txt");
+	std_fs::remove(dir / "short.txt");
+
+	EXPECT_EQ(Expand(cache, "ADDED.TXT"), base_dir + "added.txt");
+	EXPECT_EQ(Expand(cache, "SHORT.TXT"), base_dir + "SHORT.TXT");
+}
+#endif
+
+} // namespace
@@ -0,0 +1,260 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "drives.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "bios_disk.h"
+#include "dos_inc.h"
+#include "std_filesystem.h"
+
+#include "dosbox_test_fixture.h"
+#include "temp_test_dir.h"
+
+namespace {
+
+constexpr size_t SectorSize    = 512;
+constexpr size_t FloppySectors = 2880;
+constexpr size_t FatStart      = 1 * SectorSize;
+constexpr size_t FatSize       = 9 * SectorSize;
+constexpr size_t TestFileSize  = 20000;
+
+// Writes a little-endian word into the image
+void put_word(std::vector<uint8_t>& image, const size_t offset, const uint16_t value)
+{
+	image[offset]     = static_cast<uint8_t>(value & 0xff);
+	image[offset + 1] = static_cast<uint8_t>(value >> 8);
+}
+
+// An empty, freshly formatted 1.44 MB floppy
+std::vector<uint8_t> make_floppy_image()
+{
+	std::vector<uint8_t> image(FloppySectors * SectorSize);
+
+	const uint8_t jump[] = {0xeb, 0x3c, 0x90};
+	std::copy(std::begin(jump), std::end(jump), image.begin());
+	const char oem_name[] = "MSDOS5.0";
+	std::copy(oem_name, oem_name + 8, image.begin() + 3);
+
+	put_word(image, 11, SectorSize);    // bytes per sector
+	image[13] = 1;                      // sectors per cluster
+	put_word(image, 14, 1);             // reserved sectors
+	image[16] = 2;                      // FAT copies
+	put_word(image, 17, 224);           // root directory entries
+	put_word(image, 19, FloppySectors); // total sectors
+	image[21] = 0xf0;                   // media descriptor
+	put_word(image, 22, 9);             // sectors per FAT
+	put_word(image, 24, 18);            // sectors per track
+	put_word(image, 26, 2);             // heads
+	image[510] = 0x55;
+	image[511] = 0xaa;
+
+	for (const auto fat : {FatStart, FatStart + FatSize}) {
+		image[fat]     = 0xf0;
+		image[fat + 1] = 0xff;
+		image[fat + 2] = 0xff;
+	}
+	return image;
+}
+
+class FatDriveTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+
+		write_host_file(path, make_floppy_image());
+
+		drive = std::make_shared<fatDrive>(
+		        path.string().c_str(), SectorSize, 18, 2, 80, false);
+		ASSERT_TRUE(drive->created_successfully);
+
+		contents.resize(TestFileSize);
+		for (size_t i = 0; i < contents.size(); ++i) {
+			contents[i] = static_cast<uint8_t>(i * 7 + i / 512);
+		}
+	}
+
+	void TearDown() override
+	{
+		drive.reset();
+		DOSBoxTestFixture::TearDown();
+	}
+
+	// Creates TEST.BIN holding the test contents
+	void CreateTestFile()
+	{
+		auto file = drive->FileCreate("TEST.BIN", {});
+		ASSERT_TRUE(file);
+		file->AddRef();
+
+		size_t pos = 0;
+		while (pos < contents.size()) {
+			uint16_t size = static_cast<uint16_t>(
+			        std::min(contents.size() - pos, size_t{3000}));
+			ASSERT_TRUE(file->Write(contents.data() + pos, &size));
+			ASSERT_GT(size, 0);
+			pos += size;
+		}
+		file->Close();
+	}
+
+	TempTestDir dir{"dosbox_drive_fat_tests"};
+	const std_fs::path path         = dir / "test.img";
+	std::vector<uint8_t> contents   = {};
+	std::shared_ptr<fatDrive> drive = {};
+};
+
+TEST_F(FatDriveTest, ReadsAfterSeeksAcrossClusters)
+{
+	CreateTestFile();
+
+	auto file = drive->FileOpen("TEST.BIN", OPEN_READ);
+	ASSERT_TRUE(file);
+	file->AddRef();
+
+	for (const uint32_t pos : {15000u, 100u, 511u, 512u, 19000u, 1023u}) {
+		auto new_pos = pos;
+		ASSERT_TRUE(file->Seek(&new_pos, DOS_SEEK_SET));
+
+		uint8_t buffer[700] = {};
+		uint16_t size       = sizeof(buffer);
+		ASSERT_TRUE(file->Read(buffer, &size));
+		ASSERT_EQ(size, std::min(sizeof(buffer), TestFileSize - pos));
+		EXPECT_TRUE(std::equal(buffer, buffer + size, contents.begin() + pos));
+	}
+	file->Close();
+}
+
+TEST_F(FatDriveTest, CloseWritesEveryFatCopy)
+{
+	CreateTestFile();
+
+	const auto image = read_host_file(path);
+	const auto fat1  = image.begin() + FatStart;
+	const auto fat2  = fat1 + FatSize;
+
+	// The file's chain reaches past the media descriptor bytes
+	EXPECT_NE(std::count(fat1 + 3, fat2, 0),
+	          static_cast<std::ptrdiff_t>(FatSize - 3));
+	EXPECT_TRUE(std::equal(fat1, fat2, fat2));
+}
+
+TEST_F(FatDriveTest, TruncationIsSeenByOtherHandles)
+{
+	CreateTestFile();
+
+	auto reader = drive->FileOpen("TEST.BIN", OPEN_READ);
+	ASSERT_TRUE(reader);
+	reader->AddRef();
+
+	// Map the whole chain in the reader
+	uint32_t pos = TestFileSize - 1;
+	ASSERT_TRUE(reader->Seek(&pos, DOS_SEEK_SET));
+
+	auto writer = drive->FileOpen("TEST.BIN", OPEN_READWRITE);
+	ASSERT_TRUE(writer);
+	writer->AddRef();
+	pos = 1000;
+	ASSERT_TRUE(writer->Seek(&pos, DOS_SEEK_SET));
+	uint16_t size = 0;
+	ASSERT_TRUE(writer->Write(nullptr, &size));
+	writer->Close();
+
+	// The freed clusters are no longer part of the reader's file
+	pos = TestFileSize - 1;
+	ASSERT_TRUE(reader->Seek(&pos, DOS_SEEK_SET));
+	uint8_t data  = 0;
+	size          = 1;
+	ASSERT_TRUE(reader->Read(&data, &size));
+	EXPECT_EQ(size, 0);
+	reader->Close();
+}
+
+TEST_F(FatDriveTest, ReloadsFatAfterAbsoluteWrites)
+{
+	CreateTestFile();
+
+	// The file starts at the first data cluster
+	ASSERT_NE(drive->getNextCluster(2), 0u);
+
+	const uint32_t fat_sector = FatStart / SectorSize;
+	EXPECT_FALSE(drive->isFatSector(fat_sector - 1));
+	EXPECT_TRUE(drive->isFatSector(fat_sector));
+	EXPECT_FALSE(drive->isFatSector(fat_sector + FatSize / SectorSize));
+
+	// Free every cluster behind the drive's back
+	uint8_t sector[SectorSize] = {0xf0, 0xff, 0xff};
+	ASSERT_EQ(drive->writeSector(fat_sector, sector), 0);
+
+	const auto generation = drive->getChainGeneration();
+	drive->reloadFat();
+	EXPECT_NE(drive->getChainGeneration(), generation);
+	EXPECT_EQ(drive->getNextCluster(2), 0u);
+}
+
+TEST_F(FatDriveTest, KeepsFatInSyncWithInt13hAccess)
+{
+	constexpr auto DriveC = 2;
+	ASSERT_FALSE(Drives[DriveC]);
+	Drives[DriveC] = drive;
+
+	// Leave the FAT changes of a growing file pending
+	auto file = drive->FileCreate("TEST.BIN", {});
+	ASSERT_TRUE(file);
+	file->AddRef();
+	uint16_t size = 3000;
+	ASSERT_TRUE(file->Write(contents.data(), &size));
+
+	// The first FAT sector is at CHS 0/0/2. The file starts at cluster 2,
+	// whose FAT12 entry links it to cluster 3.
+	uint8_t sector[SectorSize] = {};
+	ASSERT_EQ(BIOS_ReadDiskSectors(drive->loadedDisk, 0, 0, 2, 1, sector), 0);
+	EXPECT_EQ(sector[3], 0x03);
+	EXPECT_EQ(sector[4] & 0x0f, 0x00);
+	file->Close();
+
+	// Free every cluster
+	std::fill(std::begin(sector), std::end(sector), uint8_t{0});
+	sector[0] = 0xf0;
+	sector[1] = sector[2] = 0xff;
+
+	const auto generation = drive->getChainGeneration();
+	ASSERT_EQ(BIOS_WriteDiskSectors(drive->loadedDisk, 0, 0, 2, 1, sector), 0);
+	EXPECT_NE(drive->getChainGeneration(), generation);
+	EXPECT_EQ(drive->getNextCluster(2), 0u);
+
+	// Nothing stale is written back on unmount
+	Drives[DriveC] = nullptr;
+	drive.reset();
+	const auto image = read_host_file(path);
+	EXPECT_TRUE(std::equal(std::begin(sector),
+	                       std::end(sector),
+	                       image.begin() + FatStart));
+}
+
+} // namespace
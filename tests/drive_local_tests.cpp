@@ -0,0 +1,244 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/dos/drive_local.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "dos_inc.h"
+
+#include "dosbox_test_fixture.h"
+#include "temp_test_dir.h"
+
+namespace {
+
+constexpr size_t TestFileSize = 100 * 1024;
+
+class LocalFileTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+
+		contents.resize(TestFileSize);
+		for (size_t i = 0; i < contents.size(); ++i) {
+			contents[i] = static_cast<uint8_t>(i * 13 + i / 256);
+		}
+		write_host_file(dir / "test.bin", contents);
+
+		const auto base_dir = dir.Path().string() + CROSS_FILESPLIT;
+		drive = std::make_shared<localDrive>(
+		        base_dir.c_str(), 512, 32, 32765, 16000, 0xf8, false);
+	}
+
+	void TearDown() override
+	{
+		drive.reset();
+		DOSBoxTestFixture::TearDown();
+	}
+
+	std::unique_ptr<DOS_File> Open()
+	{
+		auto file = drive->FileOpen("TEST.BIN", OPEN_READWRITE);
+		EXPECT_TRUE(file);
+		file->AddRef();
+		return file;
+	}
+
+	std::vector<uint8_t> ReadHostFile() const
+	{
+		return read_host_file(dir / "test.bin");
+	}
+
+	TempTestDir dir{"dosbox_drive_local_tests"};
+	std::vector<uint8_t> contents     = {};
+	std::shared_ptr<localDrive> drive = {};
+};
+
+uint32_t seek(DOS_File& file, const uint32_t pos, const uint32_t type = DOS_SEEK_SET)
+{
+	auto new_pos = pos;
+	EXPECT_TRUE(file.Seek(&new_pos, type));
+	return new_pos;
+}
+
+TEST_F(LocalFileTest, SmallReadsMatchFile)
+{
+	auto file = Open();
+
+	std::vector<uint8_t> data = {};
+	uint8_t buffer[600]       = {};
+	uint16_t chunk            = 1;
+	while (true) {
+		uint16_t size = chunk;
+		ASSERT_TRUE(file->Read(buffer, &size));
+		if (size == 0) {
+			break;
+		}
+		data.insert(data.end(), buffer, buffer + size);
+		chunk = static_cast<uint16_t>(chunk % 512 + 7);
+	}
+	EXPECT_EQ(data, contents);
+	file->Close();
+}
+
+TEST_F(LocalFileTest, ReadsAfterSeeks)
+{
+	auto file = Open();
+
+	for (const uint32_t pos : {90000u, 10u, 4095u, 4096u, 65530u, 10u}) {
+		EXPECT_EQ(seek(*file, pos), pos);
+
+		uint8_t buffer[100] = {};
+		uint16_t size       = sizeof(buffer);
+		ASSERT_TRUE(file->Read(buffer, &size));
+		ASSERT_EQ(size, sizeof(buffer));
+		EXPECT_TRUE(std::equal(buffer, buffer + size, contents.begin() + pos));
+		EXPECT_EQ(seek(*file, 0, DOS_SEEK_CUR), pos + size);
+	}
+
+	// A read across the end of the file comes up short
+	seek(*file, TestFileSize - 10);
+	uint8_t buffer[100] = {};
+	uint16_t size       = sizeof(buffer);
+	ASSERT_TRUE(file->Read(buffer, &size));
+	EXPECT_EQ(size, 10);
+	file->Close();
+}
+
+TEST_F(LocalFileTest, WritesAreSeenByOtherHandles)
+{
+	auto writer = Open();
+	auto reader = Open();
+
+	// Fill the reader's read-ahead before the write
+	uint8_t buffer[4] = {};
+	uint16_t size     = sizeof(buffer);
+	ASSERT_TRUE(reader->Read(buffer, &size));
+
+	uint8_t data[] = {'D', 'O', 'S'};
+	seek(*writer, 1);
+	size = sizeof(data);
+	ASSERT_TRUE(writer->Write(data, &size));
+
+	seek(*reader, 0);
+	size = sizeof(buffer);
+	ASSERT_TRUE(reader->Read(buffer, &size));
+	EXPECT_EQ(buffer[0], contents[0]);
+	EXPECT_EQ(buffer[1], 'D');
+	EXPECT_EQ(buffer[2], 'O');
+	EXPECT_EQ(buffer[3], 'S');
+
+	writer->Close();
+	reader->Close();
+}
+
+TEST_F(LocalFileTest, SeekEndIncludesBufferedWrites)
+{
+	auto file = Open();
+
+	seek(*file, 0, DOS_SEEK_END);
+	uint8_t data[] = {1, 2, 3, 4, 5};
+	uint16_t size  = sizeof(data);
+	ASSERT_TRUE(file->Write(data, &size));
+
+	EXPECT_EQ(seek(*file, 0, DOS_SEEK_END), TestFileSize + sizeof(data));
+	file->Close();
+}
+
+TEST_F(LocalFileTest, CloseWritesBack)
+{
+	auto file = Open();
+
+	for (uint32_t pos = 0; pos < 1000; pos += 2) {
+		uint8_t data  = static_cast<uint8_t>(pos);
+		uint16_t size = 1;
+		ASSERT_TRUE(file->Write(&data, &size));
+		contents[pos] = data;
+		seek(*file, 1, DOS_SEEK_CUR);
+	}
+	file->Close();
+
+	EXPECT_EQ(ReadHostFile(), contents);
+}
+
+TEST_F(LocalFileTest, ZeroSizeWriteTruncates)
+{
+	auto file = Open();
+
+	uint8_t data[] = {'E', 'N', 'D'};
+	uint16_t size  = sizeof(data);
+	seek(*file, 100);
+	ASSERT_TRUE(file->Write(data, &size));
+	size = 0;
+	ASSERT_TRUE(file->Write(data, &size));
+	file->Close();
+
+	contents.resize(103);
+	std::copy(std::begin(data), std::end(data), contents.begin() + 100);
+	EXPECT_EQ(ReadHostFile(), contents);
+}
+
+// Replays a small-read workload through the mounted directory and reports
+// the throughput; run with --gtest_also_run_disabled_tests
+TEST_F(LocalFileTest, DISABLED_SmallReadThroughput)
+{
+	constexpr int Passes = 20;
+
+	const auto start = std::chrono::steady_clock::now();
+	size_t num_bytes = 0;
+	size_t num_reads = 0;
+	for (int pass = 0; pass < Passes; ++pass) {
+		auto file = Open();
+
+		// Read sizes cycle through 1 to 512 bytes
+		uint8_t buffer[512] = {};
+		uint16_t chunk      = 1;
+		while (true) {
+			// Like DOS_ReadFile(), which asks for the position first
+			seek(*file, 0, DOS_SEEK_CUR);
+			uint16_t size = chunk;
+			if (!file->Read(buffer, &size) || size == 0) {
+				break;
+			}
+			num_bytes += size;
+			++num_reads;
+			chunk = static_cast<uint16_t>(chunk % sizeof(buffer) + 1);
+		}
+		file->Close();
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() -
+	                                              start;
+
+	EXPECT_EQ(num_bytes, Passes * TestFileSize);
+	std::cout << "Read " << num_bytes << " bytes in " << num_reads
+	          << " reads of 1 to 512 bytes in " << elapsed.count() * 1000
+	          << " ms (" << num_bytes / elapsed.count() / (1024 * 1024)
+	          << " MB/s)\n";
+}
+
+} // namespace
@@ -0,0 +1,134 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "drives.h"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "dos_inc.h"
+#include "std_filesystem.h"
+
+#include "dosbox_test_fixture.h"
+#include "temp_test_dir.h"
+
+namespace {
+
+class OverlayDriveTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+
+		std_fs::create_directories(root / "base");
+		std_fs::create_directories(root / "overlay");
+
+		for (const auto name : {"base.txt", "kept.txt"}) {
+			std::ofstream(root / "base" / name) << name;
+		}
+		journal = root / "overlay" / "DBOVERLAY_JOURNAL";
+	}
+
+	void TearDown() override
+	{
+		drive.reset();
+		DOSBoxTestFixture::TearDown();
+	}
+
+	void Mount()
+	{
+		const auto base_dir    = (root / "base").string() + CROSS_FILESPLIT;
+		const auto overlay_dir = (root / "overlay").string() + CROSS_FILESPLIT;
+
+		uint8_t error = 0;
+		drive = std::make_shared<Overlay_Drive>(base_dir.c_str(),
+		                                        overlay_dir.c_str(),
+		                                        512,
+		                                        32,
+		                                        32765,
+		                                        16000,
+		                                        0xf8,
+		                                        error);
+		ASSERT_EQ(error, 0);
+	}
+
+	void CreateFile(const char* name)
+	{
+		auto file = drive->FileCreate(name, {});
+		ASSERT_TRUE(file);
+		file->AddRef();
+		file->Close();
+	}
+
+	TempTestDir root{"dosbox_drive_overlay_tests"};
+	std_fs::path journal                 = {};
+	std::shared_ptr<Overlay_Drive> drive = {};
+};
+
+TEST_F(OverlayDriveTest, ChangesSurviveRemount)
+{
+	Mount();
+	CreateFile("NEW.TXT");
+	EXPECT_TRUE(drive->FileUnlink("BASE.TXT"));
+	drive.reset();
+
+	EXPECT_TRUE(std_fs::exists(journal));
+
+	Mount();
+	EXPECT_TRUE(drive->FileExists("NEW.TXT"));
+	EXPECT_FALSE(drive->FileExists("BASE.TXT"));
+	EXPECT_TRUE(drive->FileExists("KEPT.TXT"));
+}
+
+TEST_F(OverlayDriveTest, MissingJournalIsRebuiltFromOverlay)
+{
+	Mount();
+	EXPECT_TRUE(drive->FileUnlink("BASE.TXT"));
+	drive.reset();
+
+	// Like an overlay last used by an older version
+	std_fs::remove(journal);
+
+	Mount();
+	EXPECT_FALSE(drive->FileExists("BASE.TXT"));
+	EXPECT_TRUE(drive->FileExists("KEPT.TXT"));
+	EXPECT_TRUE(std_fs::exists(journal));
+}
+
+TEST_F(OverlayDriveTest, JournalIsCheckedAgainstOverlay)
+{
+	Mount();
+	CreateFile("NEW.TXT");
+	EXPECT_TRUE(drive->FileUnlink("BASE.TXT"));
+	drive.reset();
+
+	// Removed by hand while unmounted
+	ASSERT_TRUE(std_fs::remove(root / "overlay" / "NEW.TXT"));
+
+	Mount();
+	EXPECT_FALSE(drive->FileExists("NEW.TXT"));
+	EXPECT_FALSE(drive->FileExists("BASE.TXT"));
+	EXPECT_TRUE(drive->FileExists("KEPT.TXT"));
+}
+
+} // namespace
@@ -0,0 +1,204 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "frame_fifo.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// Drains the whole FIFO, one contiguous span at a time
+static std::vector<int> drain(FrameFifo<int>& fifo, size_t* num_spans = nullptr)
+{
+	std::vector<int> items = {};
+	size_t spans           = 0;
+	while (!fifo.IsEmpty()) {
+		const auto front = fifo.Front(fifo.Size());
+		items.insert(items.end(), front.begin(), front.end());
+		fifo.Discard(front.size());
+		++spans;
+	}
+	if (num_spans) {
+		*num_spans = spans;
+	}
+	return items;
+}
+
+TEST(FrameFifo, StartsEmpty)
+{
+	FrameFifo<int> fifo(4);
+	EXPECT_TRUE(fifo.IsEmpty());
+	EXPECT_EQ(fifo.Size(), 0);
+	EXPECT_TRUE(fifo.Front(10).empty());
+}
+
+TEST(FrameFifo, KeepsOrder)
+{
+	FrameFifo<int> fifo(4);
+	for (auto i = 0; i < 4; ++i) {
+		fifo.Enqueue(i);
+	}
+	size_t num_spans = 0;
+	EXPECT_EQ(drain(fifo, &num_spans), std::vector<int>({0, 1, 2, 3}));
+	EXPECT_EQ(num_spans, 1);
+}
+
+TEST(FrameFifo, FrontLimitsToRequestedSize)
+{
+	FrameFifo<int> fifo(8);
+	fifo.Enqueue(std::vector<int>{1, 2, 3, 4, 5});
+
+	const auto front = fifo.Front(2);
+	ASSERT_EQ(front.size(), 2);
+	EXPECT_EQ(front[0], 1);
+	EXPECT_EQ(front[1], 2);
+
+	fifo.Discard(front.size());
+	EXPECT_EQ(fifo.Size(), 3);
+	EXPECT_EQ(drain(fifo), std::vector<int>({3, 4, 5}));
+}
+
+TEST(FrameFifo, WrapsAroundInTwoSpans)
+{
+	FrameFifo<int> fifo(4);
+	fifo.Enqueue(std::vector<int>{0, 1, 2});
+	fifo.Discard(2);
+
+	// The next three items wrap around the end of the buffer
+	fifo.Enqueue(std::vector<int>{3, 4, 5});
+
+	size_t num_spans = 0;
+	EXPECT_EQ(drain(fifo, &num_spans), std::vector<int>({2, 3, 4, 5}));
+	EXPECT_EQ(num_spans, 2);
+}
+
+TEST(FrameFifo, GrowsWhenWrapped)
+{
+	FrameFifo<int> fifo(4);
+	fifo.Enqueue(std::vector<int>{0, 1, 2, 3});
+	fifo.Discard(3);
+
+	std::vector<int> expected = {3};
+	for (auto i = 4; i < 20; ++i) {
+		fifo.Enqueue(i);
+		expected.push_back(i);
+	}
+	EXPECT_EQ(fifo.Size(), expected.size());
+	EXPECT_EQ(drain(fifo), expected);
+}
+
+TEST(FrameFifo, Clear)
+{
+	FrameFifo<int> fifo(4);
+	fifo.Enqueue(std::vector<int>{0, 1, 2});
+	fifo.Clear();
+	EXPECT_TRUE(fifo.IsEmpty());
+
+	fifo.Enqueue(7);
+	EXPECT_EQ(drain(fifo), std::vector<int>({7}));
+}
+
+TEST(FrameFifo, IndexesFromTheFront)
+{
+	FrameFifo<int> fifo(4);
+	fifo.Enqueue(std::vector<int>{0, 1, 2});
+	fifo.Discard(2);
+	fifo.Enqueue(std::vector<int>{3, 4});
+
+	// Items 3 and 4 have wrapped around the end of the buffer
+	ASSERT_EQ(fifo.Size(), 3);
+	EXPECT_EQ(fifo[0], 2);
+	EXPECT_EQ(fifo[1], 3);
+	EXPECT_EQ(fifo[2], 4);
+
+	fifo[1] = 30;
+	EXPECT_EQ(drain(fifo), std::vector<int>({2, 30, 4}));
+}
+
+TEST(FrameFifo, WritesInPlace)
+{
+	FrameFifo<int> fifo(8);
+	fifo.Enqueue(std::vector<int>{0, 1, 2, 3});
+	fifo.Discard(2);
+
+	// Six free slots: four up to the end, then two at the start
+	auto run = fifo.GetWriteSpan(6);
+	ASSERT_EQ(run.size(), 4);
+	run[0] = 6;
+	run[1] = 7;
+	fifo.CommitWrite(2);
+
+	run = fifo.GetWriteSpan(4);
+	ASSERT_EQ(run.size(), 2);
+	run[0] = 8;
+	run[1] = 9;
+	fifo.CommitWrite(2);
+
+	run = fifo.GetWriteSpan(2);
+	ASSERT_EQ(run.size(), 2);
+	run[0] = 10;
+	run[1] = 11;
+	fifo.CommitWrite(2);
+
+	EXPECT_EQ(fifo.Capacity(), 8);
+	EXPECT_EQ(drain(fifo), std::vector<int>({2, 3, 6, 7, 8, 9, 10, 11}));
+}
+
+TEST(FrameFifo, GrowsToFitWrite)
+{
+	FrameFifo<int> fifo(4);
+	fifo.Enqueue(std::vector<int>{0, 1, 2});
+
+	const auto run = fifo.GetWriteSpan(6);
+	ASSERT_EQ(run.size(), 6);
+	EXPECT_EQ(fifo.Capacity(), 16);
+	for (auto i = 0; i < 6; ++i) {
+		run[i] = i + 3;
+	}
+	fifo.CommitWrite(run.size());
+
+	EXPECT_EQ(drain(fifo), std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8}));
+}
+
+TEST(FrameFifo, SteadyStateDoesNotReallocate)
+{
+	FrameFifo<int> fifo(4);
+	fifo.Reserve(100);
+	EXPECT_EQ(fifo.Capacity(), 128);
+
+	// Produce and consume odd-sized blocks so the queue keeps wrapping
+	int next_in  = 0;
+	int next_out = 0;
+	for (auto block = 0; block < 1000; ++block) {
+		for (auto i = 0; i < 37; ++i) {
+			fifo.Enqueue(next_in++);
+		}
+		while (fifo.Size() > 20) {
+			const auto front = fifo.Front(fifo.Size() - 20);
+			for (const auto item : front) {
+				ASSERT_EQ(item, next_out++);
+			}
+			fifo.Discard(front.size());
+		}
+	}
+	// The buffer only ever grows, so an unchanged capacity means it was
+	// never reallocated
+	EXPECT_EQ(fifo.Capacity(), 128);
+}
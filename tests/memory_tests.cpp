@@ -0,0 +1,148 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "mem.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "dosbox_test_fixture.h"
+#include "paging.h"
+
+namespace {
+
+class MemoryTest : public DOSBoxTestFixture {};
+
+// Free conventional memory, starting just before a page boundary so the
+// accesses span several pages
+constexpr PhysPt TestAddress = 0x30000 - 100;
+
+std::vector<uint8_t> make_pattern(const size_t num_bytes)
+{
+	std::vector<uint8_t> pattern(num_bytes);
+	for (size_t i = 0; i < num_bytes; ++i) {
+		pattern[i] = static_cast<uint8_t>(i * 7 + 3);
+	}
+	return pattern;
+}
+
+TEST_F(MemoryTest, BlockWriteSpansPages)
+{
+	const auto pattern = make_pattern(2 * dos_pagesize + 200);
+	MEM_BlockWrite(TestAddress, pattern.data(), pattern.size());
+
+	for (size_t i = 0; i < pattern.size(); ++i) {
+		ASSERT_EQ(mem_readb(TestAddress + static_cast<PhysPt>(i)),
+		          pattern[i]);
+	}
+}
+
+TEST_F(MemoryTest, BlockReadSpansPages)
+{
+	const auto pattern = make_pattern(2 * dos_pagesize + 200);
+	for (size_t i = 0; i < pattern.size(); ++i) {
+		mem_writeb(TestAddress + static_cast<PhysPt>(i), pattern[i]);
+	}
+
+	std::vector<uint8_t> data(pattern.size());
+	MEM_BlockRead(TestAddress, data.data(), data.size());
+	EXPECT_EQ(data, pattern);
+}
+
+TEST_F(MemoryTest, BlockCopySpansPages)
+{
+	const auto pattern = make_pattern(dos_pagesize + 300);
+	MEM_BlockWrite(TestAddress, pattern.data(), pattern.size());
+
+	const PhysPt dest = TestAddress + 3 * dos_pagesize + 17;
+	MEM_BlockCopy(dest, TestAddress, pattern.size());
+
+	std::vector<uint8_t> data(pattern.size());
+	MEM_BlockRead(dest, data.data(), data.size());
+	EXPECT_EQ(data, pattern);
+}
+
+TEST_F(MemoryTest, OverlappingCopyRepeatsLikeByteCopy)
+{
+	const std::array<uint8_t, 3> pattern = {1, 2, 3};
+	MEM_BlockWrite(TestAddress, pattern.data(), pattern.size());
+
+	// A forward byte-by-byte copy onto itself repeats the first bytes
+	MEM_BlockCopy(TestAddress + 3, TestAddress, 9);
+
+	std::array<uint8_t, 12> data = {};
+	MEM_BlockRead(TestAddress, data.data(), data.size());
+
+	const std::array<uint8_t, 12> expected = {1, 2, 3, 1, 2, 3, 1, 2, 3, 1, 2, 3};
+	EXPECT_EQ(data, expected);
+}
+
+TEST_F(MemoryTest, StrCopyStopsAtTerminatorInNextPage)
+{
+	const char text[] = "crosses the page boundary";
+	MEM_BlockWrite(TestAddress + 90, text, sizeof(text));
+
+	char data[64] = {};
+	MEM_StrCopy(TestAddress + 90, data, sizeof(data) - 1);
+	EXPECT_STREQ(data, text);
+}
+
+TEST_F(MemoryTest, StrCopyStopsAtSize)
+{
+	const char text[] = "truncated";
+	MEM_BlockWrite(TestAddress, text, sizeof(text));
+
+	char data[16] = {};
+	memset(data, 'x', sizeof(data));
+	MEM_StrCopy(TestAddress, data, 5);
+	EXPECT_STREQ(data, "trunc");
+}
+
+TEST(MemElementsInPage, StopsAtPageEnd)
+{
+	EXPECT_EQ(mem_elements_in_page(0xa0000, 0x0ff0, 0xffff, 1, 100), 16);
+	EXPECT_EQ(mem_elements_in_page(0xa0000, 0x0ff0, 0xffff, 4, 100), 4);
+	EXPECT_EQ(mem_elements_in_page(0xa0000, 0x0ff0, 0xffff, 1, 10), 10);
+}
+
+TEST(MemElementsInPage, StopsAtIndexWrap)
+{
+	// The segment base isn't page aligned, so the 16-bit index wraps
+	// around in the middle of a page
+	EXPECT_EQ(mem_elements_in_page(0xa0800, 0xfff0, 0xffff, 2, 100), 8);
+	EXPECT_EQ(mem_elements_in_page(0, 0, 0xffffffff, 1, 0xffffffff), 4096);
+}
+
+TEST(MemElementsInPage, StraddlingElementIsDoneAlone)
+{
+	EXPECT_EQ(mem_elements_in_page(0xa0000, 0x0fff, 0xffff, 2, 100), 1);
+}
+
+TEST_F(MemoryTest, BlockWritesLeaveRamToCaller)
+{
+	// Pages with host memory are written by the callers themselves
+	EXPECT_FALSE(mem_fill_block(TestAddress, 0x55, 1, 16));
+	EXPECT_FALSE(mem_copy_block(TestAddress, TestAddress + 64, 1, 16));
+}
+
+} // namespace
@@ -0,0 +1,129 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "pic.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "dosbox_test_fixture.h"
+#include "timer.h"
+
+namespace {
+
+std::vector<uint32_t> fired_values = {};
+
+void record_event(const uint32_t val)
+{
+	fired_values.push_back(val);
+}
+
+class PicEventTest : public DOSBoxTestFixture {
+protected:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+		fired_values.clear();
+	}
+
+	void TearDown() override
+	{
+		PIC_RemoveEvents(record_event);
+		DOSBoxTestFixture::TearDown();
+	}
+
+	// Moves two milliseconds ahead, which is past every test event
+	static void RunDueEvents()
+	{
+		for (auto i = 0; i < 2; ++i) {
+			TIMER_AddTick();
+			PIC_RunQueue();
+		}
+	}
+
+	static bool HasFired(const uint32_t val)
+	{
+		return std::find(fired_values.begin(), fired_values.end(), val) !=
+		       fired_values.end();
+	}
+};
+
+constexpr double Delay = 0.5;
+
+TEST_F(PicEventTest, RemovesLiveEvent)
+{
+	const auto id = PIC_AddEvent(record_event, Delay, 1);
+	PIC_AddEvent(record_event, Delay, 2);
+
+	PIC_RemoveEvent(id);
+	RunDueEvents();
+
+	// Only the given event is removed, not the others of its handler
+	EXPECT_FALSE(HasFired(1));
+	EXPECT_TRUE(HasFired(2));
+}
+
+TEST_F(PicEventTest, StaleIdDoesNotRemoveReusedSlot)
+{
+	constexpr uint32_t NumEvents = 16;
+
+	std::vector<PIC_EventId> stale_ids = {};
+	for (uint32_t i = 0; i < NumEvents; ++i) {
+		stale_ids.push_back(PIC_AddEvent(record_event, Delay, i));
+	}
+	for (const auto id : stale_ids) {
+		PIC_RemoveEvent(id);
+	}
+	RunDueEvents();
+	ASSERT_TRUE(fired_values.empty());
+
+	// The new events take over the released slots
+	for (uint32_t i = 0; i < NumEvents; ++i) {
+		PIC_AddEvent(record_event, Delay, NumEvents + i);
+	}
+	for (const auto id : stale_ids) {
+		PIC_RemoveEvent(id);
+	}
+	RunDueEvents();
+
+	EXPECT_EQ(fired_values.size(), NumEvents);
+	for (uint32_t i = 0; i < NumEvents; ++i) {
+		EXPECT_TRUE(HasFired(NumEvents + i));
+	}
+}
+
+TEST_F(PicEventTest, IdOfFiredEventIsIgnored)
+{
+	const auto id = PIC_AddEvent(record_event, Delay, 1);
+	RunDueEvents();
+	ASSERT_TRUE(HasFired(1));
+
+	PIC_RemoveEvent(id);
+
+	PIC_AddEvent(record_event, Delay, 2);
+	PIC_RemoveEvent(id);
+	RunDueEvents();
+
+	EXPECT_TRUE(HasFired(2));
+}
+
+} // namespace
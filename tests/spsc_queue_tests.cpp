@@ -0,0 +1,156 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "spsc_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr auto iterations = 10000;
+
+TEST(SPSCQueue, TrivialSerial)
+{
+	SPSCQueue<int> q(65);
+	std::vector<int> source(65);
+	std::iota(source.begin(), source.end(), 0);
+	std::vector<int> target(65);
+
+	// Cycle enough times to wrap the indices around the buffer
+	for (int iteration = 0; iteration != 128; ++iteration) {
+		EXPECT_EQ(q.MaxCapacity(), 65);
+		EXPECT_EQ(q.Size(), 0);
+		EXPECT_TRUE(q.IsEmpty());
+
+		EXPECT_EQ(q.NonblockingBulkEnqueue({source.data(), 7}), 7);
+		EXPECT_EQ(q.Size(), 7);
+		EXPECT_EQ(q.NonblockingBulkEnqueue(
+		                  std::span(source).subspan(7)),
+		          58);
+		EXPECT_EQ(q.Size(), 65);
+
+		// Full, so nothing more fits
+		EXPECT_EQ(q.NonblockingBulkEnqueue({source.data(), 1}), 0);
+
+		EXPECT_EQ(q.NonblockingBulkDequeue({target.data(), 3}), 3);
+		EXPECT_EQ(q.NonblockingBulkDequeue(std::span(target).subspan(3)),
+		          62);
+		EXPECT_EQ(target, source);
+		EXPECT_TRUE(q.IsEmpty());
+	}
+}
+
+TEST(SPSCQueue, TrivialZeroCapacity)
+{
+	EXPECT_DEBUG_DEATH({ SPSCQueue<int> q(0); }, "");
+}
+
+TEST(SPSCQueue, SpansWrapAround)
+{
+	SPSCQueue<int> q(8);
+	std::vector<int> items = {0, 1, 2, 3, 4, 5};
+	std::vector<int> target(4);
+
+	EXPECT_EQ(q.NonblockingBulkEnqueue(items), 6);
+	EXPECT_EQ(q.NonblockingBulkDequeue(target), 4);
+
+	// Writable region wraps: two slots at the end and four at the start
+	auto write_spans = q.GetWriteSpans();
+	EXPECT_EQ(write_spans.first.size(), 2);
+	EXPECT_EQ(write_spans.second.size(), 4);
+	write_spans.first[0]  = 6;
+	write_spans.first[1]  = 7;
+	write_spans.second[0] = 8;
+	q.CommitWrite(3);
+
+	const auto read_spans = q.GetReadSpans();
+	EXPECT_EQ(read_spans.size(), 5);
+	std::vector<int> read = {};
+	read.insert(read.end(), read_spans.first.begin(), read_spans.first.end());
+	read.insert(read.end(), read_spans.second.begin(), read_spans.second.end());
+	EXPECT_EQ(read, std::vector<int>({4, 5, 6, 7, 8}));
+	q.CommitRead(read.size());
+	EXPECT_TRUE(q.IsEmpty());
+}
+
+TEST(SPSCQueue, ClearAndStop)
+{
+	SPSCQueue<int> q(4);
+	std::vector<int> items = {1, 2, 3};
+	q.NonblockingBulkEnqueue(items);
+	q.Clear();
+	EXPECT_TRUE(q.IsEmpty());
+
+	q.NonblockingBulkEnqueue(items);
+	q.Stop();
+	EXPECT_FALSE(q.IsRunning());
+	EXPECT_EQ(q.NonblockingBulkEnqueue(items), 0);
+	EXPECT_FALSE(q.BulkEnqueue(items));
+
+	// Queued items are still drained after stopping
+	std::vector<int> target(8);
+	EXPECT_EQ(q.BulkDequeue(target), 3);
+
+	q.Start();
+	EXPECT_TRUE(q.BulkEnqueue(items));
+	EXPECT_EQ(q.Size(), 3);
+}
+
+TEST(SPSCQueue, BlockingProducerConsumer)
+{
+	SPSCQueue<int> q(33);
+
+	std::thread producer([&] {
+		std::vector<int> chunk(17);
+		for (int i = 0; i < iterations; i += 17) {
+			std::iota(chunk.begin(), chunk.end(), i);
+			EXPECT_TRUE(q.BulkEnqueue(chunk));
+		}
+	});
+
+	std::vector<int> target(23);
+	int expected = 0;
+	while (expected < iterations) {
+		EXPECT_EQ(q.BulkDequeue(target), target.size());
+		for (const auto item : target) {
+			EXPECT_EQ(item, expected++);
+		}
+	}
+	producer.join();
+}
+
+TEST(SPSCQueue, StopWakesBlockedConsumer)
+{
+	SPSCQueue<int> q(4);
+
+	std::thread consumer([&] {
+		std::vector<int> target(4);
+		EXPECT_EQ(q.BulkDequeue(target), 0);
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	q.Stop();
+	consumer.join();
+}
+
+} // namespace
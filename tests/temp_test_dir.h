@@ -0,0 +1,82 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2024-2024  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_TEMP_TEST_DIR_H
+#define DOSBOX_TEMP_TEST_DIR_H
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "std_filesystem.h"
+
+// An empty scratch directory in the system's temporary directory, removed
+// with everything in it when the test is done
+class TempTestDir {
+public:
+	explicit TempTestDir(const std::string& name)
+	        : path(std_fs::temp_directory_path() / name)
+	{
+		std_fs::remove_all(path);
+		std_fs::create_directories(path);
+	}
+
+	~TempTestDir()
+	{
+		std::error_code ec = {};
+		std_fs::remove_all(path, ec);
+	}
+
+	TempTestDir(const TempTestDir&)            = delete; // prevent copying
+	TempTestDir& operator=(const TempTestDir&) = delete; // prevent assignment
+
+	const std_fs::path& Path() const
+	{
+		return path;
+	}
+
+	std_fs::path operator/(const std_fs::path& name) const
+	{
+		return path / name;
+	}
+
+private:
+	const std_fs::path path;
+};
+
+inline void write_host_file(const std_fs::path& path,
+                            const std::vector<uint8_t>& contents)
+{
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(contents.data()),
+	          static_cast<std::streamsize>(contents.size()));
+}
+
+inline std::vector<uint8_t> read_host_file(const std_fs::path& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return {std::istreambuf_iterator<char>(in),
+	        std::istreambuf_iterator<char>()};
+}
+
+#endif